@@ -48,6 +48,7 @@ static ALuint *al_sources;
 static sfx_t *known_sfx;
 static int num_sfx;
 static int low_sfx;
+static bool sfx_cachable; // past the base sounds
 static ALuint *al_buffers;
 
 #define SOUND_NOMINAL_CLIP_DIST 1000.0f
@@ -226,9 +227,46 @@ void S_Shutdown (void)
 	}
 }
 
+static void S_FlushSound (cache_t *c)
+{
+	sfx_t *sfx = (sfx_t *)((byte *)c - offsetof (sfx_t, cache));
+	int i = sfx - known_sfx;
+
+	// give the samples back to openal
+	alDeleteBuffers (2, &al_buffers[i * 2]);
+	alGenBuffers (2, &al_buffers[i * 2]);
+
+	memset (sfx, 0, sizeof (*sfx));
+}
+
+/*
+==================
+S_CheckCached
+
+A sound kept from an earlier level is used again if its file hasn't changed
+==================
+*/
+static bool S_CheckCached (sfx_t *sfx)
+{
+	char filename[MAX_OSPATH];
+	unsigned crc;
+
+	sfx->stale = false;
+
+	snprintf (filename, sizeof (filename), "sound/%s", sfx->name);
+	if (COM_FileCRC (filename, &crc) && crc == sfx->crc)
+	{
+		Cache_Touch (&sfx->cache);
+		return true;
+	}
+
+	Cache_Remove (&sfx->cache);
+	return false;
+}
+
 static sfx_t *S_FindName (char *name)
 {
-	int i;
+	int i, slot;
 	sfx_t *sfx;
 
 	if (!name)
@@ -238,12 +276,40 @@ static sfx_t *S_FindName (char *name)
 		Sys_Error ("Sound name too long: %s", name);
 
 	// see if already loaded
+	slot = -1;
 	for (i = 0; i < num_sfx; i++)
-		if (!strcmp (known_sfx[i].name, name))
-			return &known_sfx[i];
+	{
+		sfx = &known_sfx[i];
+		if (!strcmp (sfx->name, name))
+		{
+			if (!sfx->stale || S_CheckCached (sfx))
+				return sfx;
+			break; // changed, load it again in place
+		}
+		if (slot == -1 && !sfx->name[0])
+			slot = i;
+	}
 
-	if (num_sfx == MAX_SFX)
-		Sys_Error ("S_FindName: out of sfx_t");
+	if (i == num_sfx)
+	{
+		if (slot == -1)
+		{
+			// take the place of a cached sound this level hasn't used
+			for (slot = low_sfx; slot < num_sfx; slot++)
+				if (known_sfx[slot].stale)
+					break;
+			if (slot < num_sfx)
+			{
+				Cache_Remove (&known_sfx[slot].cache);
+				S_FlushSound (&known_sfx[slot].cache);
+			}
+			else if (num_sfx == MAX_SFX)
+				Sys_Error ("S_FindName: out of sfx_t");
+			else
+				slot = num_sfx;
+		}
+		i = slot;
+	}
 
 	sfx = &known_sfx[i];
 	strcpy (sfx->name, name);
@@ -251,9 +317,16 @@ static sfx_t *S_FindName (char *name)
 	sfx->al_buffers[1] = al_buffers[i * 2 + 1];
 
 	if (!S_LoadSound (sfx))
+	{
+		memset (sfx, 0, sizeof (*sfx));
 		return NULL;
+	}
+
+	if (i == num_sfx)
+		num_sfx++;
 
-	num_sfx++;
+	if (sfx_cachable)
+		Cache_Add (&sfx->cache, sfx->length * sfx->width * (1 + sfx->stereo), S_FlushSound);
 
 	return sfx;
 }
@@ -266,6 +339,39 @@ sfx_t *S_PrecacheSound (char *name)
 	return S_FindName (name);
 }
 
+/*
+==================
+S_PrecacheSounds
+
+Precaches a whole list, decoding the new sounds on the worker threads
+==================
+*/
+void S_PrecacheSounds (char **names, int count, sfx_t **sfx)
+{
+	char *load[MAX_SFX];
+	int i, j, numload;
+
+	if (!snd_context)
+	{
+		memset (sfx, 0, count * sizeof (*sfx));
+		return;
+	}
+
+	for (i = 0, numload = 0; i < count && numload < MAX_SFX; i++)
+	{
+		for (j = 0; j < num_sfx; j++)
+			if (!strcmp (known_sfx[j].name, names[i]))
+				break;
+		if (j == num_sfx)
+			load[numload++] = names[i];
+	}
+
+	S_PreloadSounds (load, numload);
+	for (i = 0; i < count; i++)
+		sfx[i] = S_FindName (names[i]);
+	S_ReleasePreload ();
+}
+
 void S_SetSoundPaused (bool paused)
 {
 	ALint al_state;
@@ -642,17 +748,26 @@ void S_LocalSound (sfx_t *sfx)
 void S_InitBase (void)
 {
 	low_sfx = num_sfx;
+	sfx_cachable = true;
 }
 
+/*
+==================
+S_ClearAll
+
+The base sounds are always kept, the rest stay in the cache and are checked
+against their files when a new level precaches them
+==================
+*/
 void S_ClearAll (void)
 {
 	if (!snd_context)
 		return;
 
-	for (int i = low_sfx + 1; i < num_sfx; i++)
-		memset (known_sfx + i, 0, sizeof (sfx_t));
+	S_StopAllSounds ();
 
-	num_sfx = low_sfx;
+	for (int i = low_sfx; i < num_sfx; i++)
+		known_sfx[i].stale = true;
 }
 
 void S_Print (void)
@@ -666,5 +781,12 @@ void S_Print (void)
 		return;
 
 	for (i = 0, sfx = known_sfx; i < num_sfx; i++, sfx++)
-		Con_Printf ("%u : %s\n", i, sfx->name);
+	{
+		if (!sfx->name[0])
+			continue;
+		if (sfx->cache.next)
+			Con_Printf ("%u : %s (%lu bytes)\n", i, sfx->name, sfx->cache.size);
+		else
+			Con_Printf ("%u : %s\n", i, sfx->name);
+	}
 }
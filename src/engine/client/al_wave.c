@@ -25,6 +25,13 @@ extern int snd_speed;
 
 extern cvar_t loadas8bit;
 
+/*
+sounds are parsed and resampled in two steps so that a whole sound list can
+be decoded by the worker threads: the decode only touches the file data and
+its own wavload_t, and the main thread does the openal upload after.  the
+parse state is kept per sound for the same reason
+*/
+
 typedef struct
 {
 	int rate;
@@ -35,148 +42,150 @@ typedef struct
 	int dataofs;
 } wavinfo_t;
 
-static byte *data_p;
-static byte *iff_end;
-static byte *last_chunk;
-static byte *iff_data;
-static int iff_chunk_len;
+typedef struct
+{
+	byte *data_p;
+	byte *iff_end;
+	byte *last_chunk;
+	byte *iff_data;
+	int iff_chunk_len;
+} iff_t;
 
-static int GetLittleShort (void)
+typedef struct
+{
+	char name[MAX_QPATH];
+	byte *data; // file view
+	size_t len;
+
+	// filled in by S_DecodeWav
+	unsigned crc;
+	sfx_t sfx;
+	byte *resampled;
+	char *error; // printed by the main thread
+	bool badloop;
+	atomic_bool done;
+} wavload_t;
+
+static wavload_t *wav_preload;
+static int wav_numpreload;
+static int wav_nextpreload; // where the next S_LoadSound will probably look
+
+static int GetLittleShort (iff_t *iff)
 {
 	int val = 0;
-	val = *data_p;
-	val = val + (*(data_p + 1) << 8);
-	data_p += 2;
+	val = *iff->data_p;
+	val = val + (*(iff->data_p + 1) << 8);
+	iff->data_p += 2;
 	return val;
 }
 
-static int GetLittleLong (void)
+static int GetLittleLong (iff_t *iff)
 {
 	int val = 0;
-	val = *data_p;
-	val = val + (*(data_p + 1) << 8);
-	val = val + (*(data_p + 2) << 16);
-	val = val + (*(data_p + 3) << 24);
-	data_p += 4;
+	val = *iff->data_p;
+	val = val + (*(iff->data_p + 1) << 8);
+	val = val + (*(iff->data_p + 2) << 16);
+	val = val + (*(iff->data_p + 3) << 24);
+	iff->data_p += 4;
 	return val;
 }
 
-static void FindNextChunk (char *name)
+static void FindNextChunk (iff_t *iff, char *name)
 {
 	while (1)
 	{
-		data_p = last_chunk;
+		iff->data_p = iff->last_chunk;
 
-		if (data_p >= iff_end)
+		if (iff->data_p >= iff->iff_end)
 		{ // didn't find the chunk
-			data_p = NULL;
+			iff->data_p = NULL;
 			return;
 		}
 
-		data_p += 4;
-		iff_chunk_len = GetLittleLong ();
-		if (iff_chunk_len < 0)
+		iff->data_p += 4;
+		iff->iff_chunk_len = GetLittleLong (iff);
+		if (iff->iff_chunk_len < 0)
 		{
-			data_p = NULL;
+			iff->data_p = NULL;
 			return;
 		}
 		//		if (iff_chunk_len > 1024*1024)
 		//			Sys_Error ("FindNextChunk: %i length is past the 1 meg sanity limit", iff_chunk_len);
-		data_p -= 8;
-		last_chunk = data_p + 8 + ((iff_chunk_len + 1) & ~1);
-		if (!strncmp (data_p, name, 4))
+		iff->data_p -= 8;
+		iff->last_chunk = iff->data_p + 8 + ((iff->iff_chunk_len + 1) & ~1);
+		if (!strncmp ((char *)iff->data_p, name, 4))
 			return;
 	}
 }
 
-static void FindChunk (char *name)
-{
-	last_chunk = iff_data;
-	FindNextChunk (name);
-}
-
-static void DumpChunks (void)
+static void FindChunk (iff_t *iff, char *name)
 {
-#if 0
-	char str[5];
-
-	str[4] = 0;
-	data_p = iff_data;
-	do
-	{
-		memcpy (str, data_p, 4);
-		data_p += 4;
-		iff_chunk_len = GetLittleLong ();
-		Con_Printf ("0x%x : %sfx (%d)\n", (uintptr_t)(data_p - 4), str, iff_chunk_len);
-		data_p += (iff_chunk_len + 1) & ~1;
-	} while (data_p < iff_end);
-#endif
+	iff->last_chunk = iff->iff_data;
+	FindNextChunk (iff, name);
 }
 
-static wavinfo_t GetWavinfo (char *name, byte *wav, int wavlength)
+static wavinfo_t GetWavinfo (wavload_t *w)
 {
 	wavinfo_t info;
+	iff_t iff;
 	int i;
 	int format;
 	int samples;
 
 	memset (&info, 0, sizeof (info));
 
-	if (!wav)
+	if (!w->data)
 		return info;
 
-	iff_data = wav;
-	iff_end = wav + wavlength;
+	iff.iff_data = w->data;
+	iff.iff_end = w->data + w->len;
 
 	// find "RIFF" chunk
-	FindChunk ("RIFF");
-	if (!(data_p && !strncmp (data_p + 8, "WAVE", 4)))
+	FindChunk (&iff, "RIFF");
+	if (!(iff.data_p && !strncmp ((char *)iff.data_p + 8, "WAVE", 4)))
 	{
-		Con_Printf ("Missing RIFF/WAVE chunks\n");
+		w->error = "Missing RIFF/WAVE chunks";
 		return info;
 	}
 
 	// get "fmt " chunk
-	iff_data = data_p + 12;
-	DumpChunks ();
+	iff.iff_data = iff.data_p + 12;
 
-	FindChunk ("fmt ");
-	if (!data_p)
+	FindChunk (&iff, "fmt ");
+	if (!iff.data_p)
 	{
-		Con_Printf ("Missing fmt chunk\n");
+		w->error = "Missing fmt chunk";
 		return info;
 	}
-	data_p += 8;
-	format = GetLittleShort ();
+	iff.data_p += 8;
+	format = GetLittleShort (&iff);
 	if (format != 1)
 	{
-		Con_Printf ("Microsoft PCM format only\n");
+		w->error = "Microsoft PCM format only";
 		return info;
 	}
 
-	info.channels = GetLittleShort ();
-	info.rate = GetLittleLong ();
-	data_p += 4 + 2;
-	info.width = GetLittleShort () / 8;
+	info.channels = GetLittleShort (&iff);
+	info.rate = GetLittleLong (&iff);
+	iff.data_p += 4 + 2;
+	info.width = GetLittleShort (&iff) / 8;
 
 	// get cue chunk
-	FindChunk ("cue ");
-	if (data_p)
+	FindChunk (&iff, "cue ");
+	if (iff.data_p)
 	{
-		data_p += 32;
-		info.loopstart = GetLittleLong ();
-		//		Con_Printf("loopstart=%d\n", sfx->loopstart);
+		iff.data_p += 32;
+		info.loopstart = GetLittleLong (&iff);
 
 		// if the next chunk is a LIST chunk, look for a cue length marker
-		FindNextChunk ("LIST");
-		if (data_p)
+		FindNextChunk (&iff, "LIST");
+		if (iff.data_p)
 		{
-			if (!strncmp (data_p + 28, "mark", 4))
+			if (!strncmp ((char *)iff.data_p + 28, "mark", 4))
 			{ // this is not a proper parse, but it works with cooledit...
-				data_p += 24;
-				i = GetLittleLong (); // samples in loop
+				iff.data_p += 24;
+				i = GetLittleLong (&iff); // samples in loop
 				info.samples = info.loopstart + i;
-				//				Con_Printf("looped length: %i\n", i);
 			}
 		}
 	}
@@ -184,25 +193,29 @@ static wavinfo_t GetWavinfo (char *name, byte *wav, int wavlength)
 		info.loopstart = -1;
 
 	// find data chunk
-	FindChunk ("data");
-	if (!data_p)
+	FindChunk (&iff, "data");
+	if (!iff.data_p)
 	{
-		Con_Printf ("Missing data chunk\n");
+		w->error = "Missing data chunk";
 		return info;
 	}
 
-	data_p += 4;
-	samples = GetLittleLong () / info.width;
+	iff.data_p += 4;
+	samples = GetLittleLong (&iff) / info.width;
 
 	if (info.samples)
 	{
 		if (samples < info.samples)
-			Sys_Error ("Sound %sfx has a bad loop length", name);
+		{
+			w->badloop = true;
+			info.channels = 0;
+			return info;
+		}
 	}
 	else
 		info.samples = samples;
 
-	info.dataofs = data_p - wav;
+	info.dataofs = iff.data_p - w->data;
 
 	return info;
 }
@@ -255,51 +268,204 @@ static byte *ResampleSfx (sfx_t *sfx, int inrate, int inwidth, int outrate, byte
 	return resampled;
 }
 
-bool S_LoadSound (sfx_t *sfx)
+/*
+==================
+S_OpenWav
+==================
+*/
+static bool S_OpenWav (char *name, wavload_t *w)
 {
-	// load it in
 	char filename[256];
+
+	memset (w, 0, sizeof (*w));
+	strcpy (w->name, name);
+
 	strcpy (filename, "sound/");
-	strcat (filename, sfx->name);
+	strcat (filename, name);
 
-	byte *data = COM_LoadTempFile (filename);
-	if (!data)
-		return false;
+	w->data = COM_MapFile (filename, &w->len);
+	return w->data != NULL;
+}
 
-	wavinfo_t info = GetWavinfo (sfx->name, data, com_filesize);
-	if (info.channels != 1)
-		return false;
+/*
+==================
+S_DecodeWav
 
-	float stepscale = (float)info.rate / snd_speed;
-	int len = info.samples / stepscale;
+Parses and resamples a sound, safe to run on a worker thread
+==================
+*/
+static void S_DecodeWav (void *arg)
+{
+	wavload_t *w = arg;
+	wavinfo_t info;
+	sfx_t *sfx = &w->sfx;
 
-	len = len * info.width * info.channels;
+	w->crc = CRC32_Block (0, w->data, w->len);
 
-	sfx->length = info.samples;
-	sfx->loopstart = info.loopstart;
-	sfx->speed = info.rate;
-	sfx->width = info.width;
-	sfx->stereo = false;
-	sfx->duration = (float)sfx->length / sfx->speed;
+	info = GetWavinfo (w);
+	if (info.channels == 1)
+	{
+		sfx->length = info.samples;
+		sfx->loopstart = info.loopstart;
+		sfx->speed = info.rate;
+		sfx->width = info.width;
+		sfx->stereo = false;
+
+		w->resampled = ResampleSfx (sfx, sfx->speed, sfx->width, snd_speed, w->data + info.dataofs);
+	}
 
-	byte *resampled = ResampleSfx (sfx, sfx->speed, sfx->width, snd_speed, data + info.dataofs);
+	atomic_store (&w->done, true);
+}
+
+/*
+==================
+S_UploadWav
+
+Hands a decoded sound to openal and releases the file
+==================
+*/
+static bool S_UploadWav (sfx_t *sfx, wavload_t *w)
+{
+	int format, len, len2;
+
+	while (!atomic_load (&w->done))
+	{
+		if (!Task_RunOne ())
+			Task_Wait ();
+	}
+
+	COM_UnmapFile (w->data);
+	w->data = NULL;
+
+	if (w->badloop)
+		Sys_Error ("Sound %s has a bad loop length", w->name);
+	if (w->error)
+		Con_Printf ("%s\n", w->error);
+	if (!w->resampled)
+		return false;
+
+	sfx->crc = w->crc;
+	sfx->length = w->sfx.length;
+	sfx->loopstart = w->sfx.loopstart;
+	sfx->speed = w->sfx.speed;
+	sfx->width = w->sfx.width;
+	sfx->stereo = w->sfx.stereo;
+	sfx->duration = (float)sfx->length / sfx->speed;
 
-	int format;
 	if (sfx->width == 2)
 		format = sfx->stereo ? AL_FORMAT_STEREO16 : AL_FORMAT_MONO16;
 	else
 		format = sfx->stereo ? AL_FORMAT_STEREO8 : AL_FORMAT_MONO8;
 
 	len = sfx->length * sfx->width * (1 + sfx->stereo);
-	alBufferData (sfx->al_buffers[0], format, resampled, len, sfx->speed);
+	alBufferData (sfx->al_buffers[0], format, w->resampled, len, sfx->speed);
 
 	if (sfx->loopstart != -1)
 	{
-		int len2 = (sfx->length - sfx->loopstart) * sfx->width * (1 + sfx->stereo);
-		alBufferData (sfx->al_buffers[1], format, resampled + (len - len2), len2, sfx->speed);
+		len2 = (sfx->length - sfx->loopstart) * sfx->width * (1 + sfx->stereo);
+		alBufferData (sfx->al_buffers[1], format, w->resampled + (len - len2), len2, sfx->speed);
 	}
 
-	free (resampled);
+	free (w->resampled);
+	w->resampled = NULL;
 
 	return true;
-}
\ No newline at end of file
+}
+
+static wavload_t *S_FindPreload (char *name)
+{
+	int i, j;
+
+	for (i = 0; i < wav_numpreload; i++)
+	{
+		j = (wav_nextpreload + i) % wav_numpreload;
+		if (!strcmp (wav_preload[j].name, name))
+		{
+			wav_nextpreload = j + 1;
+			return &wav_preload[j];
+		}
+	}
+
+	return NULL;
+}
+
+/*
+==================
+S_PreloadSounds
+
+Starts decoding a list of sounds on the worker threads.  S_LoadSound picks
+them up as they are precached
+==================
+*/
+void S_PreloadSounds (char **names, int count)
+{
+	int i;
+
+	S_ReleasePreload ();
+
+	if (!count)
+		return;
+
+	// inflate any compressed ones first
+	COM_PrefetchFiles ("sound/", names, count);
+
+	wav_preload = Z_Malloc (count * sizeof (*wav_preload));
+	for (i = 0; i < count; i++)
+	{
+		if (S_OpenWav (names[i], &wav_preload[wav_numpreload]))
+			wav_numpreload++;
+	}
+
+	for (i = 0; i < wav_numpreload; i++)
+		Task_Add (S_DecodeWav, &wav_preload[i]);
+}
+
+/*
+==================
+S_ReleasePreload
+
+Frees whatever S_PreloadSounds decoded that wasn't used
+==================
+*/
+void S_ReleasePreload (void)
+{
+	int i;
+
+	if (!wav_preload)
+		return;
+
+	Task_Wait ();
+
+	for (i = 0; i < wav_numpreload; i++)
+	{
+		if (wav_preload[i].data)
+			COM_UnmapFile (wav_preload[i].data);
+		free (wav_preload[i].resampled);
+	}
+
+	Z_Free (wav_preload);
+	wav_preload = NULL;
+	wav_numpreload = 0;
+	wav_nextpreload = 0;
+
+	COM_ReleasePrefetch ();
+}
+
+bool S_LoadSound (sfx_t *sfx)
+{
+	wavload_t *w, load;
+
+	w = S_FindPreload (sfx->name);
+	if (w && !w->data)
+		w = NULL; // already used, it's loading again
+
+	if (!w)
+	{
+		w = &load;
+		if (!S_OpenWav (sfx->name, w))
+			return false;
+		S_DecodeWav (w);
+	}
+
+	return S_UploadWav (sfx, w);
+}
@@ -407,6 +407,7 @@ void CL_Record_f (void)
 		Con_Printf ("ERROR: couldn't open.\n");
 		return;
 	}
+	COM_FileWritten (name);
 
 	Con_Printf ("recording to %s.\n", name);
 	cls.demorecording = true;
@@ -703,6 +704,7 @@ void CL_ReRecord_f (void)
 		Con_Printf ("ERROR: couldn't open.\n");
 		return;
 	}
+	COM_FileWritten (name);
 
 	Con_Printf ("recording to %s.\n", name);
 	cls.demorecording = true;
@@ -711,24 +713,9 @@ void CL_ReRecord_f (void)
 	CL_BeginServerConnect ();
 }
 
-/*
-====================
-CL_PlayDemo_f
-
-play [demoname]
-====================
-*/
-void CL_PlayDemo_f (void)
+static void CL_PlayDemo (char *demoname)
 {
 	char name[256];
-	int c;
-	bool neg = false;
-
-	if (Cmd_Argc () != 2)
-	{
-		Con_Printf ("play <demoname> : plays a demo\n");
-		return;
-	}
 
 	//
 	// disconnect from server
@@ -738,7 +725,7 @@ void CL_PlayDemo_f (void)
 	//
 	// open the demo file
 	//
-	strcpy (name, Cmd_Argv (1));
+	strcpy (name, demoname);
 	COM_DefaultExtension (name, ".qwd");
 
 	Con_Printf ("Playing demo from %s.\n", name);
@@ -756,6 +743,254 @@ void CL_PlayDemo_f (void)
 	host_time = 0;
 }
 
+/*
+====================
+CL_PlayDemo_f
+
+play [demoname]
+====================
+*/
+void CL_PlayDemo_f (void)
+{
+	if (Cmd_Argc () != 2)
+	{
+		Con_Printf ("play <demoname> : plays a demo\n");
+		return;
+	}
+
+	CL_PlayDemo (Cmd_Argv (1));
+}
+
+/*
+==============================================================================
+
+TIMEDEMO STATISTICS
+
+every timed frame the time spent in each phase of the host frame is kept, so
+the finished run can report percentiles and write the frames out as csv.
+timedemo takes a list of demos, which are run back to back and summed up in
+a table at the end
+==============================================================================
+*/
+
+#define MAX_TIMEDEMOS 16
+
+enum
+{
+	st_min,
+	st_avg,
+	st_p1,
+	st_p99,
+	st_max,
+	NUM_STATS
+};
+
+typedef struct
+{
+	float time[NUM_TD_PHASES]; // milliseconds
+} tdframe_t;
+
+typedef struct
+{
+	char name[MAX_QPATH];
+	int frames;
+	float seconds;
+	float stats[NUM_STATS]; // of the whole frame
+} tdresult_t;
+
+static char *td_phasenames[NUM_TD_PHASES] = {
+	"total",
+	"input",
+	"parse",
+	"predict",
+	"render",
+	"sound",
+};
+
+cvar_t cl_timedemocsv = {"cl_timedemocsv", "0"};
+
+static tdframe_t *td_frames;
+static int td_numframes, td_maxframes;
+
+static double td_framestart;
+static double td_frametime[NUM_TD_PHASES];
+
+static char td_demos[MAX_TIMEDEMOS][MAX_QPATH];
+static tdresult_t td_results[MAX_TIMEDEMOS];
+static int td_numdemos, td_current;
+static bool td_startnext;
+
+static void CL_StartTimeDemo (char *name);
+
+void CL_TimeDemoBeginFrame (void)
+{
+	memset (td_frametime, 0, sizeof (td_frametime));
+	td_framestart = Sys_FloatTime ();
+}
+
+/*
+====================
+CL_TimeDemoAdd
+
+Charges time to a phase of the current frame
+====================
+*/
+void CL_TimeDemoAdd (tdphase_e phase, double seconds)
+{
+	td_frametime[phase] += seconds;
+}
+
+/*
+====================
+CL_TimeDemoEndFrame
+
+Keeps the frame if a timedemo is being timed, and starts the next demo of a
+list once the last one has finished
+====================
+*/
+void CL_TimeDemoEndFrame (void)
+{
+	int i;
+
+	// the frame the timing started in doesn't count
+	if (cls.timedemo && cls.td_starttime && host_framecount != cls.td_startframe)
+	{
+		td_frametime[td_total] = Sys_FloatTime () - td_framestart;
+
+		if (td_numframes == td_maxframes)
+		{
+			td_maxframes = td_maxframes ? td_maxframes * 2 : 4096;
+			td_frames = Z_Realloc (td_frames, td_maxframes * sizeof (*td_frames));
+		}
+
+		for (i = 0; i < NUM_TD_PHASES; i++)
+			td_frames[td_numframes].time[i] = td_frametime[i] * 1000.0;
+		td_numframes++;
+	}
+
+	if (td_startnext)
+	{
+		td_startnext = false;
+		CL_StartTimeDemo (td_demos[td_current]);
+	}
+}
+
+static int CL_TimeDemoCompare (const void *a, const void *b)
+{
+	float fa = *(const float *)a;
+	float fb = *(const float *)b;
+
+	return (fa > fb) - (fa < fb);
+}
+
+static void CL_TimeDemoStats (int phase, float *sorted, float *stats)
+{
+	int i, n;
+	double total;
+
+	n = td_numframes;
+	if (!n)
+	{
+		memset (stats, 0, NUM_STATS * sizeof (*stats));
+		return;
+	}
+
+	total = 0;
+	for (i = 0; i < n; i++)
+	{
+		sorted[i] = td_frames[i].time[phase];
+		total += sorted[i];
+	}
+	qsort (sorted, n, sizeof (*sorted), CL_TimeDemoCompare);
+
+	stats[st_min] = sorted[0];
+	stats[st_avg] = total / n;
+	stats[st_p1] = sorted[(n - 1) * 1 / 100];
+	stats[st_p99] = sorted[(n - 1) * 99 / 100];
+	stats[st_max] = sorted[n - 1];
+}
+
+static FILE *CL_TimeDemoOpenCSV (char *name)
+{
+	char path[MAX_OSPATH];
+	FILE *f;
+
+	sprintf (path, "%s/%s", com_gamedir, name);
+	f = fopen (path, "w");
+	if (f)
+	{
+		COM_FileWritten (path);
+		Con_Printf ("Writing %s.\n", path);
+	}
+	else
+		Con_Printf ("ERROR: couldn't open %s.\n", path);
+
+	return f;
+}
+
+// every timed frame, one line each
+static void CL_TimeDemoWriteFrames (char *demoname)
+{
+	char base[MAX_QPATH];
+	FILE *f;
+	int i, j;
+
+	COM_FileBase (demoname, base);
+	f = CL_TimeDemoOpenCSV (va ("timedemo_%s.csv", base));
+	if (!f)
+		return;
+
+	fprintf (f, "frame");
+	for (i = 0; i < NUM_TD_PHASES; i++)
+		fprintf (f, ",%s", td_phasenames[i]);
+	fprintf (f, "\n");
+
+	for (i = 0; i < td_numframes; i++)
+	{
+		fprintf (f, "%i", i);
+		for (j = 0; j < NUM_TD_PHASES; j++)
+			fprintf (f, ",%.4f", td_frames[i].time[j]);
+		fprintf (f, "\n");
+	}
+
+	fclose (f);
+}
+
+/*
+====================
+CL_TimeDemoSummary
+
+One line per demo of the list that was just run
+====================
+*/
+static void CL_TimeDemoSummary (void)
+{
+	tdresult_t *r;
+	FILE *f;
+	int i;
+
+	f = NULL;
+	if (cl_timedemocsv.value)
+	{
+		f = CL_TimeDemoOpenCSV ("timedemo_summary.csv");
+		if (f)
+			fprintf (f, "demo,frames,seconds,fps,min,avg,p1,p99,max\n");
+	}
+
+	Con_Printf ("demo             frames    fps     min     avg      p1     p99 (ms)\n");
+	for (i = 0, r = td_results; i < td_numdemos; i++, r++)
+	{
+		Con_Printf ("%-16s %6i %6.1f %7.2f %7.2f %7.2f %7.2f\n", r->name, r->frames, r->frames / r->seconds, r->stats[st_min], r->stats[st_avg],
+					r->stats[st_p1], r->stats[st_p99]);
+		if (f)
+			fprintf (f, "%s,%i,%.3f,%.2f,%.4f,%.4f,%.4f,%.4f,%.4f\n", r->name, r->frames, r->seconds, r->frames / r->seconds, r->stats[st_min],
+					 r->stats[st_avg], r->stats[st_p1], r->stats[st_p99], r->stats[st_max]);
+	}
+
+	if (f)
+		fclose (f);
+}
+
 /*
 ====================
 CL_FinishTimeDemo
@@ -766,6 +1001,9 @@ static void CL_FinishTimeDemo (void)
 {
 	int frames;
 	float time;
+	float *sorted, stats[NUM_STATS];
+	tdresult_t *r;
+	int i;
 
 	cls.timedemo = false;
 
@@ -775,33 +1013,92 @@ static void CL_FinishTimeDemo (void)
 	if (!time)
 		time = 1;
 	Con_Printf ("%i frames %5.1f seconds %5.1f fps\n", frames, time, frames / time);
+
+	sorted = Z_Malloc (td_numframes * sizeof (*sorted) + 1);
+
+	r = &td_results[td_current];
+	COM_FileBase (td_demos[td_current], r->name);
+	r->frames = frames;
+	r->seconds = time;
+
+	Con_Printf ("phase        min      avg       p1      p99      max (ms)\n");
+	for (i = 0; i < NUM_TD_PHASES; i++)
+	{
+		CL_TimeDemoStats (i, sorted, stats);
+		Con_Printf ("%-8s %8.3f %8.3f %8.3f %8.3f %8.3f\n", td_phasenames[i], stats[st_min], stats[st_avg], stats[st_p1], stats[st_p99], stats[st_max]);
+		if (i == td_total)
+			memcpy (r->stats, stats, sizeof (stats));
+	}
+
+	Z_Free (sorted);
+
+	if (cl_timedemocsv.value)
+		CL_TimeDemoWriteFrames (td_demos[td_current]);
+
+	// the next one can't be started from inside the packet reading
+	td_current++;
+	if (td_current < td_numdemos)
+		td_startnext = true;
+	else if (td_numdemos > 1 || cl_timedemocsv.value)
+		CL_TimeDemoSummary ();
+}
+
+static void CL_StartTimeDemo (char *name)
+{
+	td_numframes = 0;
+
+	CL_PlayDemo (name);
+
+	if (cls.state != ca_demostart)
+	{
+		td_numdemos = 0; // give up on the rest of the list
+		return;
+	}
+
+	// cls.td_starttime will be grabbed at the second frame of the demo, so
+	// all the loading time doesn't get counted
+
+	cls.timedemo = true;
+	cls.td_starttime = 0;
+	cls.td_startframe = host_framecount;
+	cls.td_lastframe = -1; // get a new message this frame
 }
 
 /*
 ====================
 CL_TimeDemo_f
 
-timedemo [demoname]
+timedemo <demoname> [demoname...]
 ====================
 */
 void CL_TimeDemo_f (void)
 {
-	if (Cmd_Argc () != 2)
+	int i;
+
+	if (Cmd_Argc () < 2)
 	{
-		Con_Printf ("timedemo <demoname> : gets demo speeds\n");
+		Con_Printf ("timedemo <demoname> [demoname...] : gets demo speeds\n");
 		return;
 	}
 
-	CL_PlayDemo_f ();
+	// finish whatever is playing before its list is replaced
+	CL_Disconnect ();
 
-	if (cls.state != ca_demostart)
-		return;
+	td_numdemos = Cmd_Argc () - 1;
+	if (td_numdemos > MAX_TIMEDEMOS)
+	{
+		Con_Printf ("only timing the first %i demos\n", MAX_TIMEDEMOS);
+		td_numdemos = MAX_TIMEDEMOS;
+	}
 
-	// cls.td_starttime will be grabbed at the second frame of the demo, so
-	// all the loading time doesn't get counted
+	for (i = 0; i < td_numdemos; i++)
+	{
+		strncpy (td_demos[i], Cmd_Argv (i + 1), sizeof (td_demos[i]) - 1);
+		td_demos[i][sizeof (td_demos[i]) - 1] = 0;
+	}
 
-	cls.timedemo = true;
-	cls.td_starttime = 0;
-	cls.td_startframe = host_framecount;
-	cls.td_lastframe = -1; // get a new message this frame
+	td_current = 0;
+	td_startnext = false;
+
+	CL_StartTimeDemo (td_demos[0]);
 }
@@ -803,7 +803,7 @@ static void CL_LinkPlayers (void)
 			break; // object list is full
 		ent = &cl_visedicts[cl_numvisedicts];
 		cl_numvisedicts++;
-		ent->keynum = 0;
+		ent->keynum = j + 1; // the edict number
 
 		ent->model = cl.model_precache[state->modelindex];
 		ent->cmodel = cl.cmodel_precache[state->modelindex];
@@ -837,6 +837,7 @@ void CL_Init (void)
 	Cvar_RegisterVariable (src_client, &rate);
 	Cvar_RegisterVariable (src_client, &msg);
 	Cvar_RegisterVariable (src_client, &noaim);
+	Cvar_RegisterVariable (src_client, &cl_timedemocsv);
 
 	Cmd_AddCommand (src_client, "changing", CL_Changing_f);
 	Cmd_AddCommand (src_client, "disconnect", CL_Disconnect_f);
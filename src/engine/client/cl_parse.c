@@ -67,20 +67,14 @@ to start a download from the server.
 */
 bool CL_CheckOrDownloadFile (char *filename)
 {
-	FILE *f;
-
 	if (strstr (filename, ".."))
 	{
 		Con_Printf ("Refusing to download a path with ..\n");
 		return true;
 	}
 
-	COM_FOpenFile (filename, &f);
-	if (f)
-	{ // it exists, no need to download
-		fclose (f);
-		return true;
-	}
+	if (COM_FileExists (filename))
+		return true; // it exists, no need to download
 
 	//ZOID - can't download when recording
 	if (cls.demorecording)
@@ -112,7 +106,8 @@ bool CL_CheckOrDownloadFile (char *filename)
 static void Model_NextDownload (void)
 {
 	char *s;
-	int i;
+	int i, n;
+	char *names[MAX_MODELS];
 	extern char gamedirfile[];
 
 	if (cls.downloadnumber == 0)
@@ -131,6 +126,12 @@ static void Model_NextDownload (void)
 			return; // started a download
 	}
 
+	// inflate any compressed models together
+	for (i = 1, n = 0; i < MAX_MODELS && cl.model_name[i][0]; i++)
+		if (cl.model_name[i][0] != '*')
+			names[n++] = cl.model_name[i];
+	COM_PrefetchFiles ("", names, n);
+
 	for (i = 1; i < MAX_MODELS; i++)
 	{
 		if (!cl.model_name[i][0])
@@ -145,11 +146,14 @@ static void Model_NextDownload (void)
 			Con_Printf ("You may need to download or purchase a %s client "
 						"pack in order to play on this server.\n\n",
 						gamedirfile);
+			COM_ReleasePrefetch ();
 			CL_Disconnect ();
 			return;
 		}
 	}
 
+	COM_ReleasePrefetch ();
+
 	CL_InitTEnts ();
 
 	// all done
@@ -165,7 +169,8 @@ static void Model_NextDownload (void)
 static void Sound_NextDownload (void)
 {
 	char *s;
-	int i;
+	int n;
+	char *names[MAX_SOUNDS];
 
 	if (cls.downloadnumber == 0)
 	{
@@ -181,12 +186,9 @@ static void Sound_NextDownload (void)
 			return; // started a download
 	}
 
-	for (i = 1; i < MAX_SOUNDS; i++)
-	{
-		if (!cl.sound_name[i][0])
-			break;
-		cl.sound_precache[i] = S_PrecacheSound (cl.sound_name[i]);
-	}
+	for (n = 0; n + 1 < MAX_SOUNDS && cl.sound_name[n + 1][0]; n++)
+		names[n] = cl.sound_name[n + 1];
+	S_PrecacheSounds (names, n, cl.sound_precache + 1);
 
 	// done with sounds, request models now
 	memset (cl.model_precache, 0, sizeof (cl.model_precache));
@@ -311,6 +313,9 @@ static void CL_ParseDownload (void)
 				Con_Printf ("failed to rename.\n");
 		}
 
+		// the file can be found now
+		COM_FlushFileIndex ();
+
 		cls.download = NULL;
 		cls.downloadpercent = 0;
 
@@ -345,6 +345,19 @@ char *Key_KeynumToString (int keynum);
 //
 // cl_demo.c
 //
+typedef enum
+{
+	td_total, // the whole host frame
+	td_input,
+	td_parse,
+	td_predict,
+	td_render,
+	td_sound,
+	NUM_TD_PHASES,
+} tdphase_e;
+
+extern cvar_t cl_timedemocsv;
+
 void CL_StopPlayback (void);
 bool CL_GetMessage (void);
 void CL_WriteDemoCmd (usercmd_t *pcmd);
@@ -354,6 +367,9 @@ void CL_Record_f (void);
 void CL_ReRecord_f (void);
 void CL_PlayDemo_f (void);
 void CL_TimeDemo_f (void);
+void CL_TimeDemoBeginFrame (void);
+void CL_TimeDemoEndFrame (void);
+void CL_TimeDemoAdd (tdphase_e phase, double seconds);
 
 //
 // cl_parse.c
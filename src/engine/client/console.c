@@ -174,6 +174,7 @@ void Con_Init (void)
 #define MAXGAMEDIRLEN 1000
 	char temp[MAXGAMEDIRLEN + 1];
 	char *t2 = "/qconsole.log";
+	FILE *f;
 
 	con_debuglog = COM_CheckParm ("-condebug");
 
@@ -182,7 +183,9 @@ void Con_Init (void)
 		if (strlen (com_gamedir) < (MAXGAMEDIRLEN - strlen (t2)))
 		{
 			sprintf (temp, "%s%s", com_gamedir, t2);
-			unlink (temp);
+			f = fopen (temp, "w");
+			if (f)
+				Log_SetFile (LOG_CONSOLE, f);
 		}
 	}
 
@@ -294,20 +297,6 @@ void Con_Print (char *txt)
 	}
 }
 
-static void Con_DebugLog (char *file, char *fmt, ...)
-{
-	va_list argptr;
-	static char data[1024];
-	int fd;
-
-	va_start (argptr, fmt);
-	vsprintf (data, fmt, argptr);
-	va_end (argptr);
-	fd = open (file, O_WRONLY | O_CREAT | O_APPEND, 0666);
-	write (fd, data, strlen (data));
-	close (fd);
-}
-
 extern redirect_t sv_redirected;
 extern char outputbuf[8000];
 
@@ -343,7 +332,7 @@ void Con_Printf (char *fmt, ...)
 
 	// log all messages to file
 	if (con_debuglog)
-		Con_DebugLog (va ("%s/qconsole.log", com_gamedir), "%s", msg);
+		Log_Write (LOG_CONSOLE, msg);
 
 	if (!con_initialized)
 		return;
@@ -20,6 +20,10 @@ along with this program.  If not, see <https://www.gnu.org/licenses/>.
 
 #include "clientdef.h"
 
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
 cvar_t gl_max_size = {"gl_max_size", "2048"};
 
 qpic_t *draw_disc;
@@ -50,6 +54,7 @@ typedef struct
 	char identifier[64];
 	int width, height;
 	bool mipmap;
+	bool pending; // queued in a batch, brightnum isn't settled yet
 } gltexture_t;
 
 #define MAX_GLTEXTURES 1024
@@ -128,7 +133,7 @@ static int Scrap_AllocBlock (int w, int h, int *x, int *y)
 	Sys_Error ("Scrap_AllocBlock: full");
 }
 
-static void GL_Upload8 (int *, int *, byte *, int, int, byte *, int, int, bool, bool);
+static void GL_Upload8 (int *, int *, byte *, int, int, byte *, int, int, bool, bool, gltexture_t *);
 
 static void Scrap_Upload (void)
 {
@@ -138,7 +143,7 @@ static void Scrap_Upload (void)
 	for (texnum = 0; texnum < MAX_SCRAPS; texnum++)
 	{
 		scrapnum = scrap_texnum + texnum;
-		GL_Upload8 (&scrapnum, NULL, scrap_texels[texnum], BLOCK_WIDTH, BLOCK_HEIGHT, (byte *)d_8to24table, 4, 256, false, true);
+		GL_Upload8 (&scrapnum, NULL, scrap_texels[texnum], BLOCK_WIDTH, BLOCK_HEIGHT, (byte *)d_8to24table, 4, 256, false, true, NULL);
 	}
 	scrap_dirty = false;
 }
@@ -628,26 +633,32 @@ void GL_Set2D (void)
 
 static void GL_ResampleTexture (unsigned int *in, int inwidth, int inheight, unsigned int *out, int outwidth, int outheight)
 {
-	int i, j;
+	int i, j, row, lastrow;
 	unsigned int *inrow;
 	unsigned int frac, fracstep;
 
 	fracstep = inwidth * 0x10000 / outwidth;
+	lastrow = -1;
 	for (i = 0; i < outheight; i++, out += outwidth)
 	{
-		inrow = in + inwidth * (i * inheight / outheight);
-		frac = fracstep >> 1;
-		for (j = 0; j < outwidth; j += 4)
+		row = i * inheight / outheight;
+		if (row == lastrow)
+		{ // stretched, same as the row above
+			memcpy (out, out - outwidth, outwidth * sizeof (*out));
+			continue;
+		}
+		lastrow = row;
+		inrow = in + inwidth * row;
+
+		if (inwidth == outwidth)
 		{
-			out[j] = inrow[frac >> 16];
-			frac += fracstep;
-			out[j + 1] = inrow[frac >> 16];
-			frac += fracstep;
-			out[j + 2] = inrow[frac >> 16];
-			frac += fracstep;
-			out[j + 3] = inrow[frac >> 16];
-			frac += fracstep;
+			memcpy (out, inrow, outwidth * sizeof (*out));
+			continue;
 		}
+
+		frac = fracstep >> 1;
+		for (j = 0; j < outwidth; j++, frac += fracstep)
+			out[j] = inrow[frac >> 16];
 	}
 }
 
@@ -655,74 +666,158 @@ static void GL_ResampleTexture (unsigned int *in, int inwidth, int inheight, uns
 ================
 GL_MipMap
 
-Operates in place, quartering the size of the texture
+Writes the next level down, a quarter of the size of the texture, to out
 ================
 */
-static void GL_MipMap (byte *in, int width, int height)
+static void GL_MipMap (byte *in, byte *out, int width, int height)
 {
-	int i, j;
-	byte *out;
+	int i, j, rowbytes;
+	byte *next;
 
-	width <<= 2;
+	if (width == 1 || height == 1)
+	{ // only halves one way
+		for (i = (width * height) >> 1; i > 0; i--, in += 8, out += 4)
+		{
+			out[0] = (in[0] + in[4]) >> 1;
+			out[1] = (in[1] + in[5]) >> 1;
+			out[2] = (in[2] + in[6]) >> 1;
+			out[3] = (in[3] + in[7]) >> 1;
+		}
+		return;
+	}
+
+	rowbytes = width << 2;
 	height >>= 1;
-	out = in;
-	for (i = 0; i < height; i++, in += width)
+	for (i = 0; i < height; i++, in += rowbytes)
 	{
-		for (j = 0; j < width; j += 8, out += 4, in += 8)
+		next = in + rowbytes;
+		j = 0;
+#ifdef __SSE2__
+		// eight pixels from each row make four
+		for (; j + 32 <= rowbytes; j += 32, in += 32, next += 32, out += 16)
+		{
+			__m128i zero, a, b, c, d, s0, s1, s2, s3;
+
+			zero = _mm_setzero_si128 ();
+			a = _mm_loadu_si128 ((__m128i *)in);
+			b = _mm_loadu_si128 ((__m128i *)(in + 16));
+			c = _mm_loadu_si128 ((__m128i *)next);
+			d = _mm_loadu_si128 ((__m128i *)(next + 16));
+
+			// two pixels each, the rows added
+			s0 = _mm_add_epi16 (_mm_unpacklo_epi8 (a, zero), _mm_unpacklo_epi8 (c, zero));
+			s1 = _mm_add_epi16 (_mm_unpackhi_epi8 (a, zero), _mm_unpackhi_epi8 (c, zero));
+			s2 = _mm_add_epi16 (_mm_unpacklo_epi8 (b, zero), _mm_unpacklo_epi8 (d, zero));
+			s3 = _mm_add_epi16 (_mm_unpackhi_epi8 (b, zero), _mm_unpackhi_epi8 (d, zero));
+
+			// then the pixels of each pair
+			s0 = _mm_add_epi16 (s0, _mm_srli_si128 (s0, 8));
+			s1 = _mm_add_epi16 (s1, _mm_srli_si128 (s1, 8));
+			s2 = _mm_add_epi16 (s2, _mm_srli_si128 (s2, 8));
+			s3 = _mm_add_epi16 (s3, _mm_srli_si128 (s3, 8));
+
+			s0 = _mm_srli_epi16 (_mm_unpacklo_epi64 (s0, s1), 2);
+			s2 = _mm_srli_epi16 (_mm_unpacklo_epi64 (s2, s3), 2);
+			_mm_storeu_si128 ((__m128i *)out, _mm_packus_epi16 (s0, s2));
+		}
+#endif
+		for (; j < rowbytes; j += 8, in += 8, next += 8, out += 4)
 		{
-			out[0] = (in[0] + in[4] + in[width + 0] + in[width + 4]) >> 2;
-			out[1] = (in[1] + in[5] + in[width + 1] + in[width + 5]) >> 2;
-			out[2] = (in[2] + in[6] + in[width + 2] + in[width + 6]) >> 2;
-			out[3] = (in[3] + in[7] + in[width + 3] + in[width + 7]) >> 2;
+			out[0] = (in[0] + in[4] + next[0] + next[4]) >> 2;
+			out[1] = (in[1] + in[5] + next[1] + next[5]) >> 2;
+			out[2] = (in[2] + in[6] + next[2] + next[6]) >> 2;
+			out[3] = (in[3] + in[7] + next[3] + next[7]) >> 2;
 		}
 	}
 }
 
-static void GL_Upload32 (unsigned int *data, int width, int height, bool mipmap, bool alpha)
+/*
+================
+GL_ScaledSize
+
+The size a texture goes up at, from gl_picmip and gl_max_size
+================
+*/
+static void GL_ScaledSize (int width, int height, int *scaled_width, int *scaled_height)
 {
-	unsigned int *scaled;
-	int scaled_width, scaled_height;
+	int w, h;
 
-	for (scaled_width = 1; scaled_width < width; scaled_width <<= 1);
-	for (scaled_height = 1; scaled_height < height; scaled_height <<= 1);
+	for (w = 1; w < width; w <<= 1);
+	for (h = 1; h < height; h <<= 1);
 
-	scaled_width >>= (int)gl_picmip.value;
-	scaled_height >>= (int)gl_picmip.value;
+	w >>= (int)gl_picmip.value;
+	h >>= (int)gl_picmip.value;
 
-	if (scaled_width > gl_max_size.value)
-		scaled_width = gl_max_size.value;
-	if (scaled_height > gl_max_size.value)
-		scaled_height = gl_max_size.value;
+	if (w > gl_max_size.value)
+		w = gl_max_size.value;
+	if (h > gl_max_size.value)
+		h = gl_max_size.value;
 
-	scaled = malloc (scaled_width * scaled_height * 4);
+	*scaled_width = w;
+	*scaled_height = h;
+}
+
+/*
+================
+GL_ScaleTexture
+
+Returns the texture at its scaled size, followed by every mip level down to
+1x1 if it is mipmapped.  Safe on the workers
+================
+*/
+static unsigned int *GL_ScaleTexture (unsigned int *data, int width, int height, int scaled_width, int scaled_height, bool mipmap)
+{
+	unsigned int *scaled, *level;
+	int size, w, h;
+
+	size = w = scaled_width;
+	size *= h = scaled_height;
+	while (mipmap && (w > 1 || h > 1))
+	{
+		w = w > 1 ? w >> 1 : 1;
+		h = h > 1 ? h >> 1 : 1;
+		size += w * h;
+	}
+
+	scaled = malloc (size * sizeof (*scaled));
 
 	if (scaled_width == width && scaled_height == height)
-		memcpy (scaled, data, width * height * 4);
+		memcpy (scaled, data, width * height * sizeof (*data));
 	else
 		GL_ResampleTexture (data, width, height, scaled, scaled_width, scaled_height);
 
-	glTexImage2D (GL_TEXTURE_2D, 0, GL_RGBA, scaled_width, scaled_height, 0, GL_RGBA, GL_UNSIGNED_BYTE, scaled);
-	if (mipmap)
+	level = scaled;
+	w = scaled_width;
+	h = scaled_height;
+	while (mipmap && (w > 1 || h > 1))
 	{
-		int miplevel;
+		GL_MipMap ((byte *)level, (byte *)(level + w * h), w, h);
+		level += w * h;
+		w = w > 1 ? w >> 1 : 1;
+		h = h > 1 ? h >> 1 : 1;
+	}
 
+	return scaled;
+}
+
+static void GL_UploadLevels (unsigned int *data, int width, int height, bool mipmap)
+{
+	int miplevel;
+
+	glTexImage2D (GL_TEXTURE_2D, 0, GL_RGBA, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, data);
+	if (mipmap)
+	{
 		miplevel = 0;
-		while (scaled_width > 1 || scaled_height > 1)
+		while (width > 1 || height > 1)
 		{
-			GL_MipMap ((byte *)scaled, scaled_width, scaled_height);
-			scaled_width >>= 1;
-			scaled_height >>= 1;
-			if (scaled_width < 1)
-				scaled_width = 1;
-			if (scaled_height < 1)
-				scaled_height = 1;
+			data += width * height;
+			width = width > 1 ? width >> 1 : 1;
+			height = height > 1 ? height >> 1 : 1;
 			miplevel++;
-			glTexImage2D (GL_TEXTURE_2D, miplevel, GL_RGBA, scaled_width, scaled_height, 0, GL_RGBA, GL_UNSIGNED_BYTE, scaled);
+			glTexImage2D (GL_TEXTURE_2D, miplevel, GL_RGBA, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, data);
 		}
 	}
 
-	free (scaled);
-
 	float aniso = 4.0;
 	float max_aniso;
 	glGetFloatv (GL_MAX_TEXTURE_MAX_ANISOTROPY, &max_aniso);
@@ -807,103 +902,215 @@ static void GL_ResampleAlphaTexture (unsigned int *data, int width, int height)
 	}
 }
 
-static void GL_Upload8 (int *gl_texturenum, int *gl_brightnum, byte *data, int width, int height, byte *pal, int bytes, int colors, bool mipmap, bool alpha)
+/*
+=============================================================================
+
+TEXTURE PREPARATION
+
+a texture is converted, scaled and mipmapped off to the side and only the
+gl calls are made on the main thread.  between GL_BeginTextureBatch and
+GL_EndTextureBatch the preparing is queued on the workers, so a model's
+textures are converted together while the earlier ones go up
+
+=============================================================================
+*/
+
+#define MAX_TEXTUREJOBS 64 // prepared ahead of the uploads
+
+typedef struct
 {
-	int i;
-	bool noalpha;
-	bool nobright = true;
-	int p;
+	// set up when it's queued, the data and palette have to stay put
+	byte *data;
+	byte *pal;
+	int width, height;
+	int bytes, colors;
+	bool mipmap, alpha;
+	int scaled_width, scaled_height;
+	int texnum;
+	int *brightnum; // cleared if there are no bright pixels
+	gltexture_t *glt;
 
-	int s = width * height;
+	// filled in by GL_PrepareTexture
+	unsigned int *pixels; // every level, one after another
+	unsigned int *bright; // NULL if there is no brightmap
+	atomic_bool done;
+} gltexjob_t;
 
-	if (s & 3)
-		Sys_Error ("GL_Upload8: s&3");
+static gltexjob_t gl_texjobs[MAX_TEXTUREJOBS];
+static int gl_firstjob, gl_numjobs;
+static bool gl_batching;
+
+static void GL_PrepareTexture (void *arg)
+{
+	gltexjob_t *job;
+	unsigned int table[256], brighttable[256];
+	unsigned int *remap;
+	byte *c;
+	int i, p, s;
+	bool bright;
+
+	job = arg;
+	s = job->width * job->height;
+
+	// the palette with alpha in, so each pixel is one lookup
+	for (p = 0; p < 256; p++)
+	{
+		c = (byte *)&table[p];
+		c[3] = (job->alpha && p == job->colors - 1) ? 0 : 255;
+		memcpy (c, job->pal + p * job->bytes, job->bytes);
+
+		brighttable[p] = table[p];
+		((byte *)&brighttable[p])[3] = p < 224 ? 0 : 255;
+	}
 
-	unsigned int *remap = malloc (s * 4 * 2);
-	unsigned int *brightmap = remap + s;
+	remap = malloc (s * sizeof (*remap));
+	for (i = 0; i < s; i++)
+		remap[i] = table[job->data[i]];
 
 	// if there are no transparent pixels, make it a 3 component
 	// texture even if it was specified as otherwise
-	if (alpha)
+	if (job->alpha)
 	{
-		noalpha = true;
+		job->alpha = false;
 		for (i = 0; i < s; i++)
 		{
-			p = data[i];
-			((byte *)&remap[i])[3] = 255;
-			if (p == (colors - 1))
+			if (job->data[i] == job->colors - 1)
 			{
-				noalpha = false;
-				((byte *)&remap[i])[3] = 0;
-			}
-			memcpy (remap + i, pal + p * bytes, bytes);
-
-			if (gl_brightnum != NULL)
-			{
-				brightmap[i] = remap[i];
-
-				if (p < 224)
-				{
-					((byte *)&brightmap[i])[3] = 0;
-				}
-				else
-				{
-					((byte *)&brightmap[i])[3] = 255;
-					nobright = false;
-				}
+				job->alpha = true;
+				break;
 			}
 		}
-
-		if (alpha && noalpha)
-			alpha = false;
 	}
-	else
+
+	bright = false;
+	if (job->brightnum)
 	{
 		for (i = 0; i < s; i++)
 		{
-			p = data[i];
-			((byte *)&remap[i])[3] = 255;
-			memcpy (remap + i, pal + p * bytes, bytes);
-
-			if (gl_brightnum != NULL)
+			if (job->data[i] >= 224)
 			{
-				brightmap[i] = remap[i];
-
-				if (p < 224)
-				{
-					((byte *)&brightmap[i])[3] = 0;
-				}
-				else
-				{
-					((byte *)&brightmap[i])[3] = 255;
-					nobright = false;
-				}
+				bright = true;
+				break;
 			}
 		}
 	}
 
-	if (alpha)
-		GL_ResampleAlphaTexture (remap, width, height);
+	job->bright = NULL;
+	if (bright)
+	{
+		unsigned int *brightmap = malloc (s * sizeof (*brightmap));
+
+		for (i = 0; i < s; i++)
+			brightmap[i] = brighttable[job->data[i]];
+		GL_ResampleAlphaTexture (brightmap, job->width, job->height);
+
+		job->bright = GL_ScaleTexture (brightmap, job->width, job->height, job->scaled_width, job->scaled_height, false);
+		free (brightmap);
+	}
+
+	if (job->alpha)
+		GL_ResampleAlphaTexture (remap, job->width, job->height);
 
-	GL_Bind (*gl_texturenum);
-	GL_Upload32 (remap, width, height, mipmap, alpha);
+	job->pixels = GL_ScaleTexture (remap, job->width, job->height, job->scaled_width, job->scaled_height, job->mipmap);
+	free (remap);
 
-	if (nobright)
+	atomic_store (&job->done, true);
+}
+
+static void GL_FinishTexture (gltexjob_t *job)
+{
+	// help with the queue until it's ready
+	while (!atomic_load (&job->done))
+		Task_RunOne ();
+
+	GL_Bind (job->texnum);
+	GL_UploadLevels (job->pixels, job->scaled_width, job->scaled_height, job->mipmap);
+
+	if (job->bright)
 	{
-		if (gl_brightnum != NULL)
-			*gl_brightnum = 0;
+		GL_Bind (*job->brightnum);
+		GL_UploadLevels (job->bright, job->scaled_width, job->scaled_height, false);
+
+		GL_Bind (job->texnum);
 	}
-	else
+	else if (job->brightnum)
+	{
+		*job->brightnum = 0;
+	}
+
+	if (job->glt)
 	{
-		GL_ResampleAlphaTexture (brightmap, width, height);
+		job->glt->brightnum = job->brightnum ? *job->brightnum : 0;
+		job->glt->pending = false;
+	}
+
+	free (job->pixels);
+	free (job->bright);
+}
+
+static void GL_FlushTextures (void)
+{
+	for (; gl_numjobs; gl_numjobs--, gl_firstjob = (gl_firstjob + 1) % MAX_TEXTUREJOBS)
+		GL_FinishTexture (&gl_texjobs[gl_firstjob]);
+}
+
+void GL_BeginTextureBatch (void)
+{
+	gl_batching = true;
+}
+
+void GL_EndTextureBatch (void)
+{
+	GL_FlushTextures ();
+	gl_batching = false;
+}
+
+static void GL_Upload8 (int *gl_texturenum, int *gl_brightnum, byte *data, int width, int height, byte *pal, int bytes, int colors, bool mipmap, bool alpha,
+						gltexture_t *glt)
+{
+	gltexjob_t *job, single;
 
-		GL_Bind (*gl_brightnum);
-		GL_Upload32 (brightmap, width, height, false, true);
+	if ((width * height) & 3)
+		Sys_Error ("GL_Upload8: s&3");
 
-		GL_Bind (*gl_texturenum);
+	if (gl_batching)
+	{
+		if (gl_numjobs == MAX_TEXTUREJOBS)
+		{ // the oldest goes up to make room
+			GL_FinishTexture (&gl_texjobs[gl_firstjob]);
+			gl_firstjob = (gl_firstjob + 1) % MAX_TEXTUREJOBS;
+			gl_numjobs--;
+		}
+		job = &gl_texjobs[(gl_firstjob + gl_numjobs) % MAX_TEXTUREJOBS];
+		gl_numjobs++;
+	}
+	else
+	{
+		job = &single;
 	}
 
-	free (remap);
+	job->data = data;
+	job->pal = pal;
+	job->width = width;
+	job->height = height;
+	job->bytes = bytes;
+	job->colors = colors;
+	job->mipmap = mipmap;
+	job->alpha = alpha;
+	GL_ScaledSize (width, height, &job->scaled_width, &job->scaled_height);
+	job->texnum = *gl_texturenum;
+	job->brightnum = gl_brightnum;
+	job->glt = glt;
+	atomic_init (&job->done, false);
+
+	if (gl_batching)
+	{
+		Task_Add (GL_PrepareTexture, job);
+		return;
+	}
+
+	GL_PrepareTexture (job);
+	GL_FinishTexture (job);
 }
 
 void GL_LoadTexture (int *gl_texturenum, int *gl_brightnum, char *identifier, int width, int height, byte *data, int bytes, int colors, byte *pal, bool mipmap,
@@ -922,6 +1129,9 @@ void GL_LoadTexture (int *gl_texturenum, int *gl_brightnum, char *identifier, in
 				if (width != glt->width || height != glt->height)
 					Sys_Error ("GL_LoadTexture: cache mismatch");
 
+				if (glt->pending)
+					GL_FlushTextures ();
+
 				(*gl_texturenum) = gltextures[i].texnum;
 
 				if (gl_brightnum != NULL)
@@ -951,10 +1161,10 @@ void GL_LoadTexture (int *gl_texturenum, int *gl_brightnum, char *identifier, in
 		texture_extension_number++;
 	}
 
-	GL_Upload8 (gl_texturenum, gl_brightnum, data, width, height, pal, bytes, colors, mipmap, alpha);
-
 	glt->texnum = (*gl_texturenum);
-	glt->brightnum = (gl_brightnum != NULL) ? (*gl_brightnum) : 0;
+	glt->pending = true;
+
+	GL_Upload8 (gl_texturenum, gl_brightnum, data, width, height, pal, bytes, colors, mipmap, alpha, glt);
 }
 
 void GL_SelectTexture (GLenum target)
@@ -259,32 +259,270 @@ static void BuildTris (void)
 	alltris += pheader->numtris;
 }
 
+/*
+================
+GL_MakeAliasModelArrays
+
+Turns the strips and fans into a list of triangles for the vertex array
+renderer.  Command list vertexes with the same pose vertex and s/t become
+one, so each is lit and moved once
+================
+*/
+static void GL_MakeAliasModelArrays (aliashdr_t *hdr)
+{
+	static int strip[8192];
+	static int drawnext[8192];
+	static int draworder[8192];
+	static float drawst[8192][2];
+	static unsigned short drawindexes[8192 * 3];
+	int i, k, p, count, order, numdraw, numindexes;
+	int *drawfirst;
+	int32_t *cmd;
+	float s, t;
+	bool fan;
+	trivertx_t *in;
+	aliasvert_t *out;
+	float *st;
+	unsigned short *indexes;
+
+	drawfirst = Z_Malloc (hdr->numverts * sizeof (*drawfirst));
+	for (i = 0; i < hdr->numverts; i++)
+		drawfirst[i] = -1;
+
+	numdraw = numindexes = 0;
+	order = 0;
+	cmd = commands;
+	while ((count = *cmd++))
+	{
+		fan = count < 0;
+		if (fan)
+			count = -count;
+
+		for (i = 0; i < count; i++, cmd += 2, order++)
+		{
+			s = ((float *)cmd)[0];
+			t = ((float *)cmd)[1];
+			for (k = drawfirst[vertexorder[order]]; k != -1; k = drawnext[k])
+				if (drawst[k][0] == s && drawst[k][1] == t)
+					break;
+			if (k == -1)
+			{
+				k = numdraw++;
+				drawst[k][0] = s;
+				drawst[k][1] = t;
+				draworder[k] = order;
+				drawnext[k] = drawfirst[vertexorder[order]];
+				drawfirst[vertexorder[order]] = k;
+			}
+			strip[i] = k;
+		}
+
+		// same winding as the strip or fan would have
+		for (i = 2; i < count; i++)
+		{
+			if (fan)
+			{
+				drawindexes[numindexes++] = strip[0];
+				drawindexes[numindexes++] = strip[i - 1];
+			}
+			else if (i & 1)
+			{
+				drawindexes[numindexes++] = strip[i - 1];
+				drawindexes[numindexes++] = strip[i - 2];
+			}
+			else
+			{
+				drawindexes[numindexes++] = strip[i - 2];
+				drawindexes[numindexes++] = strip[i - 1];
+			}
+			drawindexes[numindexes++] = strip[i];
+		}
+	}
+
+	Z_Free (drawfirst);
+
+	hdr->numdrawverts = numdraw;
+	hdr->numdrawindexes = numindexes;
+
+	st = Hunk_Alloc (numdraw * sizeof (drawst[0]));
+	hdr->drawst = (byte *)st - (byte *)hdr;
+	memcpy (st, drawst, numdraw * sizeof (drawst[0]));
+
+	indexes = Hunk_Alloc (numindexes * sizeof (indexes[0]));
+	hdr->drawindexes = (byte *)indexes - (byte *)hdr;
+	memcpy (indexes, drawindexes, numindexes * sizeof (indexes[0]));
+
+	out = Hunk_Alloc (hdr->numposes * numdraw * sizeof (*out));
+	hdr->drawposes = (byte *)out - (byte *)hdr;
+	for (p = 0; p < hdr->numposes; p++)
+	{
+		in = (trivertx_t *)((byte *)hdr + hdr->posedata) + p * hdr->poseverts;
+		for (k = 0; k < numdraw; k++, out++)
+		{
+			out->v[0] = in[draworder[k]].v[0];
+			out->v[1] = in[draworder[k]].v[1];
+			out->v[2] = in[draworder[k]].v[2];
+			out->lightnormal = in[draworder[k]].lightnormalindex;
+		}
+	}
+}
+
+/*
+=================================================================
+
+MESH CACHE
+
+the command list and vertex order of each model are kept in
+glquake/<name>.ms3, tagged with the crc of the model file they were built
+from.  a file that doesn't match the model or doesn't hold together is
+meshed again and written over
+
+=================================================================
+*/
+
+#define MESHCACHE_IDENT (('3' << 24) + ('S' << 16) + ('M' << 8) + 'Q')
+#define MESHCACHE_VERSION 1
+
+typedef struct
+{
+	int32_t ident;
+	int32_t version;
+	uint32_t crc; // of the model file
+	int32_t numverts;
+	int32_t numtris;
+	uint32_t numcommands;
+	uint32_t numorder;
+} meshcache_t;
+
+/*
+================
+GL_CheckMeshCache
+
+Walks the command list, so a damaged file can't send the renderer or the
+pose expansion outside the arrays
+================
+*/
+static bool GL_CheckMeshCache (aliashdr_t *hdr)
+{
+	uint32_t i, verts;
+	int count;
+
+	for (i = 0; i < numorder; i++)
+		if (vertexorder[i] < 0 || vertexorder[i] >= hdr->numverts)
+			return false;
+
+	i = verts = 0;
+	while (i < numcommands)
+	{
+		count = commands[i++];
+		if (!count)
+			return i == numcommands && verts == numorder;
+		if (count < 0)
+			count = -count;
+		if (count < 3 || count > numorder - verts || 2 * count > numcommands - i)
+			return false;
+		i += 2 * count;
+		verts += count;
+	}
+
+	return false; // no end marker
+}
+
+static bool GL_LoadMeshCache (char *path, model_t *m, aliashdr_t *hdr)
+{
+	meshcache_t header;
+	FILE *f;
+	bool ok;
+
+	f = fopen (path, "rb");
+	if (!f)
+		return false;
+
+	ok = fread (&header, sizeof (header), 1, f) == 1 &&
+		 header.ident == MESHCACHE_IDENT &&
+		 header.version == MESHCACHE_VERSION &&
+		 header.crc == m->crc &&
+		 header.numverts == hdr->numverts &&
+		 header.numtris == hdr->numtris &&
+		 header.numcommands <= lengthof (commands) &&
+		 header.numorder <= lengthof (vertexorder);
+
+	if (ok)
+	{
+		numcommands = header.numcommands;
+		numorder = header.numorder;
+		ok = fread (commands, sizeof (commands[0]), numcommands, f) == numcommands &&
+			 fread (vertexorder, sizeof (vertexorder[0]), numorder, f) == numorder &&
+			 fgetc (f) == EOF &&
+			 GL_CheckMeshCache (hdr);
+	}
+
+	fclose (f);
+	return ok;
+}
+
+/*
+================
+GL_SaveMeshCache
+
+Written under a temp name and renamed, so an interrupted write never
+leaves a short file behind
+================
+*/
+static void GL_SaveMeshCache (char *path, model_t *m, aliashdr_t *hdr)
+{
+	meshcache_t header;
+	char temp[MAX_OSPATH];
+	FILE *f;
+	bool ok;
+
+	header.ident = MESHCACHE_IDENT;
+	header.version = MESHCACHE_VERSION;
+	header.crc = m->crc;
+	header.numverts = hdr->numverts;
+	header.numtris = hdr->numtris;
+	header.numcommands = numcommands;
+	header.numorder = numorder;
+
+	snprintf (temp, sizeof (temp), "%s.tmp", path);
+	COM_CreatePath (temp);
+
+	f = fopen (temp, "wb");
+	if (!f)
+		return;
+
+	ok = fwrite (&header, sizeof (header), 1, f) == 1 &&
+		 fwrite (commands, sizeof (commands[0]), numcommands, f) == numcommands &&
+		 fwrite (vertexorder, sizeof (vertexorder[0]), numorder, f) == numorder;
+	ok = !fclose (f) && ok;
+
+	remove (path); // rename won't replace a file everywhere
+	if (!ok || rename (temp, path))
+	{
+		remove (temp);
+		Con_DPrintf ("couldn't write %s\n", path);
+		return;
+	}
+
+	COM_FileWritten (path);
+}
+
 void GL_MakeAliasModelDisplayLists (model_t *m, aliashdr_t *hdr)
 {
 	int i, j;
 	int32_t *cmds;
 	trivertx_t *verts;
 	char cache[MAX_QPATH], fullpath[MAX_OSPATH];
-	FILE *f;
 
 	//
 	// look for a cached version
 	//
 	strcpy (cache, "glquake/");
 	COM_StripExtension (m->name + strlen ("progs/"), cache + strlen ("glquake/"));
-	strcat (cache, ".ms2");
+	strcat (cache, ".ms3");
 
-	sprintf (fullpath, "%s/%s", com_gamedir, cache);
-	f = fopen (fullpath, "rb");
-	if (f)
-	{
-		fread (&numcommands, sizeof (numcommands), 1, f);
-		fread (&numorder, sizeof (numorder), 1, f);
-		fread (&commands, numcommands * sizeof (commands[0]), 1, f);
-		fread (&vertexorder, numorder * sizeof (vertexorder[0]), 1, f);
-		fclose (f);
-	}
-	else
+	snprintf (fullpath, sizeof (fullpath), "%s/%s", com_gamedir, cache);
+	if (!GL_LoadMeshCache (fullpath, m, hdr))
 	{
 		//
 		// build it from scratch
@@ -296,15 +534,7 @@ void GL_MakeAliasModelDisplayLists (model_t *m, aliashdr_t *hdr)
 		//
 		// save out the cached version
 		//
-		f = fopen (fullpath, "wb");
-		if (f)
-		{
-			fwrite (&numcommands, sizeof (numcommands), 1, f);
-			fwrite (&numorder, sizeof (numorder), 1, f);
-			fwrite (&commands, numcommands * sizeof (commands[0]), 1, f);
-			fwrite (&vertexorder, numorder * sizeof (vertexorder[0]), 1, f);
-			fclose (f);
-		}
+		GL_SaveMeshCache (fullpath, m, hdr);
 	}
 
 	// save the data out
@@ -320,4 +550,6 @@ void GL_MakeAliasModelDisplayLists (model_t *m, aliashdr_t *hdr)
 	for (i = 0; i < hdr->numposes; i++)
 		for (j = 0; j < numorder; j++)
 			*verts++ = poseverts[i][vertexorder[j]];
+
+	GL_MakeAliasModelArrays (hdr);
 }
@@ -36,21 +36,43 @@ static void Mod_LoadAliasModel (model_t *mod, void *buffer);
 static model_t mod_known[MAX_MODELS];
 static int mod_numknown;
 
+/*
+===================
+Mod_ClearAll
+
+Brush models go with the level.  Cached alias models and sprites are kept,
+and checked against their files when a new level uses them
+===================
+*/
 void Mod_ClearAll (void)
 {
 	int i;
 	model_t *mod;
 
 	for (i = 0, mod = mod_known; i < mod_numknown; i++, mod++)
-		memset (mod, 0, sizeof (*mod));
+	{
+		if (mod->cache.next)
+			mod->stale = true;
+		else
+			memset (mod, 0, sizeof (*mod));
+	}
+
+	while (mod_numknown && !mod_known[mod_numknown - 1].name[0])
+		mod_numknown--;
+}
+
+static void Mod_FlushModel (cache_t *c)
+{
+	model_t *mod = (model_t *)((byte *)c - offsetof (model_t, cache));
 
-	mod_numknown = 0;
+	Z_Free (mod->data);
+	memset (mod, 0, sizeof (*mod));
 }
 
 static model_t *Mod_FindName (char *name, bool *load)
 {
 	int i;
-	model_t *mod;
+	model_t *mod, *slot;
 
 	if (!name[0])
 		Sys_Error ("Mod_ForName: NULL name");
@@ -58,21 +80,107 @@ static model_t *Mod_FindName (char *name, bool *load)
 	//
 	// search the currently loaded models
 	//
+	slot = NULL;
 	for (i = 0, mod = mod_known; i < mod_numknown; i++, mod++)
+	{
 		if (!strcmp (mod->name, name))
-			break;
+			return mod;
+		if (!slot && !mod->name[0])
+			slot = mod;
+	}
 
-	if (i == mod_numknown)
+	if (!slot)
 	{
-		if (mod_numknown == MAX_MODELS)
+		// take the place of a cached model this level hasn't used
+		for (i = 0, mod = mod_known; i < mod_numknown; i++, mod++)
+			if (mod->stale)
+				break;
+
+		if (i < mod_numknown)
+		{
+			Cache_Remove (&mod->cache);
+			Mod_FlushModel (&mod->cache);
+			slot = mod;
+		}
+		else if (mod_numknown == MAX_MODELS)
 			Sys_Error ("mod_numknown == MAX_MODELS");
-		strcpy (mod->name, name);
-		if (load)
-			*load = true;
-		mod_numknown++;
+		else
+			slot = &mod_known[mod_numknown++];
 	}
 
-	return mod;
+	strcpy (slot->name, name);
+	if (load)
+		*load = true;
+
+	return slot;
+}
+
+/*
+==================
+Mod_CheckCached
+
+A model kept from an earlier level is used again if its file hasn't changed,
+otherwise it is thrown out and has to be loaded again
+==================
+*/
+static bool Mod_CheckCached (model_t *mod)
+{
+	char name[MAX_QPATH];
+	unsigned crc;
+
+	mod->stale = false;
+
+	if (COM_FileCRC (mod->name, &crc) && crc == mod->crc)
+	{
+		Cache_Touch (&mod->cache);
+		return true;
+	}
+
+	strcpy (name, mod->name);
+	Cache_Remove (&mod->cache);
+	Mod_FlushModel (&mod->cache);
+	strcpy (mod->name, name);
+
+	return false;
+}
+
+static void Mod_RelocateSprite (msprite_t *psprite, ptrdiff_t delta)
+{
+	int i, j;
+	mspritegroup_t *pspritegroup;
+
+	for (i = 0; i < psprite->numframes; i++)
+	{
+		psprite->frames[i].frameptr = (mspriteframe_t *)((byte *)psprite->frames[i].frameptr + delta);
+		if (psprite->frames[i].type == SPR_SINGLE)
+			continue;
+
+		pspritegroup = (mspritegroup_t *)psprite->frames[i].frameptr;
+		pspritegroup->intervals = (float *)((byte *)pspritegroup->intervals + delta);
+		for (j = 0; j < pspritegroup->numframes; j++)
+			pspritegroup->frames[j] = (mspriteframe_t *)((byte *)pspritegroup->frames[j] + delta);
+	}
+}
+
+/*
+==================
+Mod_CacheModel
+
+Moves a freshly loaded alias model or sprite off the hunk, so it can be
+kept for the following levels
+==================
+*/
+static void Mod_CacheModel (model_t *mod, size_t mark)
+{
+	byte *data;
+	size_t size;
+
+	data = Hunk_MoveToZone (mark, &size);
+	if (mod->type == mod_sprite)
+		Mod_RelocateSprite ((msprite_t *)data, data - (byte *)mod->data);
+
+	mod->data = data;
+	Cache_Add (&mod->cache, size, Mod_FlushModel);
 }
 
 /*
@@ -84,13 +192,13 @@ Loads a model into the cache
 */
 static model_t *Mod_LoadModel (model_t *mod, bool crash, bool world)
 {
-	void *d;
 	uint32_t *buf;
+	size_t len, mark;
 
 	//
 	// load the file
 	//
-	buf = (uint32_t *)COM_LoadTempFile (mod->name);
+	buf = (uint32_t *)COM_MapFile (mod->name, &len);
 	if (!buf)
 	{
 		if (crash)
@@ -107,16 +215,22 @@ static model_t *Mod_LoadModel (model_t *mod, bool crash, bool world)
 	// fill it in
 	//
 
+	mark = Hunk_LowMark ();
+
 	switch (*(uint32_t *)buf)
 	{
 	case IDPOLYHEADER:
 		mod->type = mod_alias;
+		mod->crc = CRC32_Block (0, (byte *)buf, len); // also keys the mesh cache
 		Mod_LoadAliasModel (mod, buf);
+		Mod_CacheModel (mod, mark);
 		break;
 
 	case IDSPRITEHEADER:
 		mod->type = mod_sprite;
+		mod->crc = CRC32_Block (0, (byte *)buf, len);
 		Mod_LoadSpriteModel (mod, buf);
+		Mod_CacheModel (mod, mark);
 		break;
 
 	default:
@@ -125,6 +239,8 @@ static model_t *Mod_LoadModel (model_t *mod, bool crash, bool world)
 		break;
 	}
 
+	COM_UnmapFile ((byte *)buf);
+
 	return mod;
 }
 
@@ -140,6 +256,9 @@ model_t *Mod_ForName (char *name, bool crash, bool world)
 	bool load = false;
 	model_t *mod = Mod_FindName (name, &load);
 
+	if (mod->stale)
+		load = !Mod_CheckCached (mod);
+
 	if (load)
 		mod = Mod_LoadModel (mod, crash, world);
 
@@ -252,6 +371,7 @@ static void Mod_LoadTextures (lump_t *l)
 	loadmodel->numtextures = m->nummiptex;
 	loadmodel->textures = Hunk_AllocName (m->nummiptex * sizeof (*loadmodel->textures), loadname);
 
+	GL_BeginTextureBatch ();
 	for (i = 0; i < m->nummiptex; i++)
 	{
 		if (m->dataofs[i] == -1)
@@ -261,6 +381,7 @@ static void Mod_LoadTextures (lump_t *l)
 		}
 		loadmodel->textures[i] = Mod_LoadMiptex ((miptex_t *)((byte *)m + m->dataofs[i]));
 	}
+	GL_EndTextureBatch ();
 
 	//
 	// sequence the animations
@@ -1021,23 +1142,24 @@ static void *Mod_LoadAllSkins (model_t *mod, int numskins, daliasskintype_t *psk
 	daliasskininterval_t *pinskinintervals;
 	int gl_texturenum, gl_brightnum;
 
-	skin = (byte *)(pskintype + 1);
-
 	if (numskins < 1 || numskins > MAX_SKINS)
 		Sys_Error ("Mod_LoadAliasModel: Invalid # of skins: %d\n", numskins);
 
 	s = pheader->skinwidth * pheader->skinheight;
 
+	// the model file may be a read only mapping, so skins are flood filled in a copy
+	skin = Z_Malloc (s);
+
 	for (i = 0; i < numskins; i++)
 	{
 		if (pskintype->type == ALIAS_SKIN_SINGLE)
 		{
+			memcpy (skin, (byte *)(pskintype + 1), s);
 			Mod_FloodFillSkin (skin, pheader->skinwidth, pheader->skinheight);
 
 			sprintf (name, "%s_%i", mod->name, i);
 
-			GL_LoadTexture (&gl_texturenum, &gl_brightnum, name, pheader->skinwidth, pheader->skinheight, (byte *)(pskintype + 1), 4, 256, (byte *)d_8to24table,
-							true, true);
+			GL_LoadTexture (&gl_texturenum, &gl_brightnum, name, pheader->skinwidth, pheader->skinheight, skin, 4, 256, (byte *)d_8to24table, true, true);
 
 			pheader->gl_texturenum[i][0] = pheader->gl_texturenum[i][1] = pheader->gl_texturenum[i][2] = pheader->gl_texturenum[i][3] = gl_texturenum;
 
@@ -1057,17 +1179,18 @@ static void *Mod_LoadAllSkins (model_t *mod, int numskins, daliasskintype_t *psk
 
 			for (j = 0; j < groupskins; j++)
 			{
+				memcpy (skin, (byte *)(pskintype), s);
 				Mod_FloodFillSkin (skin, pheader->skinwidth, pheader->skinheight);
 				if (j == 0)
 				{
 					texels = Hunk_AllocName (s, loadname);
 					pheader->texels[i] = texels - (byte *)pheader;
-					memcpy (texels, (byte *)(pskintype), s);
+					memcpy (texels, skin, s);
 				}
 				sprintf (name, "%s_%i_%i", mod->name, i, j);
 
-				GL_LoadTexture (&pheader->gl_texturenum[i][j & 3], &pheader->gl_brightnum[i][j & 3], name, pheader->skinwidth, pheader->skinheight,
-								(byte *)(pskintype), 4, 256, (byte *)d_8to24table, true, true);
+				GL_LoadTexture (&pheader->gl_texturenum[i][j & 3], &pheader->gl_brightnum[i][j & 3], name, pheader->skinwidth, pheader->skinheight, skin, 4,
+								256, (byte *)d_8to24table, true, true);
 
 				pskintype = (daliasskintype_t *)((byte *)(pskintype) + s);
 			}
@@ -1080,12 +1203,14 @@ static void *Mod_LoadAllSkins (model_t *mod, int numskins, daliasskintype_t *psk
 		}
 	}
 
+	Z_Free (skin);
+
 	return (void *)pskintype;
 }
 
 static void Mod_LoadAliasModel (model_t *mod, void *buffer)
 {
-	int i, j;
+	int i;
 	mdl_t *pinmodel;
 	stvert_t *pinstverts;
 	dtriangle_t *pintriangles;
@@ -1157,30 +1282,16 @@ static void Mod_LoadAliasModel (model_t *mod, void *buffer)
 	//
 	// load base s and t vertices
 	//
+	// used in place, the file may be a read only mapping
 	pinstverts = (stvert_t *)pskintype;
 	stverts = pinstverts;
 
-	for (i = 0; i < pheader->numverts; i++)
-	{
-		stverts[i].onseam = pinstverts[i].onseam;
-		stverts[i].s = pinstverts[i].s;
-		stverts[i].t = pinstverts[i].t;
-	}
-
 	//
 	// load triangle lists
 	//
 	pintriangles = (dtriangle_t *)&pinstverts[pheader->numverts];
 	triangles = pintriangles;
 
-	for (i = 0; i < pheader->numtris; i++)
-	{
-		triangles[i].facesfront = pintriangles[i].facesfront;
-
-		for (j = 0; j < 3; j++)
-			triangles[i].vertindex[j] = pintriangles[i].vertindex[j];
-	}
-
 	//
 	// load the frames
 	//
@@ -1360,5 +1471,14 @@ void Mod_Print (void)
 
 	Con_Printf ("Cached models:\n");
 	for (i = 0, mod = mod_known; i < mod_numknown; i++, mod++)
-		Con_Printf ("%i : %s\n", i, mod->name);
+	{
+		if (!mod->name[0])
+			continue;
+		if (mod->cache.next)
+			Con_Printf ("%i : %s (%lu bytes)\n", i, mod->name, mod->cache.size);
+		else
+			Con_Printf ("%i : %s\n", i, mod->name);
+	}
+
+	Cache_Report ();
 }
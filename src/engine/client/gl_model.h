@@ -76,6 +76,7 @@ typedef struct glpoly_s
 	struct glpoly_s *chain;
 	int numverts;
 	int flags;					// for SURF_UNDERWATER
+	int firstvert;				// in the world vertex buffer
 	float verts[4][VERTEXSIZE]; // variable sized (xyz s1t1 s2t2)
 } glpoly_t;
 
@@ -107,6 +108,7 @@ typedef struct msurface_s
 	byte styles[MAXLIGHTMAPS];
 	int cached_light[MAXLIGHTMAPS]; // values currently used in lightmap
 	bool cached_dlight;				// true if dynamic light in cache
+	unsigned int *stylesum;			// styles added up at cached_light, if more than one
 	byte *samples;					// [numstyles*surfsize]
 } msurface_t;
 
@@ -230,6 +232,14 @@ typedef struct mtriangle_s
 	int vertindex[3];
 } mtriangle_t;
 
+// a pose vertex for the vertex array renderer, lightnormal is the index
+// into the normal table, kept as a float so a vertex fills 16 bytes
+typedef struct
+{
+	float v[3];
+	float lightnormal;
+} aliasvert_t;
+
 #define MAX_SKINS 32
 typedef struct
 {
@@ -253,6 +263,11 @@ typedef struct
 	int poseverts;
 	int posedata; // numposes*poseverts trivert_t
 	int commands; // gl command list with embedded s/t
+	int numdrawverts;	// command list vertexes with their own pose vertex and s/t
+	int numdrawindexes; // three for each triangle
+	int drawposes;		// numposes*numdrawverts aliasvert_t
+	int drawst;			// numdrawverts s/t pairs
+	int drawindexes;	// numdrawindexes unsigned shorts
 	int gl_texturenum[MAX_SKINS][4];
 	int gl_brightnum[MAX_SKINS][4];
 	int texels[MAX_SKINS];		 // only for player skins
@@ -294,6 +309,11 @@ typedef struct model_s
 	int flags;
 
 	void *data;
+
+	// alias models and sprites stay cached between levels
+	cache_t cache;
+	unsigned crc; // of the file it was loaded from
+	bool stale;	  // kept from an earlier level, not checked against the file yet
 } model_t;
 
 #define BMODEL(model) ((mbrush_t *)model->data)
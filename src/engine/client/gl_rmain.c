@@ -20,6 +20,10 @@ along with this program.  If not, see <https://www.gnu.org/licenses/>.
 
 #include "clientdef.h"
 
+#ifdef __SSE__
+#include <xmmintrin.h>
+#endif
+
 entity_t r_worldentity;
 
 vec3_t modelorg;
@@ -71,6 +75,7 @@ cvar_t r_fence = {"r_fence", "1"};
 cvar_t r_luminescent = {"r_luminescent", "1"};
 cvar_t r_zmax = {"r_zmax", "4096"};
 cvar_t r_wireframe = {"r_wireframe", "0"};
+cvar_t r_lerpmodels = {"r_lerpmodels", "1"};
 
 cvar_t gl_finish = {"gl_finish", "0"};
 cvar_t gl_clear = {"gl_clear", "0"};
@@ -80,6 +85,8 @@ cvar_t gl_affinemodels = {"gl_affinemodels", "0"};
 cvar_t gl_polyblend = {"gl_polyblend", "1"};
 cvar_t gl_playermip = {"gl_playermip", "0"};
 cvar_t gl_keeptjunctions = {"gl_keeptjunctions", "1"};
+cvar_t gl_vbo = {"gl_vbo", "1"};
+cvar_t gl_aliasarrays = {"gl_aliasarrays", "1"};
 cvar_t gl_partblend = {"gl_partblend", "0"};
 cvar_t gl_ztrick = {"gl_ztrick", "1"};
 
@@ -291,6 +298,177 @@ static void GL_DrawAliasFrame (aliashdr_t *paliashdr, int posenum, bool shade, f
 	}
 }
 
+/*
+entities that can be told apart from frame to frame, by keynum, remember
+the pose they are moving from and when they started, so the two can be
+blended.  the view model has a slot of its own
+*/
+
+#define MAX_LERPKEYS 1024
+#define LERP_VIEWMODEL MAX_LERPKEYS
+
+typedef struct
+{
+	model_t *model;
+	int pose1, pose2; // moving from pose1 to pose2
+	double start;
+} aliaslerp_t;
+
+static aliaslerp_t r_aliaslerp[MAX_LERPKEYS + 1];
+
+// the pose being drawn, four floats a vertex, refilled for every model
+static float *r_aliasxyz;
+static float *r_aliascolor;
+static int r_maxaliasverts;
+
+/*
+=================
+R_AliasLerp
+
+Returns how far to blend from *pose1 to pose, which is reached after
+interval seconds
+=================
+*/
+static float R_AliasLerp (int pose, float interval, int *pose1)
+{
+	aliaslerp_t *l;
+	float blend;
+
+	*pose1 = pose;
+
+	if (currententity == &cl.viewent)
+		l = &r_aliaslerp[LERP_VIEWMODEL];
+	else if (currententity->keynum > 0 && currententity->keynum < MAX_LERPKEYS)
+		l = &r_aliaslerp[currententity->keynum];
+	else
+		return 0;
+
+	if (l->model != currententity->model || cl.time < l->start)
+	{ // a different entity in this slot
+		l->model = currententity->model;
+		l->pose1 = l->pose2 = pose;
+		l->start = cl.time;
+	}
+	else if (pose != l->pose2)
+	{
+		l->pose1 = l->pose2;
+		l->pose2 = pose;
+		l->start = cl.time;
+	}
+
+	if (!r_lerpmodels.value || l->pose1 == pose)
+		return 0;
+
+	blend = (cl.time - l->start) / interval;
+	if (blend >= 1)
+		return 0;
+
+	*pose1 = l->pose1;
+	return blend;
+}
+
+/*
+=================
+R_LerpAliasVerts
+
+Blends two poses and lights the result into the stream arrays
+=================
+*/
+static void R_LerpAliasVerts (aliasvert_t *v1, aliasvert_t *v2, int count, float blend, bool shade, float alpha)
+{
+	int i;
+	float d1, dot;
+#ifdef __SSE__
+	__m128 b, light, a, p1;
+
+	b = _mm_set1_ps (blend);
+	for (i = 0; i < count; i++)
+	{
+		p1 = _mm_loadu_ps (v1[i].v);
+		_mm_storeu_ps (r_aliasxyz + i * 4, _mm_add_ps (p1, _mm_mul_ps (_mm_sub_ps (_mm_loadu_ps (v2[i].v), p1), b)));
+	}
+
+	if (!shade)
+		return;
+
+	light = _mm_setr_ps (shadelight[0], shadelight[1], shadelight[2], 0);
+	a = _mm_setr_ps (0, 0, 0, alpha);
+	for (i = 0; i < count; i++)
+	{
+		d1 = shadedots[(int)v1[i].lightnormal];
+		dot = d1 + (shadedots[(int)v2[i].lightnormal] - d1) * blend;
+		_mm_storeu_ps (r_aliascolor + i * 4, _mm_add_ps (_mm_mul_ps (_mm_set1_ps (dot), light), a));
+	}
+#else
+	float *out;
+
+	for (i = 0, out = r_aliasxyz; i < count; i++, out += 4)
+	{
+		out[0] = v1[i].v[0] + (v2[i].v[0] - v1[i].v[0]) * blend;
+		out[1] = v1[i].v[1] + (v2[i].v[1] - v1[i].v[1]) * blend;
+		out[2] = v1[i].v[2] + (v2[i].v[2] - v1[i].v[2]) * blend;
+	}
+
+	if (!shade)
+		return;
+
+	for (i = 0, out = r_aliascolor; i < count; i++, out += 4)
+	{
+		d1 = shadedots[(int)v1[i].lightnormal];
+		dot = d1 + (shadedots[(int)v2[i].lightnormal] - d1) * blend;
+		out[0] = dot * shadelight[0];
+		out[1] = dot * shadelight[1];
+		out[2] = dot * shadelight[2];
+		out[3] = alpha;
+	}
+#endif
+}
+
+/*
+=================
+R_DrawAliasArrays
+
+Draws the whole model with one call from the arrays made at load
+=================
+*/
+static void R_DrawAliasArrays (aliashdr_t *paliashdr, int pose, float interval, bool shade, float alpha)
+{
+	aliasvert_t *poses;
+	int pose1, count;
+	float blend;
+
+	count = paliashdr->numdrawverts;
+	if (count > r_maxaliasverts)
+	{
+		r_maxaliasverts = count;
+		r_aliasxyz = Z_Realloc (r_aliasxyz, count * 4 * sizeof (float));
+		r_aliascolor = Z_Realloc (r_aliascolor, count * 4 * sizeof (float));
+	}
+
+	blend = R_AliasLerp (pose, interval, &pose1);
+	poses = (aliasvert_t *)((byte *)paliashdr + paliashdr->drawposes);
+	R_LerpAliasVerts (poses + pose1 * count, poses + pose * count, count, blend, shade, alpha);
+
+	glEnableClientState (GL_VERTEX_ARRAY);
+	glEnableClientState (GL_TEXTURE_COORD_ARRAY);
+	glVertexPointer (3, GL_FLOAT, 4 * sizeof (float), r_aliasxyz);
+	glTexCoordPointer (2, GL_FLOAT, 0, (byte *)paliashdr + paliashdr->drawst);
+	if (shade)
+	{
+		glEnableClientState (GL_COLOR_ARRAY);
+		glColorPointer (4, GL_FLOAT, 0, r_aliascolor);
+	}
+	else
+		glColor4f (1, 1, 1, alpha);
+
+	glDrawElements (GL_TRIANGLES, paliashdr->numdrawindexes, GL_UNSIGNED_SHORT, (byte *)paliashdr + paliashdr->drawindexes);
+
+	if (shade)
+		glDisableClientState (GL_COLOR_ARRAY);
+	glDisableClientState (GL_TEXTURE_COORD_ARRAY);
+	glDisableClientState (GL_VERTEX_ARRAY);
+}
+
 static void R_SetupAliasFrame (int frame, aliashdr_t *paliashdr, bool shade, float alpha)
 {
 	int pose, numposes;
@@ -310,8 +488,13 @@ static void R_SetupAliasFrame (int frame, aliashdr_t *paliashdr, bool shade, flo
 		interval = paliashdr->frames[frame].interval;
 		pose += (int)(cl.time / interval) % numposes;
 	}
+	else
+		interval = 0.1; // frames change at 10hz
 
-	GL_DrawAliasFrame (paliashdr, pose, shade, alpha);
+	if (gl_aliasarrays.value && paliashdr->numdrawverts)
+		R_DrawAliasArrays (paliashdr, pose, interval, shade, alpha);
+	else
+		GL_DrawAliasFrame (paliashdr, pose, shade, alpha);
 }
 
 static void R_DrawAliasModel (entity_t *e)
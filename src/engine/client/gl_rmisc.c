@@ -102,6 +102,7 @@ void R_Init (void)
 	Cvar_RegisterVariable (src_client, &r_luminescent);
 	Cvar_RegisterVariable (src_client, &r_zmax);
 	Cvar_RegisterVariable (src_client, &r_wireframe);
+	Cvar_RegisterVariable (src_client, &r_lerpmodels);
 
 	Cvar_RegisterVariable (src_client, &gl_finish);
 	Cvar_RegisterVariable (src_client, &gl_clear);
@@ -115,8 +116,12 @@ void R_Init (void)
 	Cvar_RegisterVariable (src_client, &gl_polyblend);
 	Cvar_RegisterVariable (src_client, &gl_playermip);
 	Cvar_RegisterVariable (src_client, &gl_keeptjunctions);
+	Cvar_RegisterVariable (src_client, &gl_vbo);
+	Cvar_RegisterVariable (src_client, &gl_aliasarrays);
 	Cvar_RegisterVariable (src_client, &gl_partblend);
 
+	Cmd_AddCommand (src_client, "lightmapbench", R_LightmapBench_f);
+
 	R_InitParticles ();
 	R_InitParticleTexture ();
 
@@ -20,6 +20,13 @@ along with this program.  If not, see <https://www.gnu.org/licenses/>.
 
 #include "clientdef.h"
 
+#ifdef __SSE__
+#include <xmmintrin.h>
+#endif
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
 int lightmap_bytes; // 1, 2, or 4
 int d_lightmap_bytes;
 
@@ -27,27 +34,35 @@ static int gl_lightmap_format = GL_RGBA;
 
 static int lightmap_textures;
 
-static unsigned int blocklights[18 * 18 * 3];
+#define MAX_BLOCKLIGHTS (18 * 18 * 3)
+
+// the lightmap pages are square, as large as the card allows up to
+// LIGHTMAP_SIZE unless -lightmapsize says otherwise
+#define LIGHTMAP_SIZE 1024
+#define MIN_LIGHTMAP_SIZE 128
+#define MAX_LIGHTMAP_SIZE 4096
 
-#define BLOCK_WIDTH 128
-#define BLOCK_HEIGHT 128
+static int block_width, block_height;
 
 #define MAX_LIGHTMAPS 64
 
 typedef struct glRect_s
 {
-	unsigned char l, t, w, h;
+	unsigned short l, t, w, h;
 } glRect_t;
 
 static glpoly_t *lightmap_polys[MAX_LIGHTMAPS];
 static bool lightmap_modified[MAX_LIGHTMAPS];
 static glRect_t lightmap_rectchange[MAX_LIGHTMAPS];
 
-static int allocated[MAX_LIGHTMAPS][BLOCK_WIDTH];
+// height of the filled part of each column, and the lowest column
+static unsigned short allocated[MAX_LIGHTMAPS][MAX_LIGHTMAP_SIZE];
+static int allocated_min[MAX_LIGHTMAPS];
+static int lightmap_numpages;
 
 // the lightmap texture data needs to be kept in
 // main memory so texsubimage can update properly
-static byte lightmaps[4 * MAX_LIGHTMAPS * BLOCK_WIDTH * BLOCK_HEIGHT];
+static byte *lightmaps[MAX_LIGHTMAPS];
 
 // For gl_texsort 0
 static msurface_t *skychain = NULL;
@@ -55,7 +70,7 @@ static msurface_t *waterchain = NULL;
 
 static void R_RenderDynamicLightmaps (msurface_t *);
 
-static void R_AddDynamicLights (msurface_t *surf)
+static void R_AddDynamicLights (msurface_t *surf, unsigned int *blocklights)
 {
 	int lnum;
 	int sd, td;
@@ -114,77 +129,165 @@ static void R_AddDynamicLights (msurface_t *surf)
 	}
 }
 
+/*
+the lightmap kernels work on every value of a surface at once, samples times
+d_lightmap_bytes.  with sse2 they go sixteen values at a time, the rest is
+done one by one
+*/
+
+// bl[i] += src[i] * scale
+static void R_AddLightmapScaled (unsigned int *bl, byte *src, int scale, int count)
+{
+	int i;
+#ifdef __SSE2__
+	__m128i zero, s, b, lo, hi, plo, phi;
+
+	i = 0;
+	if (scale >= -32768 && scale <= 32767)
+	{
+		zero = _mm_setzero_si128 ();
+		s = _mm_set1_epi16 (scale);
+		for (; i + 16 <= count; i += 16)
+		{
+			b = _mm_loadu_si128 ((__m128i *)(src + i));
+			lo = _mm_unpacklo_epi8 (b, zero);
+			hi = _mm_unpackhi_epi8 (b, zero);
+
+			// the low and high halves of the 16 bit products make the 32 bit ones
+			plo = _mm_mullo_epi16 (lo, s);
+			phi = _mm_mulhi_epi16 (lo, s);
+			_mm_storeu_si128 ((__m128i *)(bl + i), _mm_add_epi32 (_mm_loadu_si128 ((__m128i *)(bl + i)), _mm_unpacklo_epi16 (plo, phi)));
+			_mm_storeu_si128 ((__m128i *)(bl + i + 4), _mm_add_epi32 (_mm_loadu_si128 ((__m128i *)(bl + i + 4)), _mm_unpackhi_epi16 (plo, phi)));
+
+			plo = _mm_mullo_epi16 (hi, s);
+			phi = _mm_mulhi_epi16 (hi, s);
+			_mm_storeu_si128 ((__m128i *)(bl + i + 8), _mm_add_epi32 (_mm_loadu_si128 ((__m128i *)(bl + i + 8)), _mm_unpacklo_epi16 (plo, phi)));
+			_mm_storeu_si128 ((__m128i *)(bl + i + 12), _mm_add_epi32 (_mm_loadu_si128 ((__m128i *)(bl + i + 12)), _mm_unpackhi_epi16 (plo, phi)));
+		}
+	}
+	for (; i < count; i++)
+		bl[i] += src[i] * scale;
+#else
+	for (i = 0; i < count; i++)
+		bl[i] += src[i] * scale;
+#endif
+}
+
+// out[i] = bl[i] >> 7, bounded to 0-255
+static void R_ClampLightmap (unsigned int *bl, byte *out, int count)
+{
+	int i, t;
+#ifdef __SSE2__
+	__m128i a, b, c, d;
+
+	for (i = 0; i + 16 <= count; i += 16)
+	{
+		a = _mm_srai_epi32 (_mm_loadu_si128 ((__m128i *)(bl + i)), 7);
+		b = _mm_srai_epi32 (_mm_loadu_si128 ((__m128i *)(bl + i + 4)), 7);
+		c = _mm_srai_epi32 (_mm_loadu_si128 ((__m128i *)(bl + i + 8)), 7);
+		d = _mm_srai_epi32 (_mm_loadu_si128 ((__m128i *)(bl + i + 12)), 7);
+		_mm_storeu_si128 ((__m128i *)(out + i), _mm_packus_epi16 (_mm_packs_epi32 (a, b), _mm_packs_epi32 (c, d)));
+	}
+#else
+	i = 0;
+#endif
+	for (; i < count; i++)
+	{
+		t = (int)bl[i] >> 7;
+		if (t > 255)
+			t = 255;
+		else if (t < 0)
+			t = 0;
+		out[i] = t;
+	}
+}
+
 /*
 ===============
 R_BuildLightMap
 
 Combine and scale multiple lightmaps into the 8.8 format in blocklights
+
+Safe to run on any thread, as long as no other is building the same surface
+
+Surfaces with more than one style keep the styles added up in stylesum,
+so when one changes only its difference is added in
 ===============
 */
 static void R_BuildLightMap (msurface_t *surf, byte *dest, int stride)
 {
 	int smax, tmax;
-	int t;
-	int i, j, k, size;
-	byte *lightmap;
-	unsigned int scale;
+	int i, j, size;
+	byte *lightmap, *b;
+	int scale;
 	int maps;
-	unsigned int *bl;
+	unsigned int total;
+	unsigned int blocklights[MAX_BLOCKLIGHTS];
+	byte blockbytes[MAX_BLOCKLIGHTS];
 
 	surf->cached_dlight = (surf->dlightframe == r_framecount);
 
 	smax = (surf->extents[0] >> 4) + 1;
 	tmax = (surf->extents[1] >> 4) + 1;
-	size = smax * tmax;
+	size = smax * tmax * d_lightmap_bytes;
 	lightmap = surf->samples;
 
 	// set to full bright if no light data
 	if (r_fullbright.value || !BMODEL (cl.worldmodel)->lightdata)
 	{
-		for (i = 0; i < size * d_lightmap_bytes; i++)
+		for (i = 0; i < size; i++)
 			blocklights[i] = 255 * 256;
 		goto store;
 	}
 
-	// clear to no light
-	for (i = 0; i < size * d_lightmap_bytes; i++)
-		blocklights[i] = 0;
-
-	// add all the lightmaps
-	if (lightmap)
-		for (maps = 0; maps < MAXLIGHTMAPS && surf->styles[maps] != 255; maps++)
+	if (surf->stylesum)
+	{
+		for (maps = 0; maps < MAXLIGHTMAPS && surf->styles[maps] != 255; maps++, lightmap += size)
 		{
 			scale = d_lightstylevalue[surf->styles[maps]];
+			if (scale == surf->cached_light[maps])
+				continue;
+			R_AddLightmapScaled (surf->stylesum, lightmap, scale - surf->cached_light[maps], size);
 			surf->cached_light[maps] = scale; // 8.8 fraction
-			for (i = 0; i < size * d_lightmap_bytes; i++)
-				blocklights[i] += lightmap[i] * scale;
-			lightmap += size * d_lightmap_bytes; // skip to next lightmap
 		}
+		memcpy (blocklights, surf->stylesum, size * sizeof (*blocklights));
+	}
+	else
+	{
+		// clear to no light
+		memset (blocklights, 0, size * sizeof (*blocklights));
+
+		// add all the lightmaps
+		if (lightmap)
+			for (maps = 0; maps < MAXLIGHTMAPS && surf->styles[maps] != 255; maps++, lightmap += size)
+			{
+				scale = d_lightstylevalue[surf->styles[maps]];
+				surf->cached_light[maps] = scale; // 8.8 fraction
+				R_AddLightmapScaled (blocklights, lightmap, scale, size);
+			}
+	}
 
 	// add all the dynamic lights
 	if (surf->dlightframe == r_framecount)
-		R_AddDynamicLights (surf);
+		R_AddDynamicLights (surf, blocklights);
 
 // bound, invert, and shift
 store:
+	R_ClampLightmap (blocklights, blockbytes, size);
+	b = blockbytes;
+
 	switch (gl_lightmap_format)
 	{
 	case GL_RGBA:
 		stride -= (smax << 2);
-		bl = blocklights;
 		if (d_lightmap_bytes == 1)
 		{
 			for (i = 0; i < tmax; i++, dest += stride)
 			{
-				for (j = 0; j < smax; j++)
+				for (j = 0; j < smax; j++, b++, dest += 4)
 				{
-					t = *bl++;
-					t >>= 7;
-					if (t > 255)
-						t = 255;
-					dest[0] = dest[1] = dest[2] = t;
+					dest[0] = dest[1] = dest[2] = b[0];
 					dest[3] = 255;
-					dest += 4;
 				}
 			}
 		}
@@ -192,18 +295,12 @@ store:
 		{
 			for (i = 0; i < tmax; i++, dest += stride)
 			{
-				for (j = 0; j < smax; j++)
+				for (j = 0; j < smax; j++, b += 3, dest += 4)
 				{
-					for (k = 0; k < 3; k++)
-					{
-						t = *bl++;
-						t >>= 7;
-						if (t > 255)
-							t = 255;
-						dest[k] = t;
-					}
+					dest[0] = b[0];
+					dest[1] = b[1];
+					dest[2] = b[2];
 					dest[3] = 255;
-					dest += 4;
 				}
 			}
 		}
@@ -211,36 +308,18 @@ store:
 	case GL_ALPHA:
 	case GL_LUMINANCE:
 	case GL_INTENSITY:
-		bl = blocklights;
 		if (d_lightmap_bytes == 1)
 		{
-			for (i = 0; i < tmax; i++, dest += stride)
-			{
-				for (j = 0; j < smax; j++)
-				{
-					t = *bl++;
-					t >>= 7;
-					if (t > 255)
-						t = 255;
-					dest[j] = t;
-				}
-			}
+			for (i = 0; i < tmax; i++, dest += stride, b += smax)
+				memcpy (dest, b, smax);
 		}
 		else
 		{
 			for (i = 0; i < tmax; i++, dest += stride)
 			{
-				for (j = 0; j < smax; j++)
+				for (j = 0; j < smax; j++, b += 3)
 				{
-					unsigned int total = 0;
-					for (k = 0; k < 3; k++)
-					{
-						t = *bl++;
-						t >>= 7;
-						if (t > 255)
-							t = 255;
-						total += t;
-					}
+					total = b[0] + b[1] + b[2];
 					dest[j] = 255 * (total / (float)(255 * 3));
 				}
 			}
@@ -251,6 +330,181 @@ store:
 	}
 }
 
+static void R_BuildSurfaceLightmap (msurface_t *surf)
+{
+	byte *base;
+
+	base = lightmaps[surf->lightmaptexturenum];
+	base += (surf->light_t * block_width + surf->light_s) * lightmap_bytes;
+	R_BuildLightMap (surf, base, block_width * lightmap_bytes);
+}
+
+/*
+surfaces whose lightmaps change are queued as they are drawn and built
+together before the lightmaps go up.  when there are enough of them, helper
+tasks are queued and they and the main thread claim runs of surfaces from
+a shared counter.  the main thread only ever builds lightmaps itself, so it
+never ends up running some other long task while the frame waits.  each
+surface lands in its own part of the lightmap so nothing is shared
+*/
+
+#define MAX_LIGHTQUEUE 4096
+#define LIGHTTASK_SURFS 32 // surfaces per claim
+#define MAX_LIGHTHELPERS 16
+
+static msurface_t *r_lightqueue[MAX_LIGHTQUEUE];
+static int r_numlightqueue;
+
+// the list being built.  the claim counter is tagged with the batch number,
+// so a helper that only starts after its batch is over finds nothing to do
+static msurface_t **r_lightbatch;
+static int r_lightbatchcount;
+static atomic_ullong r_lightclaim; // batch << 32 | next surface
+static atomic_int r_lightremaining;
+
+static void R_BuildLightmapRuns (unsigned int batch)
+{
+	unsigned long long claim;
+	int i, start, end;
+
+	claim = atomic_load (&r_lightclaim);
+	while ((claim >> 32) == batch)
+	{
+		if (!atomic_compare_exchange_weak (&r_lightclaim, &claim, claim + LIGHTTASK_SURFS))
+			continue;
+
+		// the batch can't end before this run is counted, so the list stays put
+		start = (int)(claim & 0xffffffff);
+		if (start >= r_lightbatchcount)
+			return;
+		end = start + LIGHTTASK_SURFS < r_lightbatchcount ? start + LIGHTTASK_SURFS : r_lightbatchcount;
+
+		for (i = start; i < end; i++)
+			R_BuildSurfaceLightmap (r_lightbatch[i]);
+		atomic_fetch_sub (&r_lightremaining, end - start);
+
+		claim = atomic_load (&r_lightclaim);
+	}
+}
+
+static void R_BuildLightmapTask (void *arg)
+{
+	R_BuildLightmapRuns ((unsigned int)(uintptr_t)arg);
+}
+
+/*
+===============
+R_BuildLightmapList
+
+Builds the lightmaps of the surfaces, with help from the workers if there
+are enough.  Only waits for runs that have already been claimed
+===============
+*/
+static void R_BuildLightmapList (msurface_t **surfs, int count)
+{
+	static unsigned int batch;
+	int i, numhelpers;
+
+	if (count < LIGHTTASK_SURFS * 2)
+	{
+		for (i = 0; i < count; i++)
+			R_BuildSurfaceLightmap (surfs[i]);
+		return;
+	}
+
+	batch++;
+	r_lightbatch = surfs;
+	r_lightbatchcount = count;
+	atomic_store (&r_lightremaining, count);
+	atomic_store (&r_lightclaim, (unsigned long long)batch << 32);
+
+	numhelpers = count / LIGHTTASK_SURFS - 1;
+	if (numhelpers > MAX_LIGHTHELPERS)
+		numhelpers = MAX_LIGHTHELPERS;
+	for (i = 0; i < numhelpers; i++)
+		Task_Add (R_BuildLightmapTask, (void *)(uintptr_t)batch);
+
+	R_BuildLightmapRuns (batch);
+
+	// the last few runs are on the workers, these are short so just spin
+	while (atomic_load (&r_lightremaining))
+		;
+}
+
+static void R_FlushLightmaps (void)
+{
+	R_BuildLightmapList (r_lightqueue, r_numlightqueue);
+	r_numlightqueue = 0;
+}
+
+/*
+===============
+R_QueueLightmap
+
+Marks the part of the lightmap the surface covers as changed, and queues it
+to be built
+===============
+*/
+static void R_QueueLightmap (msurface_t *fa)
+{
+	glRect_t *theRect;
+	int smax, tmax;
+
+	lightmap_modified[fa->lightmaptexturenum] = true;
+	theRect = &lightmap_rectchange[fa->lightmaptexturenum];
+	if (fa->light_t < theRect->t)
+	{
+		if (theRect->h)
+			theRect->h += theRect->t - fa->light_t;
+		theRect->t = fa->light_t;
+	}
+	if (fa->light_s < theRect->l)
+	{
+		if (theRect->w)
+			theRect->w += theRect->l - fa->light_s;
+		theRect->l = fa->light_s;
+	}
+	smax = (fa->extents[0] >> 4) + 1;
+	tmax = (fa->extents[1] >> 4) + 1;
+	if ((theRect->w + theRect->l) < (fa->light_s + smax))
+		theRect->w = (fa->light_s - theRect->l) + smax;
+	if ((theRect->h + theRect->t) < (fa->light_t + tmax))
+		theRect->h = (fa->light_t - theRect->t) + tmax;
+
+	if (r_numlightqueue == MAX_LIGHTQUEUE)
+		R_FlushLightmaps ();
+	r_lightqueue[r_numlightqueue++] = fa;
+}
+
+/*
+===============
+R_UploadLightmap
+
+Sends up the changed rect of a lightmap, which must be bound
+===============
+*/
+static void R_UploadLightmap (int i)
+{
+	glRect_t *theRect;
+
+	if (!lightmap_modified[i])
+		return;
+
+	lightmap_modified[i] = false;
+	theRect = &lightmap_rectchange[i];
+
+	// only the columns inside the changed rect go up
+	glPixelStorei (GL_UNPACK_ROW_LENGTH, block_width);
+	glTexSubImage2D (GL_TEXTURE_2D, 0, theRect->l, theRect->t, theRect->w, theRect->h, gl_lightmap_format, GL_UNSIGNED_BYTE,
+					 lightmaps[i] + (theRect->t * block_width + theRect->l) * lightmap_bytes);
+	glPixelStorei (GL_UNPACK_ROW_LENGTH, 0);
+
+	theRect->l = block_width;
+	theRect->t = block_height;
+	theRect->h = 0;
+	theRect->w = 0;
+}
+
 /*
 ===============
 R_TextureAnimation
@@ -305,6 +559,11 @@ static void DrawGLWaterPolyLightmap (glpoly_t *);
 lpMTexFUNC qglMTexCoord2fSGIS = NULL;
 lpSelTexFUNC qglSelectTextureSGIS = NULL;
 
+lpGenBuffersFUNC qglGenBuffers = NULL;
+lpDeleteBuffersFUNC qglDeleteBuffers = NULL;
+lpBindBufferFUNC qglBindBuffer = NULL;
+lpBufferDataFUNC qglBufferData = NULL;
+
 bool mtexenabled = false;
 
 void GL_SelectTexture (GLenum);
@@ -329,6 +588,159 @@ void GL_EnableMultitexture (void)
 	}
 }
 
+/*
+=============================================================
+
+	VERTEX BUFFER
+
+=============================================================
+*/
+
+/*
+the polys of every brush model are uploaded into one vertex buffer when the
+lightmaps are built.  a texture or lightmap chain is drawn by gathering the
+triangles of its polys into an index list and sending it out in one call
+*/
+
+static GLuint r_worldvbo;
+static bool r_vboactive; // r_worldvbo is bound and the arrays point into it
+
+static unsigned *r_vboindices;
+static int r_numvboindices, r_maxvboindices;
+
+static void R_BeginVBO (void)
+{
+	r_vboactive = r_worldvbo && gl_vbo.value;
+	if (!r_vboactive)
+		return;
+
+	qglBindBuffer (GL_ARRAY_BUFFER, r_worldvbo);
+	glEnableClientState (GL_VERTEX_ARRAY);
+	glEnableClientState (GL_TEXTURE_COORD_ARRAY);
+	glVertexPointer (3, GL_FLOAT, VERTEXSIZE * sizeof (float), (void *)0);
+	glTexCoordPointer (2, GL_FLOAT, VERTEXSIZE * sizeof (float), (void *)(3 * sizeof (float)));
+}
+
+static void R_EndVBO (void)
+{
+	if (!r_vboactive)
+		return;
+
+	glDisableClientState (GL_VERTEX_ARRAY);
+	glDisableClientState (GL_TEXTURE_COORD_ARRAY);
+	qglBindBuffer (GL_ARRAY_BUFFER, 0);
+	r_vboactive = false;
+}
+
+static void R_FlushVBO (void)
+{
+	if (!r_numvboindices)
+		return;
+
+	glDrawElements (GL_TRIANGLES, r_numvboindices, GL_UNSIGNED_INT, r_vboindices);
+	r_numvboindices = 0;
+}
+
+static void R_AddVBOPoly (glpoly_t *p)
+{
+	unsigned *idx;
+	int i;
+
+	if (r_numvboindices + (p->numverts - 2) * 3 > r_maxvboindices)
+		R_FlushVBO ();
+
+	idx = r_vboindices + r_numvboindices;
+	for (i = 2; i < p->numverts; i++)
+	{
+		*idx++ = p->firstvert;
+		*idx++ = p->firstvert + i - 1;
+		*idx++ = p->firstvert + i;
+	}
+	r_numvboindices = idx - r_vboindices;
+}
+
+static void R_DrawChainVBO (msurface_t *s)
+{
+	for (; s; s = s->texturechain)
+		R_AddVBOPoly (s->polys);
+	R_FlushVBO ();
+}
+
+/*
+================
+GL_BuildWorldVBO
+
+Copies the polys made by BuildSurfaceDisplayList into the vertex buffer
+================
+*/
+static void GL_BuildWorldVBO (void)
+{
+	int i, j, numverts, numindices;
+	model_t *m;
+	msurface_t *surf;
+	glpoly_t *p;
+	float *verts;
+
+	if (r_worldvbo)
+	{
+		qglDeleteBuffers (1, &r_worldvbo);
+		r_worldvbo = 0;
+	}
+
+	if (!gl_vboable)
+		return;
+
+	numverts = numindices = 0;
+	for (j = 1; j < MAX_MODELS; j++)
+	{
+		m = cl.model_precache[j];
+		if (!m)
+			break;
+		if (m->type != mod_brush || m->name[0] == '*')
+			continue;
+		for (i = 0, surf = BMODEL (m)->surfaces; i < BMODEL (m)->numsurfaces; i++, surf++)
+		{
+			if (surf->flags & (SURF_DRAWTURB | SURF_DRAWSKY))
+				continue;
+			p = surf->polys;
+			p->firstvert = numverts;
+			numverts += p->numverts;
+			numindices += (p->numverts - 2) * 3;
+		}
+	}
+
+	if (!numverts)
+		return;
+
+	verts = Z_Malloc (numverts * VERTEXSIZE * sizeof (float));
+	for (j = 1; j < MAX_MODELS; j++)
+	{
+		m = cl.model_precache[j];
+		if (!m)
+			break;
+		if (m->type != mod_brush || m->name[0] == '*')
+			continue;
+		for (i = 0, surf = BMODEL (m)->surfaces; i < BMODEL (m)->numsurfaces; i++, surf++)
+		{
+			if (surf->flags & (SURF_DRAWTURB | SURF_DRAWSKY))
+				continue;
+			p = surf->polys;
+			memcpy (verts + p->firstvert * VERTEXSIZE, p->verts, p->numverts * VERTEXSIZE * sizeof (float));
+		}
+	}
+
+	qglGenBuffers (1, &r_worldvbo);
+	qglBindBuffer (GL_ARRAY_BUFFER, r_worldvbo);
+	qglBufferData (GL_ARRAY_BUFFER, numverts * VERTEXSIZE * sizeof (float), verts, GL_STATIC_DRAW);
+	qglBindBuffer (GL_ARRAY_BUFFER, 0);
+	Z_Free (verts);
+
+	// no chain can hold more triangles than there are
+	r_maxvboindices = numindices;
+	r_vboindices = Hunk_AllocName (numindices * sizeof (*r_vboindices), "vboindex");
+	r_numvboindices = 0;
+}
+
 /*
 ================
 R_DrawSequentialPoly
@@ -344,7 +756,6 @@ static void R_DrawSequentialPoly (msurface_t *s)
 	int i;
 	texture_t *t;
 	vec3_t nv;
-	glRect_t *theRect;
 
 	//
 	// normal lightmaped poly
@@ -353,6 +764,7 @@ static void R_DrawSequentialPoly (msurface_t *s)
 	if (!(s->flags & (SURF_DRAWSKY | SURF_DRAWTURB | SURF_UNDERWATER)))
 	{
 		R_RenderDynamicLightmaps (s);
+		R_FlushLightmaps ();
 		if (gl_mtexable)
 		{
 			p = s->polys;
@@ -365,18 +777,7 @@ static void R_DrawSequentialPoly (msurface_t *s)
 			// Binds lightmap to texenv 1
 			GL_EnableMultitexture (); // Same as SelectTexture (TEXTURE1)
 			GL_Bind (lightmap_textures + s->lightmaptexturenum);
-			i = s->lightmaptexturenum;
-			if (lightmap_modified[i])
-			{
-				lightmap_modified[i] = false;
-				theRect = &lightmap_rectchange[i];
-				glTexSubImage2D (GL_TEXTURE_2D, 0, 0, theRect->t, BLOCK_WIDTH, theRect->h, gl_lightmap_format, GL_UNSIGNED_BYTE,
-								 lightmaps + (i * BLOCK_HEIGHT + theRect->t) * BLOCK_WIDTH * lightmap_bytes);
-				theRect->l = BLOCK_WIDTH;
-				theRect->t = BLOCK_HEIGHT;
-				theRect->h = 0;
-				theRect->w = 0;
-			}
+			R_UploadLightmap (s->lightmaptexturenum);
 			glTexEnvf (GL_TEXTURE_ENV, GL_TEXTURE_ENV_MODE, GL_BLEND);
 			glBegin (GL_POLYGON);
 			v = p->verts[0];
@@ -459,6 +860,7 @@ static void R_DrawSequentialPoly (msurface_t *s)
 	// underwater warped with lightmap
 	//
 	R_RenderDynamicLightmaps (s);
+	R_FlushLightmaps ();
 	if (gl_mtexable)
 	{
 		p = s->polys;
@@ -469,18 +871,7 @@ static void R_DrawSequentialPoly (msurface_t *s)
 		glTexEnvf (GL_TEXTURE_ENV, GL_TEXTURE_ENV_MODE, GL_REPLACE);
 		GL_EnableMultitexture ();
 		GL_Bind (lightmap_textures + s->lightmaptexturenum);
-		i = s->lightmaptexturenum;
-		if (lightmap_modified[i])
-		{
-			lightmap_modified[i] = false;
-			theRect = &lightmap_rectchange[i];
-			glTexSubImage2D (GL_TEXTURE_2D, 0, 0, theRect->t, BLOCK_WIDTH, theRect->h, gl_lightmap_format, GL_UNSIGNED_BYTE,
-							 lightmaps + (i * BLOCK_HEIGHT + theRect->t) * BLOCK_WIDTH * lightmap_bytes);
-			theRect->l = BLOCK_WIDTH;
-			theRect->t = BLOCK_HEIGHT;
-			theRect->h = 0;
-			theRect->w = 0;
-		}
+		R_UploadLightmap (s->lightmaptexturenum);
 		glTexEnvf (GL_TEXTURE_ENV, GL_TEXTURE_ENV_MODE, GL_BLEND);
 		glBegin (GL_TRIANGLE_FAN);
 		v = p->verts[0];
@@ -574,6 +965,12 @@ static void DrawGLPoly (glpoly_t *p)
 	int i;
 	float *v;
 
+	if (r_vboactive)
+	{
+		glDrawArrays (GL_TRIANGLE_FAN, p->firstvert, p->numverts);
+		return;
+	}
+
 	glBegin (GL_POLYGON);
 	v = p->verts[0];
 	for (i = 0; i < p->numverts; i++, v += VERTEXSIZE)
@@ -589,9 +986,10 @@ static void R_BlendLightmaps (void)
 	int i, j;
 	glpoly_t *p;
 	float *v;
-	glRect_t *theRect;
 	GLuint depthfunc;
 
+	R_FlushLightmaps ();
+
 	if (r_fullbright.value)
 		return;
 	if (!gl_texsort.value)
@@ -619,28 +1017,23 @@ static void R_BlendLightmaps (void)
 	if (r_luminescent.value)
 		glStencilFunc (GL_NOTEQUAL, 1, 1);
 
+	if (r_vboactive)
+		glTexCoordPointer (2, GL_FLOAT, VERTEXSIZE * sizeof (float), (void *)(5 * sizeof (float)));
+
 	for (i = 0; i < MAX_LIGHTMAPS; i++)
 	{
 		p = lightmap_polys[i];
 		if (!p)
 			continue;
 		GL_Bind (lightmap_textures + i);
-		if (lightmap_modified[i])
+		R_UploadLightmap (i);
+		if (r_vboactive)
 		{
-			lightmap_modified[i] = false;
-			theRect = &lightmap_rectchange[i];
-			//			glTexImage2D (GL_TEXTURE_2D, 0, lightmap_bytes
-			//			, BLOCK_WIDTH, BLOCK_HEIGHT, 0,
-			//			gl_lightmap_format, GL_UNSIGNED_BYTE, lightmaps+i*BLOCK_WIDTH*BLOCK_HEIGHT*lightmap_bytes);
-			//			glTexImage2D (GL_TEXTURE_2D, 0, lightmap_bytes
-			//				, BLOCK_WIDTH, theRect->h, 0,
-			//				gl_lightmap_format, GL_UNSIGNED_BYTE, lightmaps+(i*BLOCK_HEIGHT+theRect->t)*BLOCK_WIDTH*lightmap_bytes);
-			glTexSubImage2D (GL_TEXTURE_2D, 0, 0, theRect->t, BLOCK_WIDTH, theRect->h, gl_lightmap_format, GL_UNSIGNED_BYTE,
-							 lightmaps + (i * BLOCK_HEIGHT + theRect->t) * BLOCK_WIDTH * lightmap_bytes);
-			theRect->l = BLOCK_WIDTH;
-			theRect->t = BLOCK_HEIGHT;
-			theRect->h = 0;
-			theRect->w = 0;
+			// the underwater warp is disabled, so they can go out with the rest
+			for (; p; p = p->chain)
+				R_AddVBOPoly (p);
+			R_FlushVBO ();
+			continue;
 		}
 		for (; p; p = p->chain)
 		{
@@ -660,6 +1053,9 @@ static void R_BlendLightmaps (void)
 		}
 	}
 
+	if (r_vboactive)
+		glTexCoordPointer (2, GL_FLOAT, VERTEXSIZE * sizeof (float), (void *)(3 * sizeof (float)));
+
 	glStencilFunc (GL_ALWAYS, 0, 1);
 	glDisable (GL_BLEND);
 	if (gl_lightmap_format == GL_LUMINANCE || gl_lightmap_format == GL_RGBA)
@@ -679,10 +1075,7 @@ static void R_BlendLightmaps (void)
 static void R_RenderBrushPoly (msurface_t *fa)
 {
 	texture_t *t;
-	byte *base;
 	int maps;
-	glRect_t *theRect;
-	int smax, tmax;
 
 	c_brush_polys++;
 
@@ -751,40 +1144,13 @@ static void R_RenderBrushPoly (msurface_t *fa)
 	{
 	dynamic:
 		if (r_dynamic.value)
-		{
-			lightmap_modified[fa->lightmaptexturenum] = true;
-			theRect = &lightmap_rectchange[fa->lightmaptexturenum];
-			if (fa->light_t < theRect->t)
-			{
-				if (theRect->h)
-					theRect->h += theRect->t - fa->light_t;
-				theRect->t = fa->light_t;
-			}
-			if (fa->light_s < theRect->l)
-			{
-				if (theRect->w)
-					theRect->w += theRect->l - fa->light_s;
-				theRect->l = fa->light_s;
-			}
-			smax = (fa->extents[0] >> 4) + 1;
-			tmax = (fa->extents[1] >> 4) + 1;
-			if ((theRect->w + theRect->l) < (fa->light_s + smax))
-				theRect->w = (fa->light_s - theRect->l) + smax;
-			if ((theRect->h + theRect->t) < (fa->light_t + tmax))
-				theRect->h = (fa->light_t - theRect->t) + tmax;
-			base = lightmaps + fa->lightmaptexturenum * lightmap_bytes * BLOCK_WIDTH * BLOCK_HEIGHT;
-			base += fa->light_t * BLOCK_WIDTH * lightmap_bytes + fa->light_s * lightmap_bytes;
-			R_BuildLightMap (fa, base, BLOCK_WIDTH * lightmap_bytes);
-		}
+			R_QueueLightmap (fa);
 	}
 }
 
 static void R_RenderDynamicLightmaps (msurface_t *fa)
 {
-	byte *base;
 	int maps;
-	glRect_t *theRect;
-	int smax, tmax;
 
 	c_brush_polys++;
 
@@ -804,31 +1170,7 @@ static void R_RenderDynamicLightmaps (msurface_t *fa)
 	{
 	dynamic:
 		if (r_dynamic.value)
-		{
-			lightmap_modified[fa->lightmaptexturenum] = true;
-			theRect = &lightmap_rectchange[fa->lightmaptexturenum];
-			if (fa->light_t < theRect->t)
-			{
-				if (theRect->h)
-					theRect->h += theRect->t - fa->light_t;
-				theRect->t = fa->light_t;
-			}
-			if (fa->light_s < theRect->l)
-			{
-				if (theRect->w)
-					theRect->w += theRect->l - fa->light_s;
-				theRect->l = fa->light_s;
-			}
-			smax = (fa->extents[0] >> 4) + 1;
-			tmax = (fa->extents[1] >> 4) + 1;
-			if ((theRect->w + theRect->l) < (fa->light_s + smax))
-				theRect->w = (fa->light_s - theRect->l) + smax;
-			if ((theRect->h + theRect->t) < (fa->light_t + tmax))
-				theRect->h = (fa->light_t - theRect->t) + tmax;
-			base = lightmaps + fa->lightmaptexturenum * lightmap_bytes * BLOCK_WIDTH * BLOCK_HEIGHT;
-			base += fa->light_t * BLOCK_WIDTH * lightmap_bytes + fa->light_s * lightmap_bytes;
-			R_BuildLightMap (fa, base, BLOCK_WIDTH * lightmap_bytes);
-		}
+			R_QueueLightmap (fa);
 	}
 }
 
@@ -900,6 +1242,94 @@ void R_DrawWaterSurfaces (void)
 	}
 }
 
+/*
+================
+R_DrawTextureChainVBO
+
+R_RenderBrushPoly for a whole chain of one texture
+================
+*/
+static void R_DrawTextureChainVBO (msurface_t *chain)
+{
+	msurface_t *s;
+	texture_t *t;
+
+	t = R_TextureAnimation (chain->texinfo->texture);
+	GL_Bind (t->gl_texturenum);
+
+	glStencilMask (1);
+
+	if ((chain->flags & SURF_DRAWFENCE) && r_fence.value)
+		glEnable (GL_ALPHA_TEST);
+
+	R_DrawChainVBO (chain);
+
+	if (r_luminescent.value && t->gl_brightnum)
+	{
+		glColorMask (GL_FALSE, GL_FALSE, GL_FALSE, GL_FALSE);
+		glEnable (GL_ALPHA_TEST);
+		glDepthMask (0);
+
+		glStencilMask (1);
+		glStencilFunc (GL_ALWAYS, 1, 1);
+
+		GL_Bind (t->gl_brightnum);
+		R_DrawChainVBO (chain);
+
+		glStencilFunc (GL_ALWAYS, 0, 1);
+
+		glDepthMask (1);
+		glDisable (GL_ALPHA_TEST);
+		glColorMask (GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE);
+	}
+
+	glStencilMask (0);
+
+	// add the polys to their lightmap chains
+	for (s = chain; s; s = s->texturechain)
+		R_RenderDynamicLightmaps (s);
+}
+
+/*
+================
+R_DrawSequentialChains
+
+Draws each texture chain of the world grouped by lightmap page, so the
+texture and the lightmap each stay bound across runs of surfaces
+================
+*/
+static void R_DrawSequentialChains (void)
+{
+	msurface_t *pages[MAX_LIGHTMAPS];
+	msurface_t *s, *next;
+	texture_t *t;
+	int i, j;
+
+	memset (pages, 0, sizeof (pages));
+
+	for (i = 0; i < BMODEL (cl.worldmodel)->numtextures; i++)
+	{
+		t = BMODEL (cl.worldmodel)->textures[i];
+		if (!t || !t->texturechain)
+			continue;
+
+		for (s = t->texturechain; s; s = next)
+		{
+			next = s->texturechain;
+			s->texturechain = pages[s->lightmaptexturenum];
+			pages[s->lightmaptexturenum] = s;
+		}
+		t->texturechain = NULL;
+
+		for (j = 0; j < lightmap_numpages; j++)
+		{
+			for (s = pages[j]; s; s = s->texturechain)
+				R_DrawSequentialPoly (s);
+			pages[j] = NULL;
+		}
+	}
+}
+
 static void DrawTextureChains (void)
 {
 	extern int skytexturenum;
@@ -909,6 +1339,7 @@ static void DrawTextureChains (void)
 
 	if (!gl_texsort.value)
 	{
+		R_DrawSequentialChains ();
 		GL_DisableMultitexture ();
 
 		if (skychain)
@@ -934,8 +1365,13 @@ static void DrawTextureChains (void)
 		{
 			if ((s->flags & SURF_DRAWTURB) && r_wateralpha.value != 1.0)
 				continue; // draw translucent water later
-			for (; s; s = s->texturechain)
-				R_RenderBrushPoly (s);
+			if (r_vboactive && !(s->flags & SURF_DRAWTURB))
+				R_DrawTextureChainVBO (s);
+			else
+			{
+				for (; s; s = s->texturechain)
+					R_RenderBrushPoly (s);
+			}
 		}
 
 		t->texturechain = NULL;
@@ -1015,6 +1451,7 @@ void R_DrawBrushModel (entity_t *e)
 	e->angles[0] = -e->angles[0]; // stupid quake bug
 
 	glEnable (GL_STENCIL_TEST);
+	R_BeginVBO ();
 
 	//
 	// draw texture
@@ -1041,6 +1478,7 @@ void R_DrawBrushModel (entity_t *e)
 
 	R_BlendLightmaps ();
 
+	R_EndVBO ();
 	glDisable (GL_STENCIL_TEST);
 
 	glPopMatrix ();
@@ -1054,121 +1492,243 @@ void R_DrawBrushModel (entity_t *e)
 =============================================================
 */
 
-static void R_RecursiveWorldNode (msurface_t **surfs, mnode_t *node)
-{
-	int c, side;
-	mplane_t *plane;
-	msurface_t *surf, **mark;
-	mleaf_t *pleaf;
-	double dot;
+/*
+the leaves in the pvs of the view leaf, and the surfaces they can see, are
+gathered once when the view leaf changes.  each frame the leaf bounds are
+culled against the frustum four at a time, the surfaces of the leaves that
+are left are marked, then the surface list is run through once, putting
+marked surfaces that face the viewer into their texture chains
+*/
 
-	if (node->contents == CONTENTS_SOLID)
-		return; // solid
+static model_t *r_visworld;
+static int r_numvisleafs, r_maxvisleafs;
+static mleaf_t **r_visleafs;
+static float *r_visbounds[6]; // mins and maxs of the leaves by axis, padded to a multiple of 4
+static int r_numvissurfs, r_maxvissurfs;
+static msurface_t **r_vissurfs;
+static byte *r_vissurfmark;
+static int r_maxvissurfmark;
 
-	if (node->visframe != r_visframecount)
-		return;
-	if (R_CullBox (node->minmaxs, node->minmaxs + 3))
-		return;
+static void R_AddVisLeaf (mleaf_t *leaf)
+{
+	int i, size;
 
-	// if a leaf node, draw stuff
-	if (node->contents < 0)
+	if (r_numvisleafs + 4 > r_maxvisleafs)
 	{
-		pleaf = (mleaf_t *)node;
+		r_maxvisleafs = r_maxvisleafs ? r_maxvisleafs * 2 : 1024;
+		r_visleafs = Z_Realloc (r_visleafs, r_maxvisleafs * sizeof (*r_visleafs));
+		for (i = 0; i < 6; i++)
+			r_visbounds[i] = Z_Realloc (r_visbounds[i], r_maxvisleafs * sizeof (float));
+	}
 
-		mark = surfs + pleaf->firstmarksurface;
-		c = pleaf->nummarksurfaces;
+	r_visleafs[r_numvisleafs] = leaf;
+	for (i = 0; i < 6; i++)
+		r_visbounds[i][r_numvisleafs] = leaf->minmaxs[i];
+	r_numvisleafs++;
 
-		if (c)
-			do
-			{
-				(*mark)->visframe = r_framecount;
-				mark++;
-			} while (--c);
+	size = r_numvissurfs + leaf->nummarksurfaces;
+	if (size > r_maxvissurfs)
+	{
+		r_maxvissurfs = size * 2;
+		r_vissurfs = Z_Realloc (r_vissurfs, r_maxvissurfs * sizeof (*r_vissurfs));
+	}
+}
 
-		// deal with model fragments in this leaf
-		if (pleaf->efrags)
-			R_StoreEfrags (&pleaf->efrags);
+/*
+===============
+R_MarkLeaves
+
+Rebuilds the visible leaf and surface lists when the view leaf changes
+===============
+*/
+void R_MarkLeaves (void)
+{
+	byte *vis;
+	mleaf_t *leaf;
+	mbrush_t *brush;
+	msurface_t **mark, *surf;
+	int i, j;
+	byte solid[4096];
 
+	if (r_oldviewleaf == r_viewleaf && r_visworld == cl.worldmodel && !r_novis.value)
 		return;
-	}
 
-	// node is just a decision point, so go down the apropriate sides
+	r_visframecount++;
+	r_oldviewleaf = r_viewleaf;
 
-	// find which side of the node we are on
-	plane = node->plane;
+	brush = BMODEL (cl.worldmodel);
+	r_visworld = cl.worldmodel;
 
-	switch (plane->type)
+	// a new map usually reuses the old one's model_t, so go by the size
+	if (brush->numsurfaces > r_maxvissurfmark)
 	{
-	case PLANE_X:
-		dot = modelorg[0] - plane->dist;
-		break;
-	case PLANE_Y:
-		dot = modelorg[1] - plane->dist;
-		break;
-	case PLANE_Z:
-		dot = modelorg[2] - plane->dist;
-		break;
-	default:
-		dot = DotProduct (modelorg, plane->normal) - plane->dist;
-		break;
+		r_maxvissurfmark = brush->numsurfaces;
+		Z_Free (r_vissurfmark);
+		r_vissurfmark = Z_Malloc (r_maxvissurfmark);
 	}
+	memset (r_vissurfmark, 0, brush->numsurfaces);
 
-	if (dot >= 0)
-		side = 0;
+	if (r_novis.value)
+	{
+		vis = solid;
+		memset (solid, 0xff, (cl.cmodel_precache[1]->numleafs + 7) >> 3);
+	}
 	else
-		side = 1;
-
-	// recurse down the children, front side first
-	R_RecursiveWorldNode (surfs, node->children[side]);
+		vis = CMod_LeafPVS (r_viewleaf, cl.cmodel_precache[1]);
 
-	// draw stuff
-	c = node->numsurfaces;
+	r_numvisleafs = 0;
+	r_numvissurfs = 0;
 
-	if (c)
+	for (i = 0; i < cl.cmodel_precache[1]->numleafs; i++)
 	{
-		surf = BMODEL (cl.worldmodel)->surfaces + node->firstsurface;
+		if (!(vis[i >> 3] & (1 << (i & 7))))
+			continue;
+
+		leaf = &cl.cmodel_precache[1]->leafs[i + 1];
+		if (leaf->contents == CONTENTS_SOLID)
+			continue;
+
+		R_AddVisLeaf (leaf);
 
-		if (dot < 0 - BACKFACE_EPSILON)
-			side = SURF_PLANEBACK;
-		else if (dot > BACKFACE_EPSILON)
-			side = 0;
+		mark = brush->marksurfaces + leaf->firstmarksurface;
+		for (j = 0; j < leaf->nummarksurfaces; j++)
 		{
-			for (; c; c--, surf++)
-			{
-				if (surf->flags & SURF_NODRAW)
-					continue;
+			surf = mark[j];
+			if (r_vissurfmark[surf - brush->surfaces] || (surf->flags & SURF_NODRAW))
+				continue;
+			r_vissurfmark[surf - brush->surfaces] = 1;
+			r_vissurfs[r_numvissurfs++] = surf;
+		}
+	}
 
-				if (surf->visframe != r_framecount)
-					continue;
+	// the padding is culled with a mask, it only needs to be defined
+	for (i = r_numvisleafs; i & 3; i++)
+		for (j = 0; j < 6; j++)
+			r_visbounds[j][i] = 0;
+}
 
-				// don't backface underwater surfaces, because they warp
-				if (!(surf->flags & SURF_UNDERWATER) && ((dot < 0) ^ !!(surf->flags & SURF_PLANEBACK)))
-					continue; // wrong side
+// marks the surfaces of a leaf that survived the frustum
+static void R_MarkVisLeaf (mleaf_t *leaf, msurface_t **surfs)
+{
+	msurface_t **mark;
+	int c;
 
-				// if sorting by texture, just store it out
-				if (gl_texsort.value)
-				{
-					surf->texturechain = surf->texinfo->texture->texturechain;
-					surf->texinfo->texture->texturechain = surf;
-				}
-				else if (surf->flags & SURF_DRAWSKY)
-				{
-					surf->texturechain = skychain;
-					skychain = surf;
-				}
-				else if (surf->flags & SURF_DRAWTURB)
-				{
-					surf->texturechain = waterchain;
-					waterchain = surf;
-				}
-				else
-					R_DrawSequentialPoly (surf);
-			}
+	mark = surfs + leaf->firstmarksurface;
+	for (c = leaf->nummarksurfaces; c; c--, mark++)
+		(*mark)->visframe = r_framecount;
+
+	// deal with model fragments in this leaf
+	if (leaf->efrags)
+		R_StoreEfrags (&leaf->efrags);
+}
+
+/*
+===============
+R_CullVisLeafs
+
+A box is outside a plane when its corner furthest along the normal is
+behind it, so each plane picks the min or max array for every axis once
+===============
+*/
+static void R_CullVisLeafs (msurface_t **surfs)
+{
+	float *corner[4][3];
+	int i, j, k;
+#ifdef __SSE__
+	__m128 nx[4], ny[4], nz[4], dist[4], out;
+	int mask;
+#endif
+
+	for (i = 0; i < 4; i++)
+		for (j = 0; j < 3; j++)
+			corner[i][j] = r_visbounds[frustum[i].normal[j] >= 0 ? j + 3 : j];
+
+#ifdef __SSE__
+	for (i = 0; i < 4; i++)
+	{
+		nx[i] = _mm_set1_ps (frustum[i].normal[0]);
+		ny[i] = _mm_set1_ps (frustum[i].normal[1]);
+		nz[i] = _mm_set1_ps (frustum[i].normal[2]);
+		dist[i] = _mm_set1_ps (frustum[i].dist);
+	}
+
+	for (k = 0; k < r_numvisleafs; k += 4)
+	{
+		out = _mm_setzero_ps ();
+		for (i = 0; i < 4; i++)
+		{
+			__m128 d;
+
+			d = _mm_mul_ps (nx[i], _mm_loadu_ps (corner[i][0] + k));
+			d = _mm_add_ps (d, _mm_mul_ps (ny[i], _mm_loadu_ps (corner[i][1] + k)));
+			d = _mm_add_ps (d, _mm_mul_ps (nz[i], _mm_loadu_ps (corner[i][2] + k)));
+			out = _mm_or_ps (out, _mm_cmplt_ps (d, dist[i]));
 		}
+
+		mask = ~_mm_movemask_ps (out) & 15;
+		if (r_numvisleafs - k < 4)
+			mask &= (1 << (r_numvisleafs - k)) - 1;
+		for (j = 0; mask; j++, mask >>= 1)
+			if (mask & 1)
+				R_MarkVisLeaf (r_visleafs[k + j], surfs);
+	}
+#else
+	for (k = 0; k < r_numvisleafs; k++)
+	{
+		for (i = 0; i < 4; i++)
+			if (frustum[i].normal[0] * corner[i][0][k] + frustum[i].normal[1] * corner[i][1][k] + frustum[i].normal[2] * corner[i][2][k] < frustum[i].dist)
+				break;
+		if (i == 4)
+			R_MarkVisLeaf (r_visleafs[k], surfs);
 	}
+#endif
+}
+
+static void R_DrawVisSurfaces (void)
+{
+	msurface_t *surf;
+	mplane_t *plane;
+	double dot;
+	int i;
+
+	for (i = 0; i < r_numvissurfs; i++)
+	{
+		surf = r_vissurfs[i];
+		if (surf->visframe != r_framecount)
+			continue;
+
+		plane = surf->plane;
+		if (plane->type < 3)
+			dot = modelorg[plane->type] - plane->dist;
+		else
+			dot = DotProduct (modelorg, plane->normal) - plane->dist;
 
-	// recurse down the back side
-	R_RecursiveWorldNode (surfs, node->children[!side]);
+		// don't backface underwater surfaces, because they warp
+		if (!(surf->flags & SURF_UNDERWATER) && ((dot < 0) ^ !!(surf->flags & SURF_PLANEBACK)))
+			continue; // wrong side
+
+		// if sorting by texture, just store it out
+		if (gl_texsort.value)
+		{
+			surf->texturechain = surf->texinfo->texture->texturechain;
+			surf->texinfo->texture->texturechain = surf;
+		}
+		else if (surf->flags & SURF_DRAWSKY)
+		{
+			surf->texturechain = skychain;
+			skychain = surf;
+		}
+		else if (surf->flags & SURF_DRAWTURB)
+		{
+			surf->texturechain = waterchain;
+			waterchain = surf;
+		}
+		else
+		{ // drawn by R_DrawSequentialChains
+			surf->texturechain = surf->texinfo->texture->texturechain;
+			surf->texinfo->texture->texturechain = surf;
+		}
+	}
 }
 
 void R_DrawWorld (void)
@@ -1189,52 +1749,110 @@ void R_DrawWorld (void)
 
 	glEnable (GL_STENCIL_TEST);
 
-	R_RecursiveWorldNode (BMODEL (cl.worldmodel)->marksurfaces, cl.cmodel_precache[1]->nodes);
+	R_CullVisLeafs (BMODEL (cl.worldmodel)->marksurfaces);
+	R_DrawVisSurfaces ();
+
+	R_BeginVBO ();
 
 	DrawTextureChains ();
 
 	R_BlendLightmaps ();
 
+	R_EndVBO ();
 	glDisable (GL_STENCIL_TEST);
 
 	R_DrawSkyBox ();
 }
 
-void R_MarkLeaves (void)
+/*
+====================
+R_LightmapBench_f
+
+Times the lightmap builder over the surfaces of the world, first building
+each from scratch as at load time, then with every animated style changing.
+with -headless it can be run from a script
+====================
+*/
+void R_LightmapBench_f (void)
 {
-	byte *vis;
-	mnode_t *node;
-	int i;
-	byte solid[4096];
+	int i, j, passes, count, rebuilt, maps;
+	int saved[MAX_LIGHTSTYLES];
+	msurface_t *surf;
+	double start, full, styles = 0;
 
-	if (r_oldviewleaf == r_viewleaf && !r_novis.value)
+	if (!cl.worldmodel)
+	{
+		Con_Printf ("no map loaded\n");
 		return;
+	}
 
-	r_visframecount++;
-	r_oldviewleaf = r_viewleaf;
+	passes = Cmd_Argc () > 1 ? atoi (Cmd_Argv (1)) : 10;
+	if (passes < 1)
+		passes = 1;
 
-	if (r_novis.value)
+	count = 0;
+	start = Sys_FloatTime ();
+	for (i = 0; i < passes; i++)
 	{
-		vis = solid;
-		memset (solid, 0xff, (cl.cmodel_precache[1]->numleafs + 7) >> 3);
+		for (j = 0, surf = BMODEL (cl.worldmodel)->surfaces; j < BMODEL (cl.worldmodel)->numsurfaces; j++, surf++)
+		{
+			if (surf->flags & (SURF_DRAWSKY | SURF_DRAWTURB | SURF_NODRAW))
+				continue;
+			if (surf->stylesum)
+			{
+				memset (surf->cached_light, 0, sizeof (surf->cached_light));
+				memset (surf->stylesum, 0, ((surf->extents[0] >> 4) + 1) * ((surf->extents[1] >> 4) + 1) * d_lightmap_bytes * sizeof (*surf->stylesum));
+			}
+			R_BuildSurfaceLightmap (surf);
+			count++;
+		}
 	}
-	else
-		vis = CMod_LeafPVS (r_viewleaf, cl.cmodel_precache[1]);
+	full = Sys_FloatTime () - start;
 
-	for (i = 0; i < cl.cmodel_precache[1]->numleafs; i++)
+	// style 0 never animates, the others all step each pass
+	memcpy (saved, d_lightstylevalue, sizeof (saved));
+	rebuilt = 0;
+	start = Sys_FloatTime ();
+	for (i = 0; i <= passes; i++)
 	{
-		if (vis[i >> 3] & (1 << (i & 7)))
+		for (j = 1; j < MAX_LIGHTSTYLES; j++)
+			d_lightstylevalue[j] = i == passes ? saved[j] : saved[j] + 22 * (1 + (i & 1));
+
+		for (j = 0, surf = BMODEL (cl.worldmodel)->surfaces; j < BMODEL (cl.worldmodel)->numsurfaces; j++, surf++)
 		{
-			node = (mnode_t *)&cl.cmodel_precache[1]->leafs[i + 1];
-			do
-			{
-				if (node->visframe == r_visframecount)
+			if (surf->flags & (SURF_DRAWSKY | SURF_DRAWTURB | SURF_NODRAW))
+				continue;
+			for (maps = 0; maps < MAXLIGHTMAPS && surf->styles[maps] != 255; maps++)
+				if (d_lightstylevalue[surf->styles[maps]] != surf->cached_light[maps])
 					break;
-				node->visframe = r_visframecount;
-				node = node->parent;
-			} while (node);
+			if (maps == MAXLIGHTMAPS || surf->styles[maps] == 255)
+				continue;
+			R_BuildSurfaceLightmap (surf);
+			if (i < passes)
+				rebuilt++;
 		}
+
+		// the last pass puts the styles back, and isn't timed
+		if (i == passes - 1)
+			styles = Sys_FloatTime () - start;
 	}
+
+	// the textures are sent up again as a whole next frame
+	for (i = 0; i < lightmap_numpages; i++)
+	{
+		lightmap_modified[i] = true;
+		lightmap_rectchange[i].l = 0;
+		lightmap_rectchange[i].t = 0;
+		lightmap_rectchange[i].w = block_width;
+		lightmap_rectchange[i].h = block_height;
+	}
+
+	Con_Printf ("%i passes, %i surfaces\n", passes, count / passes);
+	Con_Printf ("full:   %.3f ms per pass, %.3f us per surface\n", full * 1000 / passes, full * 1000000 / count);
+	if (rebuilt)
+		Con_Printf ("styles: %.3f ms per pass, %.3f us per surface, %i surfaces per pass\n", styles * 1000 / passes, styles * 1000000 / rebuilt, rebuilt / passes);
+	else
+		Con_Printf ("styles: no animated surfaces\n");
 }
 
 /*
@@ -1245,40 +1863,80 @@ void R_MarkLeaves (void)
 =============================================================================
 */
 
-// returns a texture number and the position inside it
+/*
+================
+AllocBlock
+
+Returns a page and the position inside it.  Each page keeps the height of
+every column, the block goes where its top ends up lowest, and of those
+where it leaves the least space unused beneath it.  Blocks come in tallest
+first, so the short ones fill in around them
+================
+*/
 static int AllocBlock (int w, int h, int *x, int *y)
 {
 	int i, j;
-	int best, best2;
+	int best, best2, waste, bestwaste;
 	int texnum;
+	unsigned short *col;
 
 	for (texnum = 0; texnum < MAX_LIGHTMAPS; texnum++)
 	{
-		best = BLOCK_HEIGHT;
+		if (allocated_min[texnum] + h > block_height)
+			continue; // no room anywhere
 
-		for (i = 0; i < BLOCK_WIDTH - w; i++)
+		col = allocated[texnum];
+		best = block_height;
+		bestwaste = 0;
+
+		for (i = 0; i <= block_width - w; i++)
 		{
 			best2 = 0;
 
 			for (j = 0; j < w; j++)
 			{
-				if (allocated[texnum][i + j] >= best)
+				if (col[i + j] > best)
 					break;
-				if (allocated[texnum][i + j] > best2)
-					best2 = allocated[texnum][i + j];
+				if (col[i + j] > best2)
+					best2 = col[i + j];
+			}
+			if (j < w)
+			{
+				i += j; // every spot over this column is as bad
+				continue;
 			}
-			if (j == w)
-			{ // this is a valid spot
+
+			waste = 0;
+			for (j = 0; j < w; j++)
+				waste += best2 - col[i + j];
+
+			if (best2 < best || (best2 == best && waste < bestwaste))
+			{ // this is a better spot
 				*x = i;
 				*y = best = best2;
+				bestwaste = waste;
 			}
 		}
 
-		if (best + h > BLOCK_HEIGHT)
+		if (best + h > block_height)
 			continue;
 
 		for (i = 0; i < w; i++)
-			allocated[texnum][*x + i] = best + h;
+			col[*x + i] = best + h;
+
+		if (best == allocated_min[texnum])
+		{ // may have covered the lowest column
+			allocated_min[texnum] = block_height;
+			for (i = 0; i < block_width; i++)
+				if (col[i] < allocated_min[texnum])
+					allocated_min[texnum] = col[i];
+		}
+
+		if (!lightmaps[texnum])
+		{
+			lightmaps[texnum] = Hunk_AllocName (block_width * block_height * lightmap_bytes, "lightmap");
+			lightmap_numpages = texnum + 1;
+		}
 
 		return texnum;
 	}
@@ -1341,13 +1999,13 @@ static void BuildSurfaceDisplayList (msurface_t *fa)
 		s -= fa->texturemins[0];
 		s += fa->light_s * 16;
 		s += 8;
-		s /= BLOCK_WIDTH * 16; //fa->texinfo->texture->width;
+		s /= block_width * 16; //fa->texinfo->texture->width;
 
 		t = DotProduct (vec, fa->texinfo->vecs[1]) + fa->texinfo->vecs[1][3];
 		t -= fa->texturemins[1];
 		t += fa->light_t * 16;
 		t += 8;
-		t /= BLOCK_HEIGHT * 16; //fa->texinfo->texture->height;
+		t /= block_height * 16; //fa->texinfo->texture->height;
 
 		poly->verts[i][5] = s;
 		poly->verts[i][6] = t;
@@ -1395,18 +2053,37 @@ static void BuildSurfaceDisplayList (msurface_t *fa)
 static void GL_CreateSurfaceLightmap (msurface_t *surf)
 {
 	int smax, tmax;
-	byte *base;
-
-	if (surf->flags & (SURF_DRAWSKY | SURF_DRAWTURB | SURF_NODRAW))
-		return;
 
 	smax = (surf->extents[0] >> 4) + 1;
 	tmax = (surf->extents[1] >> 4) + 1;
 
 	surf->lightmaptexturenum = AllocBlock (smax, tmax, &surf->light_s, &surf->light_t);
-	base = lightmaps + surf->lightmaptexturenum * lightmap_bytes * BLOCK_WIDTH * BLOCK_HEIGHT;
-	base += (surf->light_t * BLOCK_WIDTH + surf->light_s) * lightmap_bytes;
-	R_BuildLightMap (surf, base, BLOCK_WIDTH * lightmap_bytes);
+
+	// the sum starts out with every style at zero
+	memset (surf->cached_light, 0, sizeof (surf->cached_light));
+	surf->stylesum = NULL;
+	if (surf->samples && surf->styles[0] != 255 && surf->styles[1] != 255)
+		surf->stylesum = Hunk_Alloc (smax * tmax * d_lightmap_bytes * sizeof (*surf->stylesum));
+
+	// built along with the rest once every block is allocated
+	if (r_numlightqueue == MAX_LIGHTQUEUE)
+		R_FlushLightmaps ();
+	r_lightqueue[r_numlightqueue++] = surf;
+}
+
+static int GL_LightmapCompare (const void *a, const void *b)
+{
+	msurface_t *s1, *s2;
+
+	s1 = *(msurface_t **)a;
+	s2 = *(msurface_t **)b;
+
+	// tallest first, then widest
+	if (s1->extents[1] != s2->extents[1])
+		return s2->extents[1] - s1->extents[1];
+	if (s1->extents[0] != s2->extents[0])
+		return s2->extents[0] - s1->extents[0];
+	return (s1 > s2) - (s1 < s2);
 }
 
 /*
@@ -1419,10 +2096,29 @@ with all the surfaces from all brush models
 */
 void GL_BuildLightmaps (void)
 {
-	int i, j;
+	int i, j, size, maxsize, numsurfs;
 	model_t *m;
+	msurface_t *surf, **surfs;
 
 	memset (allocated, 0, sizeof (allocated));
+	memset (allocated_min, 0, sizeof (allocated_min));
+	memset (lightmaps, 0, sizeof (lightmaps)); // the hunk they were on is gone
+	lightmap_numpages = 0;
+	r_numlightqueue = 0;
+
+	glGetIntegerv (GL_MAX_TEXTURE_SIZE, &maxsize);
+	i = COM_CheckParm ("-lightmapsize");
+	if (i && i < com_argc - 1)
+		size = atoi (com_argv[i + 1]);
+	else
+		size = LIGHTMAP_SIZE;
+	if (size > maxsize)
+		size = maxsize;
+	if (size > MAX_LIGHTMAP_SIZE)
+		size = MAX_LIGHTMAP_SIZE;
+	for (block_width = MIN_LIGHTMAP_SIZE; block_width * 2 <= size; block_width *= 2)
+		;
+	block_height = block_width;
 
 	r_framecount = 1; // no dlightcache
 
@@ -1460,6 +2156,45 @@ void GL_BuildLightmaps (void)
 		break;
 	}
 
+	//
+	// place the blocks of every brush model, in order of size
+	//
+	numsurfs = 0;
+	for (j = 1; j < MAX_MODELS; j++)
+	{
+		m = cl.model_precache[j];
+		if (!m)
+			break;
+		if (m->type != mod_brush)
+			continue;
+		if (m->name[0] == '*')
+			continue;
+		numsurfs += BMODEL (m)->numsurfaces;
+	}
+
+	surfs = Z_Malloc (numsurfs * sizeof (*surfs) + 1);
+	numsurfs = 0;
+	for (j = 1; j < MAX_MODELS; j++)
+	{
+		m = cl.model_precache[j];
+		if (!m)
+			break;
+		if (m->type != mod_brush)
+			continue;
+		if (m->name[0] == '*')
+			continue;
+		for (i = 0, surf = BMODEL (m)->surfaces; i < BMODEL (m)->numsurfaces; i++, surf++)
+			if (!(surf->flags & (SURF_DRAWSKY | SURF_DRAWTURB | SURF_NODRAW)))
+				surfs[numsurfs++] = surf;
+	}
+
+	qsort (surfs, numsurfs, sizeof (*surfs), GL_LightmapCompare);
+	for (i = 0; i < numsurfs; i++)
+		GL_CreateSurfaceLightmap (surfs[i]);
+	Z_Free (surfs);
+
+	R_FlushLightmaps ();
+
 	for (j = 1; j < MAX_MODELS; j++)
 	{
 		m = cl.model_precache[j];
@@ -1473,7 +2208,6 @@ void GL_BuildLightmaps (void)
 		currentmodel = m;
 		for (i = 0; i < BMODEL (m)->numsurfaces; i++)
 		{
-			GL_CreateSurfaceLightmap (BMODEL (m)->surfaces + i);
 			if (BMODEL (m)->surfaces[i].flags & (SURF_DRAWTURB | SURF_DRAWSKY))
 				continue;
 			BuildSurfaceDisplayList (BMODEL (m)->surfaces + i);
@@ -1486,22 +2220,21 @@ void GL_BuildLightmaps (void)
 	//
 	// upload all lightmaps that were filled
 	//
-	for (i = 0; i < MAX_LIGHTMAPS; i++)
+	for (i = 0; i < lightmap_numpages; i++)
 	{
-		if (!allocated[i][0])
-			break; // no more used
 		lightmap_modified[i] = false;
-		lightmap_rectchange[i].l = BLOCK_WIDTH;
-		lightmap_rectchange[i].t = BLOCK_HEIGHT;
+		lightmap_rectchange[i].l = block_width;
+		lightmap_rectchange[i].t = block_height;
 		lightmap_rectchange[i].w = 0;
 		lightmap_rectchange[i].h = 0;
 		GL_Bind (lightmap_textures + i);
 		glTexParameterf (GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
 		glTexParameterf (GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-		glTexImage2D (GL_TEXTURE_2D, 0, lightmap_bytes, BLOCK_WIDTH, BLOCK_HEIGHT, 0, gl_lightmap_format, GL_UNSIGNED_BYTE,
-					  lightmaps + i * BLOCK_WIDTH * BLOCK_HEIGHT * lightmap_bytes);
+		glTexImage2D (GL_TEXTURE_2D, 0, lightmap_bytes, block_width, block_height, 0, gl_lightmap_format, GL_UNSIGNED_BYTE, lightmaps[i]);
 	}
 
 	if (!gl_texsort.value)
 		GL_SelectTexture (TEXTURE0_SGIS);
+
+	GL_BuildWorldVBO ();
 }
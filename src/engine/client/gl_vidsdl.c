@@ -31,6 +31,7 @@ int texture_extension_number = 1;
 SDL_Window *window = NULL;
 
 bool gl_mtexable = false;
+bool gl_vboable = false;
 
 unsigned int d_8to24table[256];
 
@@ -43,6 +44,8 @@ static SDL_GLContext context = NULL;
 
 static int scr_width, scr_height;
 
+static bool vid_headless; // offscreen, for benchmarking without a display
+
 void VID_Shutdown (void)
 {
 	if (context)
@@ -136,6 +139,46 @@ static void GL_CheckMultiTextureExtensions (void)
 	}
 }
 
+/*
+===============
+GL_CheckVBOExtensions
+
+Buffers are core from 1.5, and GL_ARB_vertex_buffer_object before that.
+GetProcAddress alone proves nothing, glX hands out a pointer for any name
+===============
+*/
+static void GL_CheckVBOExtensions (void)
+{
+	int major, minor;
+	char *suffix;
+
+	if (COM_CheckParm ("-novbo"))
+		return;
+
+	if (sscanf ((char *)gl_version, "%d.%d", &major, &minor) == 2 && (major > 1 || (major == 1 && minor >= 5)))
+		suffix = "";
+	else if (strstr (gl_extensions, "GL_ARB_vertex_buffer_object"))
+		suffix = "ARB";
+	else
+	{
+		Con_Printf ("Vertex buffers not supported, disabled.\n");
+		return;
+	}
+
+	qglGenBuffers = SDL_GL_GetProcAddress (va ("glGenBuffers%s", suffix));
+	qglDeleteBuffers = SDL_GL_GetProcAddress (va ("glDeleteBuffers%s", suffix));
+	qglBindBuffer = SDL_GL_GetProcAddress (va ("glBindBuffer%s", suffix));
+	qglBufferData = SDL_GL_GetProcAddress (va ("glBufferData%s", suffix));
+
+	if (qglGenBuffers && qglDeleteBuffers && qglBindBuffer && qglBufferData)
+	{
+		Con_Printf ("Vertex buffers found.\n");
+		gl_vboable = true;
+	}
+	else
+		Con_Printf ("Vertex buffers not found, disabled.\n");
+}
+
 static void GL_Init (void)
 {
 	gl_vendor = glGetString (GL_VENDOR);
@@ -151,6 +194,7 @@ static void GL_Init (void)
 		Con_Printf ("GL_EXTENSIONS: %s\n", gl_extensions);
 
 	GL_CheckMultiTextureExtensions ();
+	GL_CheckVBOExtensions ();
 
 	glClearColor (0.5, 0.5, 0.5, 1);
 	glCullFace (GL_FRONT);
@@ -275,7 +319,9 @@ static void VID_CheckParms (int *width, int *height, bool *fullscreen)
 {
 	int i;
 
-	if ((i = COM_CheckParm ("-window")) != 0)
+	vid_headless = COM_CheckParm ("-headless") != 0;
+
+	if ((i = COM_CheckParm ("-window")) != 0 || vid_headless)
 		*fullscreen = false;
 	else
 		*fullscreen = true;
@@ -321,6 +367,11 @@ void VID_Init (char *palette)
 	bool fullscreen;
 	VID_CheckParms (&width, &height, &fullscreen);
 
+	// sdl's offscreen driver renders into an egl pbuffer, so with mesa's
+	// software rasterizer the whole client runs without a gpu or display
+	if (vid_headless)
+		setenv ("SDL_VIDEODRIVER", "offscreen", 1);
+
 	if (SDL_Init (SDL_INIT_VIDEO) < 0)
 		Sys_Error ("Error couldn't open SDL: %s\n", SDL_GetError ());
 
@@ -344,13 +395,18 @@ void VID_Init (char *palette)
 	if (!window)
 		Sys_Error ("Error couldn't create window: %s\n", SDL_GetError ());
 
-	VID_SetMode (width, height, fullscreen);
+	if (!vid_headless)
+		VID_SetMode (width, height, fullscreen);
 
 	context = SDL_GL_CreateContext (window);
 
 	if (!context)
 		Sys_Error ("Error couldn't create OpenGL context: %s\n", SDL_GetError ());
 
+	// nothing is shown, so don't wait for a refresh that never comes
+	if (vid_headless)
+		SDL_GL_SetSwapInterval (0);
+
 	scr_width = width;
 	scr_height = height;
 
@@ -374,5 +430,6 @@ void VID_Init (char *palette)
 	// force a surface cache flush
 	vid.recalc_refdef = true;
 
-	SDL_ShowWindow (window);
+	if (!vid_headless)
+		SDL_ShowWindow (window);
 }
@@ -15,6 +15,11 @@ extern int gl_filter_max;
 void GL_LoadTexture (int *gl_texturenum, int *gl_brightnum, char *identifier, int width, int height, byte *data, int bytes, int colors, byte *pal, bool mipmap,
 					 bool alpha);
 
+// textures loaded in between are prepared on the workers, and are all up
+// once GL_EndTextureBatch returns.  their data has to stay put until then
+void GL_BeginTextureBatch (void);
+void GL_EndTextureBatch (void);
+
 extern int glx, gly, glwidth, glheight;
 
 #define BACKFACE_EPSILON 0.01f
@@ -87,6 +92,7 @@ extern cvar_t r_fence;
 extern cvar_t r_luminescent;
 extern cvar_t r_zmax;
 extern cvar_t r_wireframe;
+extern cvar_t r_lerpmodels;
 
 extern cvar_t gl_clear;
 extern cvar_t gl_poly;
@@ -95,6 +101,8 @@ extern cvar_t gl_smoothmodels;
 extern cvar_t gl_affinemodels;
 extern cvar_t gl_polyblend;
 extern cvar_t gl_keeptjunctions;
+extern cvar_t gl_vbo;
+extern cvar_t gl_aliasarrays;
 extern cvar_t gl_partblend;
 
 extern cvar_t gl_max_size;
@@ -119,6 +127,18 @@ extern lpSelTexFUNC qglSelectTextureSGIS;
 
 extern bool gl_mtexable;
 
+// Vertex buffers
+typedef void (APIENTRY *lpGenBuffersFUNC) (GLsizei, GLuint *);
+typedef void (APIENTRY *lpDeleteBuffersFUNC) (GLsizei, const GLuint *);
+typedef void (APIENTRY *lpBindBufferFUNC) (GLenum, GLuint);
+typedef void (APIENTRY *lpBufferDataFUNC) (GLenum, GLsizeiptr, const void *, GLenum);
+extern lpGenBuffersFUNC qglGenBuffers;
+extern lpDeleteBuffersFUNC qglDeleteBuffers;
+extern lpBindBufferFUNC qglBindBuffer;
+extern lpBufferDataFUNC qglBufferData;
+
+extern bool gl_vboable;
+
 void GL_DisableMultitexture (void);
 void GL_EnableMultitexture (void);
 
@@ -154,6 +174,7 @@ void R_DrawWaterSurfaces (void);
 void R_DrawBrushModel (entity_t *e);
 void R_DrawWorld (void);
 void GL_BuildLightmaps (void);
+void R_LightmapBench_f (void);
 
 // gl_ngraph.c
 void R_NetGraph (void);
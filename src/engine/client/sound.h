@@ -22,6 +22,11 @@ typedef struct sfx_s
 	bool stereo;
 	float duration;
 	ALuint al_buffers[2];
+
+	// sounds past the base set stay cached between levels
+	cache_t cache;
+	unsigned crc; // of the file it was loaded from
+	bool stale;	  // kept from an earlier level, not checked against the file yet
 } sfx_t;
 
 typedef struct
@@ -47,6 +52,7 @@ void S_StopAllSounds (void);
 void S_Update (vec3_t origin, vec3_t v_forward, vec3_t v_right, vec3_t v_up);
 
 sfx_t *S_PrecacheSound (char *sample);
+void S_PrecacheSounds (char **samples, int count, sfx_t **sfx);
 
 void S_SetSoundPaused (bool paused);
 
@@ -58,6 +64,8 @@ extern cvar_t volume;
 
 void S_LocalSound (sfx_t *sfx);
 bool S_LoadSound (sfx_t *s);
+void S_PreloadSounds (char **names, int count);
+void S_ReleasePreload (void);
 void S_SetAmbientActive (bool active);
 void S_InitBase (void);
 void S_ClearAll (void);
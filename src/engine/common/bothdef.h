@@ -12,6 +12,7 @@
 #include <stdbool.h>
 #include <stdint.h>
 #include <stddef.h>
+#include <stdatomic.h>
 
 #define MINIMUM_MEMORY 0x550000
 #define MINIMUM_MEMORY_LEVELPAK (MINIMUM_MEMORY + 0x100000)
@@ -208,6 +209,9 @@ enum
 #include "net.h"
 #include "protocol.h"
 #include "crc.h"
+#include "inflate.h"
+#include "task.h"
+#include "log.h"
 #include "cmodel.h"
 #include "host.h"
 #include "pmove.h"
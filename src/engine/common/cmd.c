@@ -24,15 +24,18 @@ along with this program.  If not, see <https://www.gnu.org/licenses/>.
 cmd_source_e cmd_source;
 
 #define MAX_ALIAS_NAME 32
+#define ALIAS_HASH_SIZE 256 // power of two
 
 typedef struct cmdalias_s
 {
 	struct cmdalias_s *next;
+	struct cmdalias_s *hashnext;
 	char name[MAX_ALIAS_NAME];
 	char *value;
 } cmdalias_t;
 
 static cmdalias_t *cmd_alias;
+static cmdalias_t *cmd_aliashash[ALIAS_HASH_SIZE];
 
 static bool cmd_wait[2];
 
@@ -311,6 +314,17 @@ char *CopyString (char *in)
 	return out;
 }
 
+static cmdalias_t *Cmd_FindAlias (char *name)
+{
+	cmdalias_t *a;
+
+	for (a = cmd_aliashash[COM_HashName (name) & (ALIAS_HASH_SIZE - 1)]; a; a = a->hashnext)
+		if (!strcasecmp (name, a->name))
+			return a;
+
+	return NULL;
+}
+
 /*
 ===============
 Cmd_Alias_f
@@ -323,6 +337,7 @@ static void Cmd_Alias_f (void)
 	cmdalias_t *a;
 	char cmd[1024];
 	int i, c;
+	unsigned int hash;
 	char *s;
 
 	if (Cmd_Argc () == 1)
@@ -341,20 +356,18 @@ static void Cmd_Alias_f (void)
 	}
 
 	// if the alias allready exists, reuse it
-	for (a = cmd_alias; a; a = a->next)
-	{
-		if (!strcmp (s, a->name))
-		{
-			Z_Free (a->value);
-			break;
-		}
-	}
-
-	if (!a)
+	a = Cmd_FindAlias (s);
+	if (a)
+		Z_Free (a->value);
+	else
 	{
 		a = Z_Malloc (sizeof (cmdalias_t));
 		a->next = cmd_alias;
 		cmd_alias = a;
+
+		hash = COM_HashName (s) & (ALIAS_HASH_SIZE - 1);
+		a->hashnext = cmd_aliashash[hash];
+		cmd_aliashash[hash] = a;
 	}
 	strcpy (a->name, s);
 
@@ -380,9 +393,12 @@ static void Cmd_Alias_f (void)
 =============================================================================
 */
 
+#define CMD_HASH_SIZE 256 // power of two
+
 typedef struct cmd_function_s
 {
 	struct cmd_function_s *next[2];
+	struct cmd_function_s *hashnext[2];
 	char *name;
 	xcommand_t function;
 } cmd_function_t;
@@ -395,6 +411,8 @@ static char *cmd_null_string = "";
 static char *cmd_args[2] = {NULL, NULL};
 
 static cmd_function_t *cmd_functions[2]; // possible commands to execute
+static cmd_function_t *cmd_hash[2][CMD_HASH_SIZE];
+static namelist_t cmd_names[2]; // for completion
 
 int Cmd_Argc (void)
 {
@@ -465,9 +483,22 @@ void Cmd_TokenizeString (cmd_source_e src, char *text)
 	}
 }
 
+static cmd_function_t *Cmd_FindCommand (cmd_source_e src, char *cmd_name)
+{
+	cmd_function_t *cmd;
+
+	cmd = cmd_hash[src][COM_HashName (cmd_name) & (CMD_HASH_SIZE - 1)];
+	for (; cmd; cmd = cmd->hashnext[src])
+		if (!strcasecmp (cmd_name, cmd->name))
+			return cmd;
+
+	return NULL;
+}
+
 void Cmd_AddCommand (cmd_source_e src, char *cmd_name, xcommand_t function)
 {
 	cmd_function_t *cmd;
+	unsigned int hash;
 
 	if (host_initialized) // because hunk allocation would get stomped
 		Sys_Error ("Cmd_AddCommand after host_initialized");
@@ -487,13 +518,10 @@ void Cmd_AddCommand (cmd_source_e src, char *cmd_name, xcommand_t function)
 	}
 
 	// fail if the command already exists
-	for (cmd = cmd_functions[src]; cmd; cmd = cmd->next[src])
+	if (Cmd_FindCommand (src, cmd_name))
 	{
-		if (!strcmp (cmd_name, cmd->name))
-		{
-			Con_Printf ("Cmd_AddCommand: %s already defined\n", cmd_name);
-			return;
-		}
+		Con_Printf ("Cmd_AddCommand: %s already defined\n", cmd_name);
+		return;
 	}
 
 	cmd = Hunk_Alloc (sizeof (cmd_function_t));
@@ -501,53 +529,33 @@ void Cmd_AddCommand (cmd_source_e src, char *cmd_name, xcommand_t function)
 	cmd->function = function;
 	cmd->next[src] = cmd_functions[src];
 	cmd_functions[src] = cmd;
-}
 
-bool Cmd_Exists (cmd_source_e src, char *cmd_name)
-{
-	cmd_function_t *cmd;
-
-	for (cmd = cmd_functions[src]; cmd; cmd = cmd->next[src])
-		if (!strcmp (cmd_name, cmd->name))
-			return true;
+	hash = COM_HashName (cmd_name) & (CMD_HASH_SIZE - 1);
+	cmd->hashnext[src] = cmd_hash[src][hash];
+	cmd_hash[src][hash] = cmd;
 
-	return false;
+	COM_AddName (&cmd_names[src], cmd_name);
 }
 
-static void Cmd_GetBestCommand (cmd_source_e src, char *partial, int len, char **best, int *bestlen)
+bool Cmd_Exists (cmd_source_e src, char *cmd_name)
 {
-	cmd_function_t *cmd;
-	int curlen;
-
-	for (cmd = cmd_functions[src]; cmd; cmd = cmd->next[src])
-	{
-		curlen = abs (strlen (cmd->name) - len);
-
-		if (curlen < *bestlen && !strncmp (partial, cmd->name, len))
-		{
-			*best = cmd->name;
-			*bestlen = curlen;
-		}
-	}
+	return Cmd_FindCommand (src, cmd_name) != NULL;
 }
 
 char *Cmd_CompleteCommand (cmd_source_e src, char *partial)
 {
-	int len;
 	char *best = NULL;
 	int bestlen = 999;
 
-	len = strlen (partial);
-
-	if (!len)
+	if (!partial[0])
 		return NULL;
 
 	// check functions
-	Cmd_GetBestCommand (src, partial, len, &best, &bestlen);
+	COM_CompleteName (&cmd_names[src], partial, &best, &bestlen);
 
 	// local game queries server commands, too
 	if (src == src_client && Host_IsLocalGame ())
-		Cmd_GetBestCommand (src_server, partial, len, &best, &bestlen);
+		COM_CompleteName (&cmd_names[src_server], partial, &best, &bestlen);
 
 	return best;
 }
@@ -603,7 +611,6 @@ static void Cmd_ForwardToServer_f (void)
 Cmd_ExecuteString
 
 A complete command line has been parsed, so try to execute it
-FIXME: lookupnoadd the token to speed search?
 ============
 */
 void Cmd_ExecuteString (cmd_source_e src, char *text)
@@ -618,23 +625,19 @@ void Cmd_ExecuteString (cmd_source_e src, char *text)
 		return; // no tokens
 
 	// check functions
-	for (cmd = cmd_functions[src]; cmd; cmd = cmd->next[src])
+	cmd = Cmd_FindCommand (src, cmd_argv[src][0]);
+	if (cmd)
 	{
-		if (!strcasecmp (cmd_argv[src][0], cmd->name))
-		{
-			cmd->function ();
-			return;
-		}
+		cmd->function ();
+		return;
 	}
 
 	// check alias
-	for (a = cmd_alias; a; a = a->next)
+	a = Cmd_FindAlias (cmd_argv[src][0]);
+	if (a)
 	{
-		if (!strcasecmp (cmd_argv[src][0], a->name))
-		{
-			Cbuf_InsertText (src, a->value);
-			return;
-		}
+		Cbuf_InsertText (src, a->value);
+		return;
 	}
 
 	// check cvars
@@ -647,6 +650,104 @@ void Cmd_ExecuteString (cmd_source_e src, char *text)
 		Con_Printf ("Unknown command \"%s\"\n", Cmd_Argv (0));
 }
 
+/*
+============
+Cmd_Bench_f
+
+Resolves the first token of every line of a large generated config the way
+Cmd_ExecuteString does, through the hash tables and then by walking the
+lists, and prints the time per line
+============
+*/
+static void Cmd_Bench_f (void)
+{
+	cmd_source_e src = cmd_source;
+	cmd_function_t *cmd;
+	cmdalias_t *a;
+	char **pool, **lines;
+	int numpool, numlines, hits[2];
+	double time[2];
+	int i, j;
+
+	numlines = Cmd_Argc () > 1 ? atoi (Cmd_Argv (1)) : 100000;
+	if (numlines <= 0)
+	{
+		Con_Printf ("usage: cmdbench [lines]\n");
+		return;
+	}
+
+	// every command, alias and variable name, and something unknown
+	numpool = cmd_names[src].count + cvar_names[src].count + 1;
+	for (a = cmd_alias; a; a = a->next)
+		numpool++;
+
+	pool = Z_Malloc (numpool * sizeof (*pool));
+	numpool = 0;
+	for (i = 0; i < cmd_names[src].count; i++)
+		pool[numpool++] = cmd_names[src].names[i];
+	for (a = cmd_alias; a; a = a->next)
+		pool[numpool++] = a->name;
+	for (i = 0; i < cvar_names[src].count; i++)
+		pool[numpool++] = cvar_names[src].names[i];
+	pool[numpool++] = "nosuchcommand";
+
+	// configs are mostly variables, so weight them the same way
+	lines = Z_Malloc (numlines * sizeof (*lines));
+	for (i = 0; i < numlines; i++)
+	{
+		j = (i * 7919) % numpool;
+		if (i & 1 && cvar_names[src].count)
+			j = numpool - 1 - cvar_names[src].count + (i / 2) % cvar_names[src].count;
+		lines[i] = pool[j];
+	}
+
+	time[0] = Sys_FloatTime ();
+	hits[0] = 0;
+	for (i = 0; i < numlines; i++)
+		if (Cmd_FindCommand (src, lines[i]) || Cmd_FindAlias (lines[i]) || Cvar_FindVar (src, lines[i]))
+			hits[0]++;
+	time[0] = Sys_FloatTime () - time[0];
+
+	time[1] = Sys_FloatTime ();
+	hits[1] = 0;
+	for (i = 0; i < numlines; i++)
+	{
+		for (cmd = cmd_functions[src]; cmd; cmd = cmd->next[src])
+			if (!strcasecmp (lines[i], cmd->name))
+				break;
+		if (cmd)
+		{
+			hits[1]++;
+			continue;
+		}
+
+		for (a = cmd_alias; a; a = a->next)
+			if (!strcasecmp (lines[i], a->name))
+				break;
+		if (a)
+		{
+			hits[1]++;
+			continue;
+		}
+
+		for (j = 0; j < cvar_names[src].count; j++)
+			if (!strcasecmp (lines[i], cvar_names[src].names[j]))
+				break;
+		if (j < cvar_names[src].count)
+			hits[1]++;
+	}
+	time[1] = Sys_FloatTime () - time[1];
+
+	Con_Printf ("%i lines, %i commands, %i variables, %i found\n", numlines, cmd_names[src].count, cvar_names[src].count, hits[0]);
+	Con_Printf ("hashed: %.1f ms, %.0f ns per line\n", time[0] * 1000, time[0] * 1e9 / numlines);
+	Con_Printf ("linear: %.1f ms, %.0f ns per line\n", time[1] * 1000, time[1] * 1e9 / numlines);
+	if (hits[0] != hits[1])
+		Con_Printf ("linear search found %i\n", hits[1]);
+
+	Z_Free (lines);
+	Z_Free (pool);
+}
+
 void Cmd_Init (void)
 {
 	//
@@ -658,4 +759,5 @@ void Cmd_Init (void)
 	Cmd_AddCommand (src_host, "alias", Cmd_Alias_f);
 	Cmd_AddCommand (src_client, "cmd", Cmd_ForwardToServer_f);
 	Cmd_AddCommand (src_host, "wait", Cmd_Wait_f);
+	Cmd_AddCommand (src_host, "cmdbench", Cmd_Bench_f);
 }
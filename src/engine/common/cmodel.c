@@ -168,11 +168,12 @@ Loads a model into the cache
 static void CMod_LoadModel (cmodel_t *mod, bool crash, bool world)
 {
 	uint32_t *buf;
+	size_t len;
 
 	//
 	// load the file
 	//
-	buf = (uint32_t *)COM_LoadTempFile (mod->name);
+	buf = (uint32_t *)COM_MapFile (mod->name, &len);
 	if (!buf)
 	{
 		if (crash)
@@ -206,6 +207,8 @@ static void CMod_LoadModel (cmodel_t *mod, bool crash, bool world)
 		CMod_LoadBrushModel (mod, buf, world);
 		break;
 	}
+
+	COM_UnmapFile ((byte *)buf);
 }
 
 /*
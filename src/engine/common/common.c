@@ -782,6 +782,95 @@ char *va (char *format, ...)
 	return string;
 }
 
+/*
+============
+COM_HashName
+
+case insensitive fnv-1a, for the command and variable tables
+============
+*/
+unsigned int COM_HashName (char *name)
+{
+	unsigned int hash = 2166136261u;
+
+	while (*name)
+		hash = (hash ^ tolower (*name++)) * 16777619u;
+
+	return hash;
+}
+
+static int COM_CompareNames (const void *a, const void *b)
+{
+	return strcmp (*(char **)a, *(char **)b);
+}
+
+/*
+============
+COM_AddName
+
+The name is referenced later, so it should not be in temp memory
+============
+*/
+void COM_AddName (namelist_t *list, char *name)
+{
+	if (list->count == list->size)
+	{
+		list->size = list->size ? list->size * 2 : 256;
+		list->names = Z_Realloc (list->names, list->size * sizeof (*list->names));
+	}
+
+	list->names[list->count++] = name;
+	list->sorted = false;
+}
+
+/*
+============
+COM_CompleteName
+
+Finds the shortest name starting with partial, if it is shorter than
+bestlen.  The list is sorted on the first search after it changes, then
+the matches are found with a binary search.
+============
+*/
+void COM_CompleteName (namelist_t *list, char *partial, char **best, int *bestlen)
+{
+	int len, curlen;
+	int lo, hi, mid;
+
+	if (!list->count)
+		return;
+
+	if (!list->sorted)
+	{
+		qsort (list->names, list->count, sizeof (*list->names), COM_CompareNames);
+		list->sorted = true;
+	}
+
+	// first name that doesn't sort before partial
+	lo = 0;
+	hi = list->count;
+	while (lo < hi)
+	{
+		mid = (lo + hi) / 2;
+		if (strcmp (list->names[mid], partial) < 0)
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+
+	// everything starting with partial follows it
+	len = strlen (partial);
+	for (; lo < list->count && !strncmp (partial, list->names[lo], len); lo++)
+	{
+		curlen = strlen (list->names[lo]) - len;
+		if (curlen < *bestlen)
+		{
+			*best = list->names[lo];
+			*bestlen = curlen;
+		}
+	}
+}
+
 /*
 =============================================================================
 
@@ -796,10 +885,20 @@ size_t com_filesize;
 // in memory
 //
 
+enum
+{
+	PACK_STORED,
+	PACK_DEFLATED,
+};
+
 typedef struct
 {
 	char name[MAX_QPATH];
 	size_t filepos, filelen;
+	size_t complen; // size in the archive, less than filelen when deflated
+	unsigned crc;
+	byte method;
+	bool local; // zip entry, filepos is still its local header
 } packfile_t;
 
 typedef struct pack_s
@@ -808,6 +907,8 @@ typedef struct pack_s
 	int handle;
 	size_t numfiles;
 	packfile_t *files;
+	byte *map; // whole pak mapped read only, NULL if it couldn't be
+	size_t mapsize;
 } pack_t;
 
 //
@@ -828,6 +929,18 @@ typedef struct
 
 #define MAX_FILES_IN_PACK 2048
 
+#define MAX_ZIPS_IN_DIR 256
+
+static int com_numzips;
+
+// zip records, all values little endian
+#define ZIP_LOCAL_SIG 0x04034b50
+#define ZIP_LOCAL_SIZE 30
+#define ZIP_CENTRAL_SIG 0x02014b50
+#define ZIP_CENTRAL_SIZE 46
+#define ZIP_END_SIG 0x06054b50
+#define ZIP_END_SIZE 22
+
 char com_gamedir[MAX_OSPATH];
 
 static char com_cachedir[MAX_OSPATH];
@@ -843,6 +956,314 @@ typedef struct searchpath_s
 static searchpath_t *com_searchpaths;
 static searchpath_t *com_base_searchpaths; // without gamedirs
 
+/*
+=============================================================================
+
+FILE INDEX
+
+every name in the search path is hashed to the pak entry or directory that
+wins for it, so finding a file is one probe instead of a walk over every
+pak directory and a stat per game directory.  directories are scanned once
+when the index is built.  the index is rebuilt on the next lookup after the
+search path changes or COM_FlushFileIndex is called.  files the engine
+writes under the game directory are added with COM_FileWritten.  misses are
+remembered too, so a missing file costs one probe after the first time.
+
+names are matched without regard to case or slash direction
+
+=============================================================================
+*/
+
+#define MAX_INDEX_DEPTH 8 // how deep directories are scanned
+
+typedef struct
+{
+	char *name;			  // NULL for an empty slot
+	searchpath_t *search; // where it was found, NULL if it wasn't
+	packfile_t *packfile; // NULL for a loose file
+} fileindex_t;
+
+static fileindex_t *com_fileindex;
+static int com_fileindex_size; // power of two
+static int com_fileindex_count;
+static int com_fileindex_missing; // remembered misses, part of the count
+static bool com_fileindex_valid;
+
+static int com_lookups;
+static int com_lookup_misses;
+static double com_lookup_time;
+
+static unsigned int COM_HashFileName (char *name)
+{
+	unsigned int hash = 2166136261u;
+	int c;
+
+	while ((c = *name++) != 0)
+	{
+		if (c == '\\')
+			c = '/';
+		hash = (hash ^ tolower (c)) * 16777619u;
+	}
+
+	return hash;
+}
+
+static bool COM_CompareFileName (char *a, char *b)
+{
+	int ca, cb;
+
+	do
+	{
+		ca = *a++;
+		cb = *b++;
+		if (ca == '\\')
+			ca = '/';
+		if (cb == '\\')
+			cb = '/';
+		if (tolower (ca) != tolower (cb))
+			return false;
+	} while (ca);
+
+	return true;
+}
+
+static fileindex_t *COM_IndexSlot (char *name)
+{
+	unsigned int i;
+	fileindex_t *slot;
+
+	for (i = COM_HashFileName (name);; i++)
+	{
+		slot = &com_fileindex[i & (com_fileindex_size - 1)];
+		if (!slot->name || COM_CompareFileName (slot->name, name))
+			return slot;
+	}
+}
+
+static void COM_ClearFileIndex (void)
+{
+	int i;
+
+	for (i = 0; i < com_fileindex_size; i++)
+	{
+		if (com_fileindex[i].name && !com_fileindex[i].packfile)
+			Z_Free (com_fileindex[i].name);
+	}
+
+	memset (com_fileindex, 0, com_fileindex_size * sizeof (*com_fileindex));
+	com_fileindex_count = 0;
+	com_fileindex_missing = 0;
+}
+
+/*
+============
+COM_AddToIndex
+
+Earlier search paths are indexed first, so a name that is already present
+has been overridden and is skipped.  The table is kept at most half full
+============
+*/
+static void COM_AddToIndex (char *name, searchpath_t *search, packfile_t *packfile)
+{
+	fileindex_t *slot, *old;
+	int i, oldsize;
+
+	if ((com_fileindex_count + 1) * 2 > com_fileindex_size)
+	{
+		old = com_fileindex;
+		oldsize = com_fileindex_size;
+
+		com_fileindex_size = oldsize ? oldsize * 2 : 4096;
+		com_fileindex = Z_Malloc (com_fileindex_size * sizeof (*com_fileindex));
+		memset (com_fileindex, 0, com_fileindex_size * sizeof (*com_fileindex));
+
+		for (i = 0; i < oldsize; i++)
+		{
+			if (old[i].name)
+				*COM_IndexSlot (old[i].name) = old[i];
+		}
+
+		if (old)
+			Z_Free (old);
+	}
+
+	slot = COM_IndexSlot (name);
+	if (slot->name)
+		return;
+
+	slot->search = search;
+	slot->packfile = packfile;
+	if (packfile)
+		slot->name = packfile->name;
+	else
+	{
+		slot->name = Z_Malloc (strlen (name) + 1);
+		strcpy (slot->name, name);
+	}
+	com_fileindex_count++;
+}
+
+typedef struct
+{
+	searchpath_t *search;
+	char prefix[MAX_OSPATH]; // relative to search->filename
+	int depth;
+} indexdir_t;
+
+static void COM_IndexDirectoryEntry (char *name, bool isdir, void *arg)
+{
+	indexdir_t *dir = arg;
+	indexdir_t sub;
+	char path[MAX_OSPATH];
+
+	if (name[0] == '.')
+		return;
+
+	if (snprintf (sub.prefix, sizeof (sub.prefix), "%s%s", dir->prefix, name) >= MAX_QPATH)
+		return; // nothing could ask for it
+
+	if (!isdir)
+	{
+		COM_AddToIndex (sub.prefix, dir->search, NULL);
+		return;
+	}
+
+	if (dir->depth == MAX_INDEX_DEPTH)
+		return;
+
+	sub.search = dir->search;
+	sub.depth = dir->depth + 1;
+	snprintf (path, sizeof (path), "%s/%s", dir->search->filename, sub.prefix);
+	strcat (sub.prefix, "/");
+
+	Sys_ListDir (path, COM_IndexDirectoryEntry, &sub);
+}
+
+/*
+============
+COM_BuildFileIndex
+============
+*/
+static void COM_BuildFileIndex (void)
+{
+	searchpath_t *search;
+	indexdir_t dir;
+	size_t i;
+
+	COM_ClearFileIndex ();
+
+	for (search = com_searchpaths; search; search = search->next)
+	{
+		if (search->pack)
+		{
+			for (i = 0; i < search->pack->numfiles; i++)
+				COM_AddToIndex (search->pack->files[i].name, search, &search->pack->files[i]);
+		}
+		else
+		{
+			dir.search = search;
+			dir.prefix[0] = 0;
+			dir.depth = 0;
+			Sys_ListDir (search->filename, COM_IndexDirectoryEntry, &dir);
+		}
+	}
+
+	com_fileindex_valid = true;
+}
+
+/*
+============
+COM_FlushFileIndex
+
+Call after writing a file that may be looked up later
+============
+*/
+void COM_FlushFileIndex (void)
+{
+	com_fileindex_valid = false;
+}
+
+static fileindex_t *COM_FindInIndex (char *filename)
+{
+	fileindex_t *slot;
+
+	if (!com_fileindex_valid)
+		COM_BuildFileIndex ();
+
+	slot = COM_IndexSlot (filename);
+	if (!slot->name && strlen (filename) < MAX_QPATH)
+	{
+		COM_AddToIndex (filename, NULL, NULL);
+		com_fileindex_missing++;
+		return NULL;
+	}
+
+	return slot->search ? slot : NULL;
+}
+
+/*
+============
+COM_FileWritten
+
+Call after writing a file under com_gamedir, with its full path, so it is
+found without rebuilding the index.  It only wins if nothing earlier in the
+search path has the name, as it would with a fresh index
+============
+*/
+void COM_FileWritten (char *path)
+{
+	searchpath_t *search, *gamedir;
+	fileindex_t *slot;
+	size_t len;
+	char *name;
+
+	if (!com_fileindex_valid)
+		return; // it is picked up when the index is built
+
+	len = strlen (com_gamedir);
+	if (strncmp (path, com_gamedir, len) || path[len] != '/')
+		return;
+	name = path + len + 1;
+	if (strlen (name) >= MAX_QPATH)
+		return;
+
+	for (gamedir = com_searchpaths; gamedir; gamedir = gamedir->next)
+	{
+		if (!gamedir->pack && !strcmp (gamedir->filename, com_gamedir))
+			break;
+	}
+	if (!gamedir)
+		return;
+
+	slot = COM_IndexSlot (name);
+	if (!slot->name)
+	{
+		COM_AddToIndex (name, gamedir, NULL);
+		return;
+	}
+
+	if (slot->search)
+	{
+		for (search = com_searchpaths; search != gamedir; search = search->next)
+		{
+			if (search == slot->search)
+				return; // still overridden
+		}
+	}
+	else
+	{
+		com_fileindex_missing--;
+	}
+
+	if (slot->packfile)
+	{ // the name belonged to the pak
+		slot->name = Z_Malloc (strlen (name) + 1);
+		strcpy (slot->name, name);
+	}
+	slot->search = gamedir;
+	slot->packfile = NULL;
+}
+
 static void COM_Path_f (void)
 {
 	searchpath_t *s;
@@ -857,6 +1278,9 @@ static void COM_Path_f (void)
 		else
 			Con_Printf ("%s\n", s->filename);
 	}
+
+	Con_Printf ("%i files indexed, %i misses remembered\n", com_fileindex_count - com_fileindex_missing, com_fileindex_missing);
+	Con_Printf ("%i lookups, %i not found, %.3f ms\n", com_lookups, com_lookup_misses, com_lookup_time * 1000.0);
 }
 
 /*
@@ -883,6 +1307,8 @@ void COM_WriteFile (char *filename, void *data, size_t len)
 	Sys_Printf ("COM_WriteFile: %s\n", name);
 	Sys_FileWrite (handle, data, len);
 	Sys_FileClose (handle);
+
+	COM_FileWritten (name);
 }
 
 /*
@@ -944,19 +1370,309 @@ bool file_from_pak; // global indicating file came from pack file ZOID
 
 /*
 ===========
-COM_FindFile
+COM_LookupFile
 
-Finds the file in the search path.
+Returns the index entry that wins for filename, or NULL
+===========
+*/
+static fileindex_t *COM_LookupFile (char *filename)
+{
+	fileindex_t *entry;
+	double start;
+
+	start = Sys_FloatTime ();
+	entry = COM_FindInIndex (filename);
+	com_lookups++;
+	com_lookup_time += Sys_FloatTime () - start;
+
+	return entry;
+}
+
+/*
+=============================================================================
+
+ZIP ENTRIES
+
+stored zip entries are read like pak entries once the local header has been
+skipped.  deflated entries are inflated whole into memory, either when they
+are loaded or ahead of time by COM_PrefetchFiles, which queues a list of
+files to be inflated by the worker threads and keeps them until
+COM_ReleasePrefetch.  a load that wants a file that is still being inflated
+waits for it
+
+=============================================================================
+*/
+
+#define MAX_PREFETCH 1024
+
+typedef struct
+{
+	packfile_t *packfile;
+	byte *source; // compressed data
+	bool freesource;
+	byte *data;
+	bool ok;
+	atomic_bool done; // set by the task, data can't be used before
+} prefetch_t;
+
+static prefetch_t com_prefetch[MAX_PREFETCH];
+static int com_numprefetch;
+
+static unsigned COM_ZipShort (byte *p)
+{
+	return p[0] | (p[1] << 8);
+}
+
+static unsigned COM_ZipLong (byte *p)
+{
+	return p[0] | (p[1] << 8) | (p[2] << 16) | ((unsigned)p[3] << 24);
+}
+
+/*
+===========
+COM_PackFileData
+
+Makes filepos point at the data of a zip entry, the first time it is used.
+Returns false if the local header is bad
+===========
+*/
+static bool COM_PackFileData (pack_t *pak, packfile_t *pf)
+{
+	byte local[ZIP_LOCAL_SIZE];
+
+	if (!pf->local)
+		return true;
+
+	if (pak->map)
+	{
+		if (pf->filepos + ZIP_LOCAL_SIZE > pak->mapsize)
+			return false;
+		memcpy (local, pak->map + pf->filepos, ZIP_LOCAL_SIZE);
+	}
+	else
+	{
+		Sys_FileSeek (pak->handle, pf->filepos);
+		if (Sys_FileRead (pak->handle, local, ZIP_LOCAL_SIZE) != ZIP_LOCAL_SIZE)
+			return false;
+	}
+
+	if (COM_ZipLong (local) != ZIP_LOCAL_SIG)
+		return false;
+
+	pf->filepos += ZIP_LOCAL_SIZE + COM_ZipShort (local + 26) + COM_ZipShort (local + 28);
+	pf->local = false;
+
+	return true;
+}
+
+/*
+===========
+COM_PackFileSource
+
+Returns the compressed data of an entry, from the mapping if there is one
+===========
+*/
+static byte *COM_PackFileSource (pack_t *pak, packfile_t *pf, bool *allocated)
+{
+	byte *source;
+
+	*allocated = false;
+	if (pak->map && pf->filepos + pf->complen <= pak->mapsize)
+		return pak->map + pf->filepos;
+
+	source = Z_Malloc (pf->complen);
+	Sys_FileSeek (pak->handle, pf->filepos);
+	Sys_FileRead (pak->handle, source, pf->complen);
+	*allocated = true;
+
+	return source;
+}
+
+static bool COM_InflateData (packfile_t *pf, byte *source, byte *out)
+{
+	if (Inflate (out, pf->filelen, source, pf->complen) != pf->filelen)
+		return false;
+	return CRC32_Block (0, out, pf->filelen) == pf->crc;
+}
+
+static prefetch_t *COM_PrefetchSlot (packfile_t *pf)
+{
+	int i;
+
+	for (i = 0; i < com_numprefetch; i++)
+		if (com_prefetch[i].packfile == pf)
+			return &com_prefetch[i];
+
+	return NULL;
+}
+
+/*
+===========
+COM_FindPrefetched
+
+Returns the inflated data if pf was prefetched, waiting for it if needed
+===========
+*/
+static byte *COM_FindPrefetched (packfile_t *pf)
+{
+	prefetch_t *p;
+
+	p = COM_PrefetchSlot (pf);
+	if (!p)
+		return NULL;
+
+	// help out until it is done
+	while (!atomic_load (&p->done))
+	{
+		if (!Task_RunOne ())
+			Task_Wait ();
+	}
+
+	// bad ones are inflated again when loaded, and give the error then
+	return p->ok ? p->data : NULL;
+}
+
+/*
+===========
+COM_InflatePackFile
+
+Inflates a deflated entry into out, which holds filelen bytes
+===========
+*/
+static void COM_InflatePackFile (pack_t *pak, packfile_t *pf, byte *out)
+{
+	byte *source;
+	bool allocated;
+
+	source = COM_FindPrefetched (pf);
+	if (source)
+	{
+		memcpy (out, source, pf->filelen);
+		return;
+	}
+
+	source = COM_PackFileSource (pak, pf, &allocated);
+	if (!COM_InflateData (pf, source, out))
+		Sys_Error ("%s: %s is corrupt", pak->filename, pf->name);
+	if (allocated)
+		Z_Free (source);
+}
+
+/*
+===========
+COM_DeflatedEntry
+
+Returns the pack entry if it is deflated and its header is good
+===========
+*/
+static packfile_t *COM_DeflatedEntry (fileindex_t *entry)
+{
+	if (!entry || !entry->packfile || entry->packfile->method != PACK_DEFLATED)
+		return NULL;
+	if (!COM_PackFileData (entry->search->pack, entry->packfile))
+		return NULL; // COM_OpenEntry reports it
+
+	return entry->packfile;
+}
+
+static void COM_PrefetchTask (void *arg)
+{
+	prefetch_t *p = arg;
+
+	p->ok = COM_InflateData (p->packfile, p->source, p->data);
+	atomic_store (&p->done, true);
+}
+
+/*
+===========
+COM_ReleasePrefetch
+
+Frees everything COM_PrefetchFiles inflated
+===========
+*/
+void COM_ReleasePrefetch (void)
+{
+	int i;
+
+	if (!com_numprefetch)
+		return;
+
+	Task_Wait ();
+
+	for (i = 0; i < com_numprefetch; i++)
+	{
+		if (com_prefetch[i].freesource)
+			Z_Free (com_prefetch[i].source);
+		Z_Free (com_prefetch[i].data);
+	}
+
+	com_numprefetch = 0;
+}
+
+/*
+===========
+COM_PrefetchFiles
+
+Queues the deflated files in the list, each under dir, to be inflated by
+the worker threads, so the loads that follow only copy them.  Files that
+aren't deflated are skipped.  The compressed data is all read here, the
+tasks only touch memory
+===========
+*/
+void COM_PrefetchFiles (char *dir, char **names, int count)
+{
+	int i, first;
+	fileindex_t *entry;
+	packfile_t *pf;
+	prefetch_t *p;
+	size_t total;
+	char path[MAX_OSPATH];
+
+	COM_ReleasePrefetch ();
+
+	total = 0;
+	first = com_numprefetch;
+
+	for (i = 0; i < count && com_numprefetch < MAX_PREFETCH; i++)
+	{
+		snprintf (path, sizeof (path), "%s%s", dir, names[i]);
+		entry = COM_LookupFile (path);
+		pf = COM_DeflatedEntry (entry);
+		if (!pf || COM_PrefetchSlot (pf))
+			continue;
+
+		p = &com_prefetch[com_numprefetch++];
+		p->packfile = pf;
+		p->source = COM_PackFileSource (entry->search->pack, pf, &p->freesource);
+		p->data = Z_Malloc (pf->filelen + 1);
+		p->ok = false;
+		atomic_store (&p->done, false);
+		total += pf->filelen;
+	}
+
+	for (i = first; i < com_numprefetch; i++)
+		Task_Add (COM_PrefetchTask, &com_prefetch[i]);
+
+	if (com_numprefetch)
+		Con_DPrintf ("Inflating %i files, %lu KB\n", com_numprefetch, total / 1024);
+}
+
+/*
+===========
+COM_OpenEntry
+
+Opens a file found by COM_LookupFile.
 Sets com_filesize and one of handle or file
 ===========
 */
-static size_t COM_FindFile (char *filename, int *handle, FILE **file)
+static size_t COM_OpenEntry (fileindex_t *entry, char *filename, int *handle, FILE **file)
 {
 	searchpath_t *search;
 	char netpath[MAX_OSPATH];
 	char cachepath[MAX_OSPATH];
 	pack_t *pak;
-	size_t i;
+	packfile_t *pf;
+	byte *data;
 	int h;
 	int findtime, cachetime;
 
@@ -967,70 +1683,84 @@ static size_t COM_FindFile (char *filename, int *handle, FILE **file)
 	if (!file && !handle)
 		Sys_Error ("COM_FindFile: neither handle or file set");
 
-	//
-	// search through the path, one element at a time
-	//
-	search = com_searchpaths;
+	if (entry && entry->packfile && !COM_PackFileData (entry->search->pack, entry->packfile))
+	{
+		Con_Printf ("%s: bad local header for %s\n", entry->search->pack->filename, entry->packfile->name);
+		entry = NULL;
+	}
 
-	for (; search; search = search->next)
+	if (entry && entry->packfile)
 	{
-		// is the element a pak file?
-		if (search->pack)
-		{
-			// look through all the pak file elements
-			pak = search->pack;
-			for (i = 0; i < pak->numfiles; i++)
-				if (!strcmp (pak->files[i].name, filename))
-				{ // found it!
-					Sys_Printf ("PackFile: %s : %s\n", pak->filename, filename);
-					if (handle)
-					{
-						*handle = pak->handle;
-						Sys_FileSeek (pak->handle, pak->files[i].filepos);
-					}
-					else
-					{ // open a new file on the pakfile
-						*file = fopen (pak->filename, "rb");
-						if (*file)
-							fseek (*file, pak->files[i].filepos, SEEK_SET);
-					}
-					com_filesize = pak->files[i].filelen;
-					file_from_pak = true;
-					return com_filesize;
+		pak = entry->search->pack;
+		pf = entry->packfile;
+		if (pf->method == PACK_DEFLATED)
+		{ // inflate into an unnamed file, which is read like any other
+			data = Z_Malloc (pf->filelen + 1);
+			COM_InflatePackFile (pak, pf, data);
+			if (handle)
+			{
+				*handle = Sys_FileOpenTemp ();
+				Sys_FileWrite (*handle, data, pf->filelen);
+				Sys_FileSeek (*handle, 0);
+			}
+			else
+			{
+				*file = tmpfile ();
+				if (*file)
+				{
+					fwrite (data, 1, pf->filelen, *file);
+					rewind (*file);
 				}
+			}
+			Z_Free (data);
 		}
-		else
+		else if (handle)
 		{
-			// check a file in the directory tree
-			sprintf (netpath, "%s/%s", search->filename, filename);
+			*handle = pak->handle;
+			Sys_FileSeek (pak->handle, entry->packfile->filepos);
+		}
+		else
+		{ // open a new file on the pakfile
+			*file = fopen (pak->filename, "rb");
+			if (*file)
+				fseek (*file, entry->packfile->filepos, SEEK_SET);
+		}
+		com_filesize = entry->packfile->filelen;
+		file_from_pak = true;
+		return com_filesize;
+	}
 
-			findtime = Sys_FileTime (netpath);
-			if (findtime == -1)
-				continue;
+	if (entry)
+	{
+		// the file in the directory tree, under the name it has on disk
+		search = entry->search;
+		sprintf (netpath, "%s/%s", search->filename, entry->name);
 
-			// see if the file needs to be updated in the cache
-			if (!com_cachedir[0])
-				strcpy (cachepath, netpath);
-			else
-			{
+		// see if the file needs to be updated in the cache
+		if (!com_cachedir[0])
+			strcpy (cachepath, netpath);
+		else
+		{
+			findtime = Sys_FileTime (netpath);
 #ifdef _WIN32
-				if ((strlen (netpath) < 2) || (netpath[1] != ':'))
-					sprintf (cachepath, "%s%s", com_cachedir, netpath);
-				else
-					sprintf (cachepath, "%s%s", com_cachedir, netpath + 2);
-#else
+			if ((strlen (netpath) < 2) || (netpath[1] != ':'))
 				sprintf (cachepath, "%s%s", com_cachedir, netpath);
+			else
+				sprintf (cachepath, "%s%s", com_cachedir, netpath + 2);
+#else
+			sprintf (cachepath, "%s%s", com_cachedir, netpath);
 #endif
 
-				cachetime = Sys_FileTime (cachepath);
+			cachetime = Sys_FileTime (cachepath);
 
-				if (cachetime < findtime)
-					COM_CopyFile (netpath, cachepath);
-				strcpy (netpath, cachepath);
-			}
+			if (findtime != -1 && cachetime < findtime)
+				COM_CopyFile (netpath, cachepath);
+			strcpy (netpath, cachepath);
+		}
 
-			Sys_Printf ("FindFile: %s\n", netpath);
-			com_filesize = Sys_FileOpenRead (netpath, &h);
+		com_filesize = Sys_FileOpenRead (netpath, &h);
+		if (h != -1)
+		{
 			if (handle)
 				*handle = h;
 			else
@@ -1040,9 +1770,13 @@ static size_t COM_FindFile (char *filename, int *handle, FILE **file)
 			}
 			return com_filesize;
 		}
+
+		// removed since the index was built
+		COM_FlushFileIndex ();
 	}
 
-	Sys_Printf ("FindFile: can't find %s\n", filename);
+	Con_DPrintf ("FindFile: can't find %s\n", filename);
+	com_lookup_misses++;
 
 	if (handle)
 		*handle = -1;
@@ -1052,6 +1786,19 @@ static size_t COM_FindFile (char *filename, int *handle, FILE **file)
 	return 0;
 }
 
+/*
+===========
+COM_FindFile
+
+Finds the file in the search path.
+Sets com_filesize and one of handle or file
+===========
+*/
+static size_t COM_FindFile (char *filename, int *handle, FILE **file)
+{
+	return COM_OpenEntry (COM_LookupFile (filename), filename, handle, file);
+}
+
 /*
 ===========
 COM_OpenFile
@@ -1079,6 +1826,18 @@ size_t COM_FOpenFile (char *filename, FILE **file)
 	return COM_FindFile (filename, NULL, file);
 }
 
+/*
+===========
+COM_FileExists
+
+Checks the search path without opening, or inflating, the file
+===========
+*/
+bool COM_FileExists (char *filename)
+{
+	return COM_LookupFile (filename) != NULL;
+}
+
 /*
 ============
 COM_CloseFile
@@ -1114,6 +1873,8 @@ Allways appends a 0 byte.
 */
 static byte *COM_LoadFile (char *path, int usehunk)
 {
+	fileindex_t *entry;
+	packfile_t *deflated;
 	int h;
 	byte *buf;
 	char base[32];
@@ -1122,9 +1883,20 @@ static byte *COM_LoadFile (char *path, int usehunk)
 	buf = NULL; // quiet compiler warning
 
 	// look for it in the filesystem or pack files
-	len = COM_OpenFile (path, &h);
-	if (h == -1)
-		return NULL;
+	entry = COM_LookupFile (path);
+	deflated = COM_DeflatedEntry (entry);
+	if (deflated)
+	{ // inflated straight into the buffer
+		h = -1;
+		len = com_filesize = deflated->filelen;
+		file_from_pak = true;
+	}
+	else
+	{
+		len = COM_OpenEntry (entry, path, &h, NULL);
+		if (h == -1)
+			return NULL;
+	}
 
 	// extract the filename base name for hunk tag
 	COM_FileBase (path, base);
@@ -1142,8 +1914,13 @@ static byte *COM_LoadFile (char *path, int usehunk)
 	((byte *)buf)[len] = 0;
 
 	Draw_BeginDisc ();
-	Sys_FileRead (h, buf, len);
-	COM_CloseFile (h);
+	if (deflated)
+		COM_InflatePackFile (entry->search->pack, deflated, buf);
+	else
+	{
+		Sys_FileRead (h, buf, len);
+		COM_CloseFile (h);
+	}
 
 	return buf;
 }
@@ -1158,6 +1935,187 @@ byte *COM_LoadTempFile (char *path)
 	return COM_LoadFile (path, FILE_TEMP);
 }
 
+/*
+=============================================================================
+
+FILE VIEWS
+
+a file that is only parsed once, like a model or a sound, can be looked at
+in place instead of being read into the hunk.  files inside a mapped pak
+point straight into the mapping, loose files are mapped on their own, and
+anything that can't be mapped falls back to a zone copy.  views are read
+only and must be released with COM_UnmapFile once parsed.
+
+=============================================================================
+*/
+
+typedef struct
+{
+	byte *data; // NULL for a free slot
+	size_t size;
+	bool mapped; // munmap instead of Z_Free
+} fileview_t;
+
+// grows when a whole list of files is held open for preloading
+static fileview_t *com_fileviews;
+static int com_maxfileviews;
+
+static byte *COM_AddFileView (byte *data, size_t size, bool mapped)
+{
+	int i;
+
+	for (i = 0; i < com_maxfileviews; i++)
+		if (!com_fileviews[i].data)
+			break;
+
+	if (i == com_maxfileviews)
+	{
+		com_maxfileviews = com_maxfileviews ? com_maxfileviews * 2 : 16;
+		com_fileviews = Z_Realloc (com_fileviews, com_maxfileviews * sizeof (fileview_t));
+		memset (com_fileviews + i, 0, (com_maxfileviews - i) * sizeof (fileview_t));
+	}
+
+	com_fileviews[i].data = data;
+	com_fileviews[i].size = size;
+	com_fileviews[i].mapped = mapped;
+
+	return data;
+}
+
+/*
+============
+COM_MapFile
+
+Returns a read only view of the file and sets len and com_filesize.
+The view is not 0 terminated.
+============
+*/
+byte *COM_MapFile (char *path, size_t *len)
+{
+	fileindex_t *entry;
+	packfile_t *pf;
+	pack_t *pak;
+	byte *buf;
+	size_t size;
+	int h;
+
+	entry = COM_LookupFile (path);
+
+	pf = COM_DeflatedEntry (entry);
+	if (pf)
+	{
+		file_from_pak = true;
+		com_filesize = *len = pf->filelen;
+
+		// prefetched data stays with the prefetch, like a pak view
+		buf = COM_FindPrefetched (pf);
+		if (buf)
+			return buf;
+
+		buf = Z_Malloc (pf->filelen + 1);
+		buf[pf->filelen] = 0;
+
+		Draw_BeginDisc ();
+		COM_InflatePackFile (entry->search->pack, pf, buf);
+
+		return COM_AddFileView (buf, pf->filelen, false);
+	}
+
+	// inside a mapped pak, the loaders expect aligned data
+	if (entry && entry->packfile && entry->search->pack->map && COM_PackFileData (entry->search->pack, entry->packfile) &&
+		!(entry->packfile->filepos & 3))
+	{
+		pak = entry->search->pack;
+		if (entry->packfile->filepos + entry->packfile->filelen <= pak->mapsize)
+		{
+			file_from_pak = true;
+			com_filesize = *len = entry->packfile->filelen;
+			return pak->map + entry->packfile->filepos;
+		}
+	}
+
+	size = COM_OpenEntry (entry, path, &h, NULL);
+	if (h == -1)
+		return NULL;
+	*len = size;
+
+	if (!file_from_pak)
+	{
+		buf = Sys_FileMap (h, size);
+		if (buf)
+		{
+			COM_CloseFile (h);
+			return COM_AddFileView (buf, size, true);
+		}
+	}
+
+	// unmapped pak, misaligned pak entry or a file that can't be mapped
+	buf = Z_Malloc (size + 1);
+	buf[size] = 0;
+
+	Draw_BeginDisc ();
+	Sys_FileRead (h, buf, size);
+	COM_CloseFile (h);
+
+	return COM_AddFileView (buf, size, false);
+}
+
+/*
+============
+COM_UnmapFile
+
+Releases a view from COM_MapFile.  Views into a pak stay mapped with the pak
+============
+*/
+void COM_UnmapFile (byte *data)
+{
+	int i;
+
+	for (i = 0; i < com_maxfileviews; i++)
+	{
+		if (com_fileviews[i].data == data)
+		{
+			if (com_fileviews[i].mapped)
+				Sys_FileUnmap (data, com_fileviews[i].size);
+			else
+				Z_Free (data);
+			com_fileviews[i].data = NULL;
+			return;
+		}
+	}
+}
+
+/*
+============
+COM_FileCRC
+
+Gets the zip style crc of a file's contents.  Deflated zip entries already
+carry it, so they aren't inflated
+============
+*/
+bool COM_FileCRC (char *path, unsigned *crc)
+{
+	packfile_t *pf;
+	byte *data;
+	size_t len;
+
+	pf = COM_DeflatedEntry (COM_LookupFile (path));
+	if (pf)
+	{
+		*crc = pf->crc;
+		return true;
+	}
+
+	data = COM_MapFile (path, &len);
+	if (!data)
+		return false;
+
+	*crc = CRC32_Block (0, data, len);
+	COM_UnmapFile (data);
+
+	return true;
+}
+
 /*
 =================
 COM_LoadPackFile
@@ -1177,8 +2135,10 @@ static pack_t *COM_LoadPackFile (char *packfile)
 	pack_t *pack;
 	int packhandle;
 	dpackfile_t info[MAX_FILES_IN_PACK];
+	size_t packsize;
 
-	if (Sys_FileOpenRead (packfile, &packhandle) == -1)
+	packsize = Sys_FileOpenRead (packfile, &packhandle);
+	if (packhandle == -1)
 	{
 		//              Con_Printf ("Couldn't open %s\n", packfile);
 		return NULL;
@@ -1192,7 +2152,9 @@ static pack_t *COM_LoadPackFile (char *packfile)
 	if (numpackfiles > MAX_FILES_IN_PACK)
 		Sys_Error ("%s has %lu files", packfile, numpackfiles);
 
-	newfiles = Hunk_AllocName (numpackfiles * sizeof (packfile_t), "packfile");
+	// in the zone, COM_Gamedir frees them when the game dir changes
+	newfiles = Z_Malloc (numpackfiles * sizeof (packfile_t));
+	memset (newfiles, 0, numpackfiles * sizeof (packfile_t));
 
 	Sys_FileSeek (packhandle, header.dirofs);
 	Sys_FileRead (packhandle, (void *)info, header.dirlen);
@@ -1203,18 +2165,183 @@ static pack_t *COM_LoadPackFile (char *packfile)
 		strcpy (newfiles[i].name, info[i].name);
 		newfiles[i].filepos = info[i].filepos;
 		newfiles[i].filelen = info[i].filelen;
+		newfiles[i].complen = info[i].filelen;
+		newfiles[i].method = PACK_STORED;
+		newfiles[i].local = false;
 	}
 
-	pack = Hunk_Alloc (sizeof (pack_t));
+	pack = Z_Malloc (sizeof (pack_t));
 	strcpy (pack->filename, packfile);
 	pack->handle = packhandle;
 	pack->numfiles = numpackfiles;
 	pack->files = newfiles;
+	pack->map = Sys_FileMap (packhandle, packsize);
+	pack->mapsize = pack->map ? packsize : 0;
 
 	Con_Printf ("Added packfile %s (%lu files)\n", packfile, numpackfiles);
 	return pack;
 }
 
+/*
+=================
+COM_LoadZipFile
+
+Takes an explicit path to a zip file, and loads its central directory.
+Stored and deflated entries are supported, anything else is skipped.
+=================
+*/
+static pack_t *COM_LoadZipFile (char *zipfile)
+{
+	int handle;
+	size_t zipsize, tail, dirofs, dirlen;
+	size_t i, numentries, numpackfiles;
+	unsigned flags, method, namelen, extralen, commentlen;
+	byte *buf, *dir, *p, *end;
+	packfile_t *newfiles, *pf;
+	pack_t *pack;
+
+	zipsize = Sys_FileOpenRead (zipfile, &handle);
+	if (handle == -1)
+		return NULL;
+
+	// the end of central directory record is last, apart from a comment of up to 64k
+	tail = zipsize < 0xffff + ZIP_END_SIZE ? zipsize : 0xffff + ZIP_END_SIZE;
+	buf = Z_Malloc (tail);
+	Sys_FileSeek (handle, zipsize - tail);
+	Sys_FileRead (handle, buf, tail);
+
+	for (p = buf + tail - ZIP_END_SIZE; p >= buf; p--)
+		if (COM_ZipLong (p) == ZIP_END_SIG)
+			break;
+
+	if (p < buf)
+	{
+		Con_Printf ("%s is not a zip file\n", zipfile);
+		Z_Free (buf);
+		Sys_FileClose (handle);
+		return NULL;
+	}
+
+	numentries = COM_ZipShort (p + 10);
+	dirlen = COM_ZipLong (p + 12);
+	dirofs = COM_ZipLong (p + 16);
+	Z_Free (buf);
+
+	if (dirofs + dirlen > zipsize)
+	{
+		Con_Printf ("%s has a bad central directory\n", zipfile);
+		Sys_FileClose (handle);
+		return NULL;
+	}
+
+	dir = Z_Malloc (dirlen);
+	Sys_FileSeek (handle, dirofs);
+	Sys_FileRead (handle, dir, dirlen);
+
+	// in the zone, COM_Gamedir frees them when the game dir changes
+	newfiles = Z_Malloc (numentries * sizeof (packfile_t));
+	memset (newfiles, 0, numentries * sizeof (packfile_t));
+
+	// parse the directory
+	end = dir + dirlen;
+	numpackfiles = 0;
+	for (i = 0, p = dir; i < numentries; i++, p += ZIP_CENTRAL_SIZE + namelen + extralen + commentlen)
+	{
+		if (p + ZIP_CENTRAL_SIZE > end || COM_ZipLong (p) != ZIP_CENTRAL_SIG)
+		{
+			Con_Printf ("%s: central directory is truncated\n", zipfile);
+			break;
+		}
+
+		flags = COM_ZipShort (p + 8);
+		method = COM_ZipShort (p + 10);
+		namelen = COM_ZipShort (p + 28);
+		extralen = COM_ZipShort (p + 30);
+		commentlen = COM_ZipShort (p + 32);
+
+		if (p + ZIP_CENTRAL_SIZE + namelen > end)
+			break;
+
+		if (!namelen || p[ZIP_CENTRAL_SIZE + namelen - 1] == '/')
+			continue; // directory
+
+		if (namelen >= MAX_QPATH)
+		{
+			Con_Printf ("%s: %.*s has too long a name\n", zipfile, namelen, p + ZIP_CENTRAL_SIZE);
+			continue;
+		}
+
+		if ((flags & 1) || (method != 0 && method != 8))
+		{
+			Con_Printf ("%s: %.*s is encrypted or not deflated\n", zipfile, namelen, p + ZIP_CENTRAL_SIZE);
+			continue;
+		}
+
+		pf = &newfiles[numpackfiles++];
+		memcpy (pf->name, p + ZIP_CENTRAL_SIZE, namelen);
+		pf->name[namelen] = 0;
+		pf->method = method ? PACK_DEFLATED : PACK_STORED;
+		pf->crc = COM_ZipLong (p + 16);
+		pf->complen = COM_ZipLong (p + 20);
+		pf->filelen = COM_ZipLong (p + 24);
+		pf->filepos = COM_ZipLong (p + 42);
+		pf->local = true; // skipped the first time the file is opened
+
+		if (pf->method == PACK_STORED)
+			pf->complen = pf->filelen;
+	}
+
+	Z_Free (dir);
+
+	pack = Z_Malloc (sizeof (pack_t));
+	strcpy (pack->filename, zipfile);
+	pack->handle = handle;
+	pack->numfiles = numpackfiles;
+	pack->files = newfiles;
+	pack->map = Sys_FileMap (handle, zipsize);
+	pack->mapsize = pack->map ? zipsize : 0;
+
+	Con_Printf ("Added zipfile %s (%lu files)\n", zipfile, numpackfiles);
+	return pack;
+}
+
+static void COM_AddZipName (char *name, bool isdir, void *arg)
+{
+	char (*names)[MAX_QPATH] = arg;
+	char *ext;
+
+	if (isdir || com_numzips == MAX_ZIPS_IN_DIR || strlen (name) >= MAX_QPATH)
+		return;
+
+	ext = strrchr (name, '.');
+	if (!ext || (strcasecmp (ext, ".pk3") && strcasecmp (ext, ".zip")))
+		return;
+
+	strcpy (names[com_numzips++], name);
+}
+
+static int COM_CompareZipNames (const void *a, const void *b)
+{
+	return strcmp (a, b);
+}
+
+/*
+=================
+COM_ListZipFiles
+
+Fills names with the zip archives in dir, in the order they are added
+to the search path, so later names override earlier ones
+=================
+*/
+static int COM_ListZipFiles (char *dir, char names[MAX_ZIPS_IN_DIR][MAX_QPATH])
+{
+	com_numzips = 0;
+	Sys_ListDir (dir, COM_AddZipName, names);
+	qsort (names, com_numzips, MAX_QPATH, COM_CompareZipNames);
+
+	return com_numzips;
+}
+
 /*
 ================
 COM_AddGameDirectory
@@ -1229,6 +2356,8 @@ static void COM_AddGameDirectory (char *dir)
 	searchpath_t *search;
 	pack_t *pak;
 	char pakfile[MAX_OSPATH];
+	char zipnames[MAX_ZIPS_IN_DIR][MAX_QPATH];
+	int numzips;
 	char *p;
 
 	if ((p = strrchr (dir, '/')) != NULL)
@@ -1238,6 +2367,8 @@ static void COM_AddGameDirectory (char *dir)
 
 	strcpy (com_gamedir, dir);
 
+	COM_FlushFileIndex ();
+
 	//
 	// add the directory to the search path
 	//
@@ -1260,6 +2391,22 @@ static void COM_AddGameDirectory (char *dir)
 		search->next = com_searchpaths;
 		com_searchpaths = search;
 	}
+
+	//
+	// then any zip archives, which override the pak files
+	//
+	numzips = COM_ListZipFiles (dir, zipnames);
+	for (i = 0; i < numzips; i++)
+	{
+		sprintf (pakfile, "%s/%s", dir, zipnames[i]);
+		pak = COM_LoadZipFile (pakfile);
+		if (!pak)
+			continue;
+		search = Hunk_Alloc (sizeof (searchpath_t));
+		search->pack = pak;
+		search->next = com_searchpaths;
+		com_searchpaths = search;
+	}
 }
 
 /*
@@ -1275,6 +2422,8 @@ void COM_Gamedir (char *dir)
 	int i;
 	pack_t *pak;
 	char pakfile[MAX_OSPATH];
+	char zipnames[MAX_ZIPS_IN_DIR][MAX_QPATH];
+	int numzips;
 
 	if (strstr (dir, "..") || strstr (dir, "/") || strstr (dir, "\\") || strstr (dir, ":"))
 	{
@@ -1287,6 +2436,9 @@ void COM_Gamedir (char *dir)
 
 	strcpy (gamedirfile, dir);
 
+	COM_FlushFileIndex ();
+	COM_ReleasePrefetch ();
+
 	//
 	// free up any current game dir info
 	//
@@ -1295,6 +2447,8 @@ void COM_Gamedir (char *dir)
 		if (com_searchpaths->pack)
 		{
 			Sys_FileClose (com_searchpaths->pack->handle);
+			if (com_searchpaths->pack->map)
+				Sys_FileUnmap (com_searchpaths->pack->map, com_searchpaths->pack->mapsize);
 			Z_Free (com_searchpaths->pack->files);
 			Z_Free (com_searchpaths->pack);
 		}
@@ -1330,6 +2484,22 @@ void COM_Gamedir (char *dir)
 		search->next = com_searchpaths;
 		com_searchpaths = search;
 	}
+
+	//
+	// then any zip archives, which override the pak files
+	//
+	numzips = COM_ListZipFiles (com_gamedir, zipnames);
+	for (i = 0; i < numzips; i++)
+	{
+		sprintf (pakfile, "%s/%s", com_gamedir, zipnames[i]);
+		pak = COM_LoadZipFile (pakfile);
+		if (!pak)
+			continue;
+		search = Z_Malloc (sizeof (searchpath_t));
+		search->pack = pak;
+		search->next = com_searchpaths;
+		com_searchpaths = search;
+	}
 }
 
 static void COM_InitFilesystem (void)
@@ -1337,6 +2507,8 @@ static void COM_InitFilesystem (void)
 	int i, j;
 	searchpath_t *search;
 
+	Inflate_Init ();
+
 	//
 	// -basedir <path>
 	// Overrides the system supplied base directory (under ENGINE_BASEDIR)
@@ -1401,6 +2573,7 @@ static void COM_InitFilesystem (void)
 	i = COM_CheckParm ("-path");
 	if (i)
 	{
+		COM_FlushFileIndex ();
 		com_searchpaths = NULL;
 		while (++i < com_argc)
 		{
@@ -1414,6 +2587,12 @@ static void COM_InitFilesystem (void)
 				if (!search->pack)
 					Sys_Error ("Couldn't load packfile: %s", com_argv[i]);
 			}
+			else if (!strcmp (COM_FileExtension (com_argv[i]), "pk3") || !strcmp (COM_FileExtension (com_argv[i]), "zip"))
+			{
+				search->pack = COM_LoadZipFile (com_argv[i]);
+				if (!search->pack)
+					Sys_Error ("Couldn't load zipfile: %s", com_argv[i]);
+			}
 			else
 				strcpy (search->filename, com_argv[i]);
 			search->next = com_searchpaths;
@@ -1694,6 +2873,289 @@ void Info_Print (char *s)
 	}
 }
 
+/*
+=====================================================================
+
+  INFO STORES
+
+the same key / value pairs as an info string, with the keys hashed so a
+lookup doesn't scan the string.  the wire string is only rebuilt when it
+is asked for after a change.  an all zero info_t is empty.
+
+=====================================================================
+*/
+
+static infokey_t *Info_Find (info_t *info, char *key)
+{
+	infokey_t *k;
+
+	for (k = info->hash[COM_HashName (key) & (INFO_HASH_SIZE - 1)]; k; k = k->hashnext)
+		if (!strcmp (key, k->key))
+			return k;
+
+	return NULL;
+}
+
+static void Info_Unlink (info_t *info, infokey_t *key)
+{
+	infokey_t **k, *prev;
+
+	for (k = &info->hash[COM_HashName (key->key) & (INFO_HASH_SIZE - 1)]; *k != key; k = &(*k)->hashnext);
+	*k = key->hashnext;
+
+	prev = NULL;
+	for (k = &info->keys; *k != key; k = &(*k)->next)
+		prev = *k;
+	*k = key->next;
+	if (info->last == key)
+		info->last = prev;
+
+	info->length -= 2 + strlen (key->key) + strlen (key->value);
+	info->dirty = true;
+}
+
+static void Info_Append (info_t *info, char *key, char *value)
+{
+	infokey_t *k;
+	unsigned int hash;
+
+	k = Z_Malloc (sizeof (*k));
+	k->next = NULL;
+	strcpy (k->key, key);
+	strcpy (k->value, value);
+
+	hash = COM_HashName (key) & (INFO_HASH_SIZE - 1);
+	k->hashnext = info->hash[hash];
+	info->hash[hash] = k;
+
+	if (info->last)
+		info->last->next = k;
+	else
+		info->keys = k;
+	info->last = k;
+
+	info->length += 2 + strlen (key) + strlen (value);
+	info->dirty = true;
+}
+
+void Info_Clear (info_t *info)
+{
+	infokey_t *k, *next;
+
+	for (k = info->keys; k; k = next)
+	{
+		next = k->next;
+		Z_Free (k);
+	}
+	Z_Free (info->string);
+
+	memset (info, 0, sizeof (*info));
+}
+
+/*
+===============
+Info_Get
+
+Returns the value for the key, or an empty string.  The value stays
+valid until the key is changed.
+===============
+*/
+char *Info_Get (info_t *info, char *key)
+{
+	infokey_t *k;
+
+	k = Info_Find (info, key);
+	return k ? k->value : "";
+}
+
+// same filtering as Info_SetValueForStarKey
+static void Info_Filter (char *out, char *in, char *key, bool highchars)
+{
+	int c;
+
+	while (*in)
+	{
+		c = (unsigned char)*in++;
+		// client only allows highbits on name
+		if (!highchars || strcasecmp (key, "name") != 0)
+		{
+			// strip high bits
+			c &= 127;
+			if (c < 32)
+				continue;
+			// auto lowercase team
+			if (strcasecmp (key, "team") == 0)
+				c = tolower (c);
+		}
+		if (c > 13)
+			*out++ = c;
+	}
+	*out = 0;
+}
+
+/*
+===============
+Info_SetStar
+
+An empty value removes the key.  A changed key moves to the end, the way
+it does in an info string.
+===============
+*/
+void Info_SetStar (info_t *info, char *key, char *value, int maxsize, bool highchars)
+{
+	char k[INFO_MAX_KEY], v[INFO_MAX_KEY];
+	infokey_t *old;
+	int length;
+
+	if (strstr (key, "\\") || strstr (value, "\\"))
+	{
+		Con_Printf ("Can't use keys or values with a \\\n");
+		return;
+	}
+
+	if (strstr (key, "\"") || strstr (value, "\""))
+	{
+		Con_Printf ("Can't use keys or values with a \"\n");
+		return;
+	}
+
+	if (strlen (key) >= INFO_MAX_KEY || strlen (value) >= INFO_MAX_KEY)
+	{
+		Con_Printf ("Keys and values must be < %i characters.\n", INFO_MAX_KEY);
+		return;
+	}
+
+	Info_Filter (k, key, key, highchars);
+	Info_Filter (v, value, key, highchars);
+	if (!k[0])
+		return;
+
+	old = Info_Find (info, k);
+
+	length = info->length;
+	if (old)
+		length -= 2 + strlen (old->key) + strlen (old->value);
+	if (v[0])
+		length += 2 + strlen (k) + strlen (v);
+
+	if (length > maxsize)
+	{
+		Con_Printf ("Info string length exceeded\n");
+		return;
+	}
+
+	if (old)
+	{
+		Info_Unlink (info, old);
+		Z_Free (old);
+	}
+
+	if (v[0])
+		Info_Append (info, k, v);
+}
+
+void Info_Set (info_t *info, char *key, char *value, int maxsize, bool highchars)
+{
+	if (key[0] == '*')
+	{
+		Con_Printf ("Can't set * keys\n");
+		return;
+	}
+
+	Info_SetStar (info, key, value, maxsize, highchars);
+}
+
+/*
+===============
+Info_Parse
+
+Replaces the contents with the pairs of an info string, as is.  Pairs
+that are too long or don't fit in maxsize are dropped.
+===============
+*/
+void Info_Parse (info_t *info, char *s, int maxsize)
+{
+	char key[INFO_MAX_KEY], value[INFO_MAX_KEY];
+	int keylen, valuelen;
+	char *start;
+
+	Info_Clear (info);
+
+	while (*s)
+	{
+		if (*s == '\\')
+			s++;
+
+		start = s;
+		while (*s && *s != '\\')
+			s++;
+		keylen = s - start;
+		if (keylen < INFO_MAX_KEY)
+			memcpy (key, start, keylen);
+
+		if (*s)
+			s++;
+		start = s;
+		while (*s && *s != '\\')
+			s++;
+		valuelen = s - start;
+		if (valuelen < INFO_MAX_KEY)
+			memcpy (value, start, valuelen);
+
+		if (!keylen || !valuelen || keylen >= INFO_MAX_KEY || valuelen >= INFO_MAX_KEY)
+			continue;
+		if (info->length + 2 + keylen + valuelen > maxsize)
+			break;
+
+		key[keylen] = 0;
+		value[valuelen] = 0;
+		if (Info_Find (info, key))
+			continue; // the first one wins, as with Info_ValueForKey
+
+		Info_Append (info, key, value);
+	}
+}
+
+/*
+===============
+Info_String
+
+The wire format, rebuilt if anything changed since the last call
+===============
+*/
+char *Info_String (info_t *info)
+{
+	infokey_t *k;
+	char *o;
+
+	if (!info->keys)
+		return "";
+
+	if (!info->dirty)
+		return info->string;
+
+	if (info->stringsize < info->length + 1)
+	{
+		info->stringsize = info->length + 1;
+		info->string = Z_Realloc (info->string, info->stringsize);
+	}
+
+	o = info->string;
+	for (k = info->keys; k; k = k->next)
+		o += sprintf (o, "\\%s\\%s", k->key, k->value);
+
+	info->dirty = false;
+	return info->string;
+}
+
+void Info_List (info_t *info)
+{
+	infokey_t *k;
+
+	for (k = info->keys; k; k = k->next)
+		Con_Printf ("%-20s%s\n", k->key, k->value);
+}
+
 static const byte chktbl[1024 + 4] = {
 	0x78, 0xd2, 0x94, 0xe3, 0x41, 0xec, 0xd6, 0xd5, 0xcb, 0xfc, 0xdb, 0x8a, 0x4b, 0xcc, 0x85, 0x01, 0x23, 0xd2, 0xe5, 0xf2, 0x29, 0xa7, 0x45, 0x94, 0x4a, 0x62,
 	0xe3, 0xa5, 0x6f, 0x3f, 0xe1, 0x7a, 0x64, 0xed, 0x5c, 0x99, 0x29, 0x87, 0xa8, 0x78, 0x59, 0x0d, 0xaa, 0x0f, 0x25, 0x0a, 0x5c, 0x58, 0xfb, 0x00, 0xa7, 0xa8,
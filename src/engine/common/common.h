@@ -111,6 +111,20 @@ void COM_DefaultExtension (char *path, char *extension);
 char *va (char *format, ...);
 // does a varargs printf into a temp buffer
 
+unsigned int COM_HashName (char *name);
+// case insensitive, for name lookup tables
+
+typedef struct
+{
+	char **names;
+	int count, size;
+	bool sorted;
+} namelist_t;
+
+void COM_AddName (namelist_t *list, char *name);
+void COM_CompleteName (namelist_t *list, char *partial, char **best, int *bestlen);
+// sorted names for command line completion
+
 //============================================================================
 
 extern size_t com_filesize;
@@ -120,12 +134,20 @@ extern char com_gamedir[MAX_OSPATH];
 void COM_WriteFile (char *filename, void *data, size_t len);
 size_t COM_OpenFile (char *filename, int *hndl);
 size_t COM_FOpenFile (char *filename, FILE **file);
+bool COM_FileExists (char *filename);
 void COM_CloseFile (int h);
 
 byte *COM_LoadTempFile (char *path);
 byte *COM_LoadHunkFile (char *path);
+byte *COM_MapFile (char *path, size_t *len);
+void COM_UnmapFile (byte *data);
+bool COM_FileCRC (char *path, unsigned *crc);
+void COM_PrefetchFiles (char *dir, char **names, int count);
+void COM_ReleasePrefetch (void);
 void COM_CreatePath (char *path);
 void COM_Gamedir (char *dir);
+void COM_FlushFileIndex (void);
+void COM_FileWritten (char *path);
 
 enum
 {
@@ -145,6 +167,36 @@ void Info_SetValueForKey (char *s, char *key, char *value, int maxsize, bool hig
 void Info_SetValueForStarKey (char *s, char *key, char *value, int maxsize, bool highchars);
 void Info_Print (char *s);
 
+// parsed info strings, see common.c
+#define INFO_MAX_KEY 64
+#define INFO_HASH_SIZE 64 // power of two
+
+typedef struct infokey_s
+{
+	struct infokey_s *next; // in wire order
+	struct infokey_s *hashnext;
+	char key[INFO_MAX_KEY];
+	char value[INFO_MAX_KEY];
+} infokey_t;
+
+typedef struct
+{
+	infokey_t *keys, *last;
+	infokey_t *hash[INFO_HASH_SIZE];
+	int length; // of the wire string
+	char *string;
+	int stringsize;
+	bool dirty; // string needs rebuilding
+} info_t;
+
+void Info_Clear (info_t *info);
+char *Info_Get (info_t *info, char *key);
+void Info_Set (info_t *info, char *key, char *value, int maxsize, bool highchars);
+void Info_SetStar (info_t *info, char *key, char *value, int maxsize, bool highchars);
+void Info_Parse (info_t *info, char *s, int maxsize);
+char *Info_String (info_t *info);
+void Info_List (info_t *info);
+
 unsigned int COM_BlockChecksum (void *buffer, int length);
 void COM_BlockFullChecksum (void *buffer, int len, unsigned char *outbuf);
 byte COM_BlockSequenceCRCByte (byte *base, int length, int sequence);
@@ -21,15 +21,21 @@ along with this program.  If not, see <https://www.gnu.org/licenses/>.
 #include "serverdef.h"
 #include "clientdef.h"
 
+#define CVAR_HASH_SIZE 512 // power of two
+
 static cvar_t *cvar_vars[2];
+static cvar_t *cvar_hash[2][CVAR_HASH_SIZE];
 static char *const cvar_null_string = "";
 
+namelist_t cvar_names[2]; // for completion
+
 cvar_t *Cvar_FindVar (cmd_source_e src, char *var_name)
 {
 	cvar_t *var;
 
-	for (var = cvar_vars[src]; var; var = var->next[src])
-		if (!strcmp (var_name, var->name))
+	var = cvar_hash[src][COM_HashName (var_name) & (CVAR_HASH_SIZE - 1)];
+	for (; var; var = var->hashnext[src])
+		if (!strcasecmp (var_name, var->name))
 			return var;
 
 	return NULL;
@@ -55,40 +61,20 @@ char *Cvar_VariableString (cmd_source_e src, char *var_name)
 	return var->string;
 }
 
-static void Cvar_GetBestVariable (cmd_source_e src, char *partial, int len, char **best, int *bestlen)
-{
-	cvar_t *cvar;
-	int curlen;
-
-	for (cvar = cvar_vars[src]; cvar; cvar = cvar->next[src])
-	{
-		curlen = abs (strlen (cvar->name) - len);
-
-		if (curlen < *bestlen && !strncmp (partial, cvar->name, len))
-		{
-			*best = cvar->name;
-			*bestlen = curlen;
-		}
-	}
-}
-
 char *Cvar_CompleteVariable (cmd_source_e src, char *partial)
 {
-	int len;
 	char *best = NULL;
 	int bestlen = 999;
 
-	len = strlen (partial);
-
-	if (!len)
+	if (!partial[0])
 		return NULL;
 
 	// check partial match
-	Cvar_GetBestVariable (src, partial, len, &best, &bestlen);
+	COM_CompleteName (&cvar_names[src], partial, &best, &bestlen);
 
 	// local game queries server commands, too
 	if (src == src_client && Host_IsLocalGame ())
-		Cvar_GetBestVariable (src_server, partial, len, &best, &bestlen);
+		COM_CompleteName (&cvar_names[src_server], partial, &best, &bestlen);
 
 	return best;
 }
@@ -111,17 +97,17 @@ void Cvar_Set (cmd_source_e src, char *var_name, char *value)
 
 	if ((var->flags & CVAR_SERVER_INFO) && Host_IsLocalGame ())
 	{
-		Info_SetValueForKey (svs.info, var_name, value, MAX_SERVERINFO_STRING, sv_highchars.value);
-		SV_SendServerInfoChange (var_name, value);
+		Info_Set (&svs.info, var->name, value, MAX_SERVERINFO_STRING, sv_highchars.value);
+		SV_SendServerInfoChange (var->name, value);
 	}
 
 	if (var->flags & CVAR_CLIENT_INFO)
 	{
-		Info_SetValueForKey (cls.userinfo, var_name, value, MAX_INFO_STRING, true);
+		Info_SetValueForKey (cls.userinfo, var->name, value, MAX_INFO_STRING, true);
 		if (cls.state >= ca_connected)
 		{
 			MSG_WriteByte (&cls.netchan.message, clc_stringcmd);
-			SZ_Print (&cls.netchan.message, va ("setinfo \"%s\" \"%s\"\n", var_name, value));
+			SZ_Print (&cls.netchan.message, va ("setinfo \"%s\" \"%s\"\n", var->name, value));
 		}
 	}
 
@@ -153,6 +139,7 @@ Adds a freestanding variable to the variable list.
 void Cvar_RegisterVariable (cmd_source_e src, cvar_t *variable)
 {
 	char value[512];
+	unsigned int hash;
 
 	if (src == src_host)
 	{
@@ -179,6 +166,12 @@ void Cvar_RegisterVariable (cmd_source_e src, cvar_t *variable)
 	variable->next[src] = cvar_vars[src];
 	cvar_vars[src] = variable;
 
+	hash = COM_HashName (variable->name) & (CVAR_HASH_SIZE - 1);
+	variable->hashnext[src] = cvar_hash[src][hash];
+	cvar_hash[src][hash] = variable;
+
+	COM_AddName (&cvar_names[src], variable->name);
+
 	// copy the value off, because future sets will Z_Free it
 	strcpy (value, variable->string);
 	variable->string = Z_Malloc (1);
@@ -16,8 +16,11 @@ typedef struct cvar_s
 	unsigned int flags;
 	float value;
 	struct cvar_s *next[2];
+	struct cvar_s *hashnext[2];
 } cvar_t;
 
+extern namelist_t cvar_names[2];
+
 void Cvar_RegisterVariable (cmd_source_e src, cvar_t *variable);
 // registers a cvar that allready has the name, string, and optionally the
 // archive elements set.
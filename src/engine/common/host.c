@@ -75,6 +75,8 @@ cvar_t coop = {"coop", "0"};			 // 0 or 1
 
 cvar_t pausable = {"pausable", "1"};
 
+cvar_t host_cachesize = {"host_cachesize", "32"}; // megabytes of models and sounds kept between levels
+
 extern int cl_framecount;
 
 /*
@@ -170,6 +172,8 @@ static void Host_InitLocal (void)
 
 	Cvar_RegisterVariable (src_server, &pausable);
 
+	Cvar_RegisterVariable (src_host, &host_cachesize);
+
 	int i = COM_CheckParm ("-dedicated");
 	if (i)
 	{
@@ -195,12 +199,14 @@ Writes key bindings and archived cvars to config.cfg
 void Host_WriteConfiguration (void)
 {
 	FILE *f;
+	char name[MAX_OSPATH];
 
 	// dedicated servers initialize the host but don't parse and set the
 	// config.cfg cvars
 	if (host_initialized & cls.state != ca_dedicated)
 	{
-		f = fopen (va ("%s/config.cfg", com_gamedir), "w");
+		sprintf (name, "%s/config.cfg", com_gamedir);
+		f = fopen (name, "w");
 		if (!f)
 		{
 			Con_Printf ("Couldn't write config.cfg.\n");
@@ -211,6 +217,7 @@ void Host_WriteConfiguration (void)
 		Cvar_WriteVariables (f);
 
 		fclose (f);
+		COM_FileWritten (name);
 	}
 }
 
@@ -252,6 +259,7 @@ void Host_ShutdownServer (bool crash)
 
 	if (sv_fraglogfile)
 	{
+		Log_SetFile (LOG_FRAGS, NULL);
 		fclose (sv_fraglogfile);
 		sv_fraglogfile = NULL;
 	}
@@ -262,6 +270,8 @@ void Host_ShutdownServer (bool crash)
 	// clear structures
 	//
 	memset (&sv, 0, sizeof (sv));
+	for (i = 0; i < MAX_CLIENTS; i++)
+		Info_Clear (&svs.clients[i].userinfo);
 	memset (svs.clients, 0, MAX_CLIENTS * sizeof (client_t));
 }
 
@@ -279,6 +289,7 @@ void Host_ClearMemory (void)
 	CMod_ClearAll ();
 	Mod_ClearAll ();
 	S_ClearAll ();
+	Cache_Flush (host_cachesize.value > 0 ? host_cachesize.value * 1024 * 1024 : 0);
 	PR_ClearStrings (&sv.pr);
 	if (host_hunklevel)
 		Hunk_FreeToLowMark (host_hunklevel);
@@ -341,6 +352,10 @@ static void Host_GetConsoleCommands (void)
 
 static void Host_ServerFrame (void)
 {
+	double start;
+
+	SV_MetricsBeginFrame ();
+
 	// keep the random time dependent
 	rand ();
 
@@ -352,10 +367,16 @@ static void Host_ServerFrame (void)
 
 	// move autonomous things around if enough time has passed
 	if (!sv.paused)
+	{
+		start = Sys_FloatTime ();
 		SV_Physics ();
+		SV_MetricsAdd (ph_physics, Sys_FloatTime () - start);
+	}
 
 	// get packets
+	start = Sys_FloatTime ();
 	SV_ReadPackets ();
+	SV_MetricsAdd (ph_readpackets, Sys_FloatTime () - start);
 
 	// process console commands
 	Cbuf_Execute (src_server);
@@ -363,14 +384,22 @@ static void Host_ServerFrame (void)
 	SV_CheckVars ();
 
 	// send messages back to the clients that had packets read this frame
+	start = Sys_FloatTime ();
 	SV_SendClientMessages ();
+	SV_MetricsAdd (ph_sendmessages, Sys_FloatTime () - start);
 
 	// send a heartbeat to the master if needed
 	Master_Heartbeat ();
+
+	SV_MetricsEndFrame ();
 }
 
 static void Host_ClientPreFrame (void)
 {
+	double start;
+
+	start = Sys_FloatTime ();
+
 	// get new key events
 	Sys_SendKeyEvents ();
 
@@ -380,29 +409,53 @@ static void Host_ClientPreFrame (void)
 	// process console commands
 	Cbuf_Execute (src_client);
 
+	CL_TimeDemoAdd (td_input, Sys_FloatTime () - start);
+
 	if (!Host_IsLocalGame ())
+	{
 		// fetch results from server
+		start = Sys_FloatTime ();
 		CL_ReadPackets ();
+		CL_TimeDemoAdd (td_parse, Sys_FloatTime () - start);
+	}
 
 	if (Host_IsLocalGame ())
+	{
 		// if running the server locally, make intentions now
+		start = Sys_FloatTime ();
 		CL_SendCmd ();
+		CL_TimeDemoAdd (td_input, Sys_FloatTime () - start);
+	}
 }
 
 static void Host_ClientPostFrame (void)
 {
+	double start;
+
 	if (Host_IsLocalGame ())
+	{
 		// fetch results from server
+		start = Sys_FloatTime ();
 		CL_ReadPackets ();
+		CL_TimeDemoAdd (td_parse, Sys_FloatTime () - start);
+	}
 
 	// resend a connection request if necessary
 	CL_CheckForResend ();
 
 	if (!Host_IsLocalGame ())
+	{
 		// if running the server remotely, send intentions now after the incoming messages have been read
+		start = Sys_FloatTime ();
 		CL_SendCmd ();
+		CL_TimeDemoAdd (td_input, Sys_FloatTime () - start);
+	}
 
+	start = Sys_FloatTime ();
 	CL_PredictPlayers ();
+	CL_TimeDemoAdd (td_predict, Sys_FloatTime () - start);
+
+	start = Sys_FloatTime ();
 
 	// build a refresh entity list
 	CL_EmitEntities ();
@@ -410,7 +463,10 @@ static void Host_ClientPostFrame (void)
 	// update video
 	SCR_UpdateScreen ();
 
+	CL_TimeDemoAdd (td_render, Sys_FloatTime () - start);
+
 	// update audio
+	start = Sys_FloatTime ();
 	if (cls.state == ca_active)
 	{
 		S_Update (r_origin, vpn, vright, vup);
@@ -420,6 +476,7 @@ static void Host_ClientPostFrame (void)
 		S_Update (vec3_origin, (vec3_t){1, 0, 0}, (vec3_t){0, -1, 0}, (vec3_t){0, 0, 1});
 
 	Music_Update ();
+	CL_TimeDemoAdd (td_sound, Sys_FloatTime () - start);
 }
 
 /*
@@ -434,6 +491,10 @@ void Host_Frame (double time)
 	if (setjmp (host_abortserver))
 		return; // something bad happened, or the server disconnected
 
+	Host_FinishSave (false);
+
+	CL_TimeDemoBeginFrame ();
+
 	Host_ClientPreFrame ();
 
 	// check for commands typed to the host
@@ -449,6 +510,8 @@ void Host_Frame (double time)
 
 	Host_ClientPostFrame ();
 
+	CL_TimeDemoEndFrame ();
+
 	host_framecount++;
 	cl_framecount++;
 }
@@ -483,12 +546,14 @@ void Host_Init (quakeparms_t *parms)
 	com_argc = parms->argc;
 	com_argv = parms->argv;
 
-	Memory_Init (parms->membase, parms->memsize);
+	Memory_Init (parms->memsize);
 	Cbuf_Init ();
 	Cmd_Init ();
 	V_Init ();
 	Chase_Init ();
 	COM_Init (parms->basedir);
+	Task_Init ();
+	Log_Init ();
 	Host_InitLocal ();
 	W_LoadWadFile ("gfx.wad");
 	Key_Init ();
@@ -501,7 +566,7 @@ void Host_Init (quakeparms_t *parms)
 	SV_Init ();
 
 	Con_Printf ("Build: " __TIME__ " " __DATE__ "\n");
-	Con_Printf ("%4.1f megabyte heap\n", (float)parms->memsize / (1024 * 1024));
+	Con_Printf ("%4.1f megabyte heap limit\n", (float)parms->memsize / (1024 * 1024));
 
 	R_InitTextures (); // needed even for dedicated servers
 
@@ -564,6 +629,8 @@ void Host_Shutdown (void)
 	}
 	isdown = true;
 
+	Host_FinishSave (true);
+
 	// keep Con_Printf from trying to update the screen
 	scr_disabled_for_loading = true;
 
@@ -576,6 +643,8 @@ void Host_Shutdown (void)
 
 	if (cls.state != ca_dedicated)
 		VID_Shutdown ();
+
+	Log_Shutdown ();
 }
 
 bool Host_IsLocalGame (void)
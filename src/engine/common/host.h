@@ -14,8 +14,7 @@ typedef struct
 	char *cachedir; // for development over ISDN lines
 	int argc;
 	char **argv;
-	void *membase;
-	size_t memsize;
+	size_t memsize; // largest the hunk can grow
 } quakeparms_t;
 
 extern quakeparms_t host_parms;
@@ -48,6 +47,7 @@ bool Host_IsLocalClient (int userid);
 bool Host_IsDedicated (void);
 bool Host_IsMultiplayer (void);
 void Host_SetPaused (bool paused);
+void Host_FinishSave (bool wait);
 
 extern int current_skill; // skill level for currently loaded level (in case
 						  //  the user changes the cvar while the level is
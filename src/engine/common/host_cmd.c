@@ -206,6 +206,36 @@ LOAD / SAVE GAME
 */
 
 #define SAVEGAME_VERSION 5
+#define SAVEGAME_BINARY_VERSION 100
+
+/*
+binary saves start with the same version and comment lines as text saves, so
+the menu can list either kind.  after them come a savegame_t, the light
+styles as nul terminated strings and an ED_WriteSnapshot image.  they are in
+native byte order
+*/
+typedef struct
+{
+	float spawn_parms[NUM_SPAWN_PARMS];
+	int skill;
+	char mapname[MAX_QPATH];
+	float time;
+} savegame_t;
+
+enum
+{
+	SAVE_IDLE,
+	SAVE_WRITING,
+	SAVE_DONE,
+	SAVE_FAILED
+};
+
+static atomic_int save_state;
+static char save_name[MAX_OSPATH];
+static byte *save_data;
+static size_t save_len;
+
+static byte *load_data; // freed on the next load if a Host_Error skipped it
 
 /*
 ===============
@@ -231,12 +261,118 @@ static void Host_SavegameComment (char *text)
 	text[SAVEGAME_COMMENT_LENGTH] = '\0';
 }
 
+// runs on a worker thread
+static void Host_WriteSaveTask (void *arg)
+{
+	FILE *f;
+	bool ok;
+
+	f = fopen (save_name, "wb");
+	ok = f && fwrite (save_data, 1, save_len, f) == save_len;
+	if (f && fclose (f))
+		ok = false;
+
+	Z_Free (save_data);
+	save_data = NULL;
+
+	atomic_store (&save_state, ok ? SAVE_DONE : SAVE_FAILED);
+}
+
+/*
+===============
+Host_FinishSave
+
+Reports a background save once it has been written.  with wait, blocks
+until it has
+===============
+*/
+void Host_FinishSave (bool wait)
+{
+	while (wait && atomic_load (&save_state) == SAVE_WRITING)
+	{
+		if (!Task_RunOne ())
+			Sys_Sleep (1);
+	}
+
+	switch (atomic_load (&save_state))
+	{
+	case SAVE_DONE:
+		COM_FileWritten (save_name);
+		Con_Printf ("done.\n");
+		break;
+	case SAVE_FAILED:
+		Con_Printf ("ERROR: couldn't write %s.\n", save_name);
+		break;
+	default:
+		return;
+	}
+
+	atomic_store (&save_state, SAVE_IDLE);
+}
+
+/*
+===============
+Host_WriteBinarySave
+
+The snapshot is taken here, the file is written by a worker
+===============
+*/
+static void Host_WriteBinarySave (char *name, char *comment)
+{
+	sizebuf_t buf;
+	savegame_t save;
+	byte *snapshot;
+	size_t snaplen;
+	char *prologue, *style;
+	int i;
+
+	snapshot = ED_WriteSnapshot (&snaplen);
+
+	memset (&save, 0, sizeof (save));
+	memcpy (save.spawn_parms, svs.clients->spawn_parms, sizeof (save.spawn_parms));
+	save.skill = current_skill;
+	strncpy (save.mapname, sv.name, sizeof (save.mapname) - 1);
+	save.time = sv.time;
+
+	memset (&buf, 0, sizeof (buf));
+	buf.maxsize = 32 + SAVEGAME_COMMENT_LENGTH + sizeof (save) + snaplen;
+	for (i = 0; i < MAX_LIGHTSTYLES; i++)
+		buf.maxsize += (sv.lightstyles[i] ? strlen (sv.lightstyles[i]) : 1) + 1;
+	buf.data = Z_Malloc (buf.maxsize);
+
+	prologue = va ("%i\n%s\n", SAVEGAME_BINARY_VERSION, comment);
+	SZ_Write (&buf, prologue, strlen (prologue));
+	SZ_Write (&buf, &save, sizeof (save));
+	for (i = 0; i < MAX_LIGHTSTYLES; i++)
+	{
+		style = sv.lightstyles[i] ? sv.lightstyles[i] : "m";
+		SZ_Write (&buf, style, strlen (style) + 1);
+	}
+	SZ_Write (&buf, snapshot, snaplen);
+	Z_Free (snapshot);
+
+	strcpy (save_name, name);
+	save_data = buf.data;
+	save_len = buf.cursize;
+	atomic_store (&save_state, SAVE_WRITING);
+
+	Task_Add (Host_WriteSaveTask, NULL);
+}
+
+/*
+===============
+Host_Savegame_f
+
+save <name> [text] -- the text format is kept for exporting and editing
+===============
+*/
 static void Host_Savegame_f (void)
 {
 	char name[256];
 	FILE *f;
 	int i;
 	char comment[SAVEGAME_COMMENT_LENGTH + 1];
+	bool text;
 
 	if (!Host_IsLocalGame ())
 	{
@@ -256,9 +392,10 @@ static void Host_Savegame_f (void)
 		return;
 	}
 
-	if (Cmd_Argc () != 2)
+	text = Cmd_Argc () == 3 && !strcmp (Cmd_Argv (2), "text");
+	if (Cmd_Argc () != 2 && !text)
 	{
-		Con_Printf ("save <savename> : save a game\n");
+		Con_Printf ("save <savename> [text] : save a game\n");
 		return;
 	}
 
@@ -280,7 +417,17 @@ static void Host_Savegame_f (void)
 	sprintf (name, "%s/%s", com_gamedir, Cmd_Argv (1));
 	COM_DefaultExtension (name, ".sav");
 
+	Host_FinishSave (true);
+
 	Con_Printf ("Saving game to %s...\n", name);
+	Host_SavegameComment (comment);
+
+	if (!text)
+	{
+		Host_WriteBinarySave (name, comment);
+		return;
+	}
+
 	f = fopen (name, "w");
 	if (!f)
 	{
@@ -289,7 +436,6 @@ static void Host_Savegame_f (void)
 	}
 
 	fprintf (f, "%i\n", SAVEGAME_VERSION);
-	Host_SavegameComment (comment);
 	fprintf (f, "%s\n", comment);
 	for (i = 0; i < NUM_SPAWN_PARMS; i++)
 		fprintf (f, "%f\n", svs.clients->spawn_parms[i]);
@@ -314,9 +460,128 @@ static void Host_Savegame_f (void)
 		fflush (f);
 	}
 	fclose (f);
+	COM_FileWritten (name);
 	Con_Printf ("done.\n");
 }
 
+/*
+===============
+Host_SpawnSavedGame
+
+Starts the server for a savegame, the edicts are then loaded over it
+===============
+*/
+static bool Host_SpawnSavedGame (char *mapname, int skill)
+{
+	current_skill = skill;
+	Cvar_SetValue (src_server, "skill", (float)current_skill);
+
+	Cvar_SetValue (src_server, "deathmatch", 0);
+	Cvar_SetValue (src_server, "coop", 0);
+	Cvar_SetValue (src_server, "teamplay", 0);
+
+	SV_SpawnServer (mapname, NULL);
+
+	if (!Host_IsLocalGame ())
+	{
+		Con_Printf ("Couldn't load map\n");
+		return false;
+	}
+	sv.paused = true; // pause until all clients connect
+	sv.loadgame = true;
+
+	return true;
+}
+
+static void Host_FreeLoadData (void)
+{
+	Z_Free (load_data);
+	load_data = NULL;
+}
+
+static void Host_LoadBinarySave (char *name)
+{
+	FILE *f;
+	savegame_t save;
+	byte *p, *end;
+	char *styles[MAX_LIGHTSTYLES];
+	long len;
+	int i;
+
+	Host_FreeLoadData ();
+
+	f = fopen (name, "rb");
+	if (!f)
+	{
+		Con_Printf ("ERROR: couldn't open.\n");
+		return;
+	}
+	fseek (f, 0, SEEK_END);
+	len = ftell (f);
+	fseek (f, 0, SEEK_SET);
+	load_data = Z_Malloc (len + 1);
+	if (fread (load_data, 1, len, f) != len)
+		len = 0;
+	fclose (f);
+
+	// skip the version and comment
+	p = load_data;
+	end = load_data + len;
+	for (i = 0; i < 2 && p; i++)
+	{
+		p = memchr (p, '\n', end - p);
+		if (p)
+			p++;
+	}
+
+	if (!p || end - p < sizeof (save))
+	{
+		Con_Printf ("ERROR: savegame is truncated.\n");
+		Host_FreeLoadData ();
+		return;
+	}
+	memcpy (&save, p, sizeof (save));
+	save.mapname[sizeof (save.mapname) - 1] = 0;
+	p += sizeof (save);
+
+	for (i = 0; i < MAX_LIGHTSTYLES; i++)
+	{
+		styles[i] = (char *)p;
+		p = memchr (p, 0, end - p);
+		if (!p)
+		{
+			Con_Printf ("ERROR: savegame is truncated.\n");
+			Host_FreeLoadData ();
+			return;
+		}
+		p++;
+	}
+
+	Host_ShutdownServer (false);
+
+	if (!Host_SpawnSavedGame (save.mapname, save.skill))
+	{
+		Host_FreeLoadData ();
+		return;
+	}
+
+	for (i = 0; i < MAX_LIGHTSTYLES; i++)
+	{
+		sv.lightstyles[i] = Hunk_Alloc (strlen (styles[i]) + 1);
+		strcpy (sv.lightstyles[i], styles[i]);
+	}
+
+	ED_ReadSnapshot (p, end - p);
+
+	Host_FreeLoadData ();
+
+	for (i = 0; i < NUM_SPAWN_PARMS; i++)
+		svs.clients->spawn_parms[i] = save.spawn_parms[i];
+
+	if (cls.state != ca_dedicated)
+		Cmd_ExecuteString (src_client, "connect localhost");
+}
+
 static void Host_Loadgame_f (void)
 {
 	char name[MAX_OSPATH];
@@ -345,6 +610,8 @@ static void Host_Loadgame_f (void)
 	// been used.  The menu calls it before stuffing loadgame command
 	//	SCR_BeginLoadingPlaque ();
 
+	Host_FinishSave (true);
+
 	Con_Printf ("Loading game from %s...\n", name);
 	f = fopen (name, "r");
 	if (!f)
@@ -354,6 +621,12 @@ static void Host_Loadgame_f (void)
 	}
 
 	fscanf (f, "%i\n", &version);
+	if (version == SAVEGAME_BINARY_VERSION)
+	{
+		fclose (f);
+		Host_LoadBinarySave (name);
+		return;
+	}
 	if (version != SAVEGAME_VERSION)
 	{
 		fclose (f);
@@ -368,25 +641,15 @@ static void Host_Loadgame_f (void)
 		fscanf (f, "%f\n", &spawn_parms[i]);
 	// this silliness is so we can load 1.06 save files, which have float skill values
 	fscanf (f, "%f\n", &tfloat);
-	current_skill = (int)(tfloat + 0.1);
-	Cvar_SetValue (src_server, "skill", (float)current_skill);
-
-	Cvar_SetValue (src_server, "deathmatch", 0);
-	Cvar_SetValue (src_server, "coop", 0);
-	Cvar_SetValue (src_server, "teamplay", 0);
 
 	fscanf (f, "%s\n", mapname);
 	fscanf (f, "%f\n", &time);
 
-	SV_SpawnServer (mapname, NULL);
-
-	if (!Host_IsLocalGame ())
+	if (!Host_SpawnSavedGame (mapname, (int)(tfloat + 0.1)))
 	{
-		Con_Printf ("Couldn't load map\n");
+		fclose (f);
 		return;
 	}
-	sv.paused = true; // pause until all clients connect
-	sv.loadgame = true;
 
 	// load the light styles
 
@@ -500,6 +763,7 @@ static void SaveGamestate (void)
 		fflush (f);
 	}
 	fclose (f);
+	COM_FileWritten (name);
 	Con_Printf ("done.\n");
 }
 
@@ -721,6 +985,11 @@ static void Host_Stopdemo_f (void)
 	CL_Disconnect ();
 }
 
+static void Host_HunkPrint_f (void)
+{
+	Hunk_Print (!strcmp (Cmd_Argv (1), "all"));
+}
+
 void Host_InitCommands (void)
 {
 	Cmd_AddCommand (src_host, "quit", Host_Quit_f);
@@ -729,6 +998,7 @@ void Host_InitCommands (void)
 	Cmd_AddCommand (src_server, "changelevel", Host_Changelevel_f);
 	Cmd_AddCommand (src_server, "changelevel2", Host_Changelevel2_f);
 	Cmd_AddCommand (src_host, "version", Host_Version_f);
+	Cmd_AddCommand (src_host, "hunk_print", Host_HunkPrint_f);
 	Cmd_AddCommand (src_host, "load", Host_Loadgame_f);
 	Cmd_AddCommand (src_server, "save", Host_Savegame_f);
 
@@ -0,0 +1,464 @@
+/*
+===========================================================================
+Copyright (C) 1996-1997 Id Software, Inc.
+Copyright (C) 2023-2024 Justin Keller
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <https://www.gnu.org/licenses/>.
+===========================================================================
+*/
+
+// inflate.c -- deflate decompression for zip archives
+
+#include "bothdef.h"
+
+/*
+=============================================================================
+
+the whole stream is inflated into a buffer of known size in one call, so
+there is no window to keep and back references are copied straight out of
+the output.  huffman codes of up to FASTBITS bits are decoded with a single
+table lookup, longer ones by walking the canonical code counts.
+
+there is no global state after Inflate_Init, so separate streams can be
+inflated on separate threads
+
+=============================================================================
+*/
+
+#define MAXBITS 15
+#define MAXLCODES 286
+#define MAXDCODES 30
+#define FIXLCODES 288
+#define FASTBITS 9
+
+typedef struct
+{
+	unsigned short fast[1 << FASTBITS]; // symbol << 4 | length, 0 if the code is longer
+	short count[MAXBITS + 1];			// number of codes of each length
+	short symbol[FIXLCODES];			// symbols ordered by code
+} huffman_t;
+
+typedef struct
+{
+	byte *in, *inend;
+	uint64_t bitbuf;
+	int bitcnt;
+	int overrun; // zero bytes fed in past the end of the input
+
+	byte *out, *outpos, *outend;
+} inflate_t;
+
+static const short lbase[29] = {3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31, 35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258};
+static const short lext[29] = {0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2, 3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0};
+static const short dbase[30] = {1,	 2,	  3,   4,	5,	 7,	   9,	 13,   17,	 25,   33,	 49,   65,	  97,	 129,
+								193, 257, 385, 513, 769, 1025, 1537, 2049, 3073, 4097, 6145, 8193, 12289, 16385, 24577};
+static const short dext[30] = {0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6, 7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13};
+
+static const byte clorder[19] = {16, 17, 18, 0, 8, 7, 9, 6, 10, 5, 11, 4, 12, 3, 13, 2, 14, 1, 15};
+
+static huffman_t fixedlen, fixeddist;
+static unsigned crc32_table[256];
+
+static inline void Inf_Refill (inflate_t *s)
+{
+	while (s->bitcnt <= 56)
+	{
+		if (s->in < s->inend)
+			s->bitbuf |= (uint64_t)*s->in++ << s->bitcnt;
+		else
+			s->overrun++;
+		s->bitcnt += 8;
+	}
+}
+
+static inline int Inf_Bits (inflate_t *s, int n)
+{
+	int val;
+
+	if (s->bitcnt < n)
+		Inf_Refill (s);
+
+	val = s->bitbuf & ((1u << n) - 1);
+	s->bitbuf >>= n;
+	s->bitcnt -= n;
+
+	return val;
+}
+
+/*
+==================
+Inf_Build
+
+Builds the decoding tables from a list of code lengths.  Returns 0 for a
+complete code, more than 0 for an incomplete one and -1 if the lengths are
+over subscribed
+==================
+*/
+static int Inf_Build (huffman_t *h, byte *length, int n)
+{
+	short offs[MAXBITS + 1];
+	int next[MAXBITS + 1];
+	int sym, len, left, code, i;
+
+	memset (h->count, 0, sizeof (h->count));
+	for (sym = 0; sym < n; sym++)
+		h->count[length[sym]]++;
+
+	memset (h->fast, 0, sizeof (h->fast));
+	if (h->count[0] == n)
+		return 0; // no codes, only an error if something is decoded
+
+	left = 1;
+	for (len = 1; len <= MAXBITS; len++)
+	{
+		left <<= 1;
+		left -= h->count[len];
+		if (left < 0)
+			return -1;
+	}
+
+	offs[1] = 0;
+	for (len = 1; len < MAXBITS; len++)
+		offs[len + 1] = offs[len] + h->count[len];
+
+	for (sym = 0; sym < n; sym++)
+		if (length[sym])
+			h->symbol[offs[length[sym]]++] = sym;
+
+	// canonical codes, for the lookup table
+	code = 0;
+	next[0] = 0;
+	for (len = 1; len <= MAXBITS; len++)
+	{
+		code = (code + (len > 1 ? h->count[len - 1] : 0)) << 1;
+		next[len] = code;
+	}
+
+	for (sym = 0; sym < n; sym++)
+	{
+		len = length[sym];
+		if (!len)
+			continue;
+
+		code = next[len]++;
+		if (len > FASTBITS)
+			continue;
+
+		// codes are sent most significant bit first, bits are read least first
+		int rev = 0;
+		for (i = 0; i < len; i++)
+			rev |= ((code >> i) & 1) << (len - 1 - i);
+
+		for (i = rev; i < (1 << FASTBITS); i += 1 << len)
+			h->fast[i] = (sym << 4) | len;
+	}
+
+	return left;
+}
+
+/*
+==================
+Inf_Decode
+==================
+*/
+static inline int Inf_Decode (inflate_t *s, huffman_t *h)
+{
+	int e, len, code, first, index, count;
+	uint64_t bits;
+
+	if (s->bitcnt < MAXBITS)
+		Inf_Refill (s);
+
+	e = h->fast[s->bitbuf & ((1 << FASTBITS) - 1)];
+	if (e)
+	{
+		s->bitbuf >>= e & 15;
+		s->bitcnt -= e & 15;
+		return e >> 4;
+	}
+
+	// longer than the table, walk the code counts
+	bits = s->bitbuf;
+	code = first = index = 0;
+	for (len = 1; len <= MAXBITS; len++)
+	{
+		code |= bits & 1;
+		bits >>= 1;
+		count = h->count[len];
+		if (code - count < first)
+		{
+			s->bitbuf >>= len;
+			s->bitcnt -= len;
+			return h->symbol[index + (code - first)];
+		}
+		index += count;
+		first += count;
+		first <<= 1;
+		code <<= 1;
+	}
+
+	return -1;
+}
+
+/*
+==================
+Inf_Stored
+==================
+*/
+static bool Inf_Stored (inflate_t *s)
+{
+	int len, nlen, avail;
+
+	// go to a byte boundary
+	Inf_Bits (s, s->bitcnt & 7);
+
+	len = Inf_Bits (s, 16);
+	nlen = Inf_Bits (s, 16);
+	if (len != (~nlen & 0xffff))
+		return false;
+
+	avail = s->bitcnt / 8 - s->overrun + (s->inend - s->in);
+	if (len > avail || len > s->outend - s->outpos)
+		return false;
+
+	// whatever is left in the bit buffer first
+	while (len && s->bitcnt)
+	{
+		*s->outpos++ = Inf_Bits (s, 8);
+		len--;
+	}
+
+	memcpy (s->outpos, s->in, len);
+	s->outpos += len;
+	s->in += len;
+
+	return true;
+}
+
+/*
+==================
+Inf_Codes
+==================
+*/
+static bool Inf_Codes (inflate_t *s, huffman_t *lencode, huffman_t *distcode)
+{
+	int sym, len, dist;
+	byte *from;
+
+	for (;;)
+	{
+		sym = Inf_Decode (s, lencode);
+		if (sym < 0)
+			return false;
+
+		if (sym < 256)
+		{
+			if (s->outpos == s->outend)
+				return false;
+			*s->outpos++ = sym;
+			continue;
+		}
+
+		if (sym == 256)
+			return true;
+
+		sym -= 257;
+		if (sym >= 29)
+			return false;
+		len = lbase[sym] + Inf_Bits (s, lext[sym]);
+
+		sym = Inf_Decode (s, distcode);
+		if (sym < 0 || sym >= 30)
+			return false;
+		dist = dbase[sym] + Inf_Bits (s, dext[sym]);
+
+		if (dist > s->outpos - s->out || len > s->outend - s->outpos)
+			return false;
+
+		from = s->outpos - dist;
+		if (dist >= len)
+		{
+			memcpy (s->outpos, from, len);
+			s->outpos += len;
+		}
+		else
+		{ // overlapping, repeats the last dist bytes
+			while (len--)
+				*s->outpos++ = *from++;
+		}
+	}
+}
+
+/*
+==================
+Inf_Dynamic
+==================
+*/
+static bool Inf_Dynamic (inflate_t *s)
+{
+	int nlen, ndist, ncode;
+	int index, sym, len, repeat;
+	byte lengths[MAXLCODES + MAXDCODES];
+	huffman_t lencode, distcode;
+
+	nlen = Inf_Bits (s, 5) + 257;
+	ndist = Inf_Bits (s, 5) + 1;
+	ncode = Inf_Bits (s, 4) + 4;
+	if (nlen > MAXLCODES || ndist > MAXDCODES)
+		return false;
+
+	// code length code
+	memset (lengths, 0, 19);
+	for (index = 0; index < ncode; index++)
+		lengths[clorder[index]] = Inf_Bits (s, 3);
+	if (Inf_Build (&lencode, lengths, 19) != 0)
+		return false;
+
+	// literal/length and distance code lengths
+	index = 0;
+	while (index < nlen + ndist)
+	{
+		sym = Inf_Decode (s, &lencode);
+		if (sym < 0)
+			return false;
+
+		if (sym < 16)
+		{
+			lengths[index++] = sym;
+			continue;
+		}
+
+		len = 0;
+		if (sym == 16)
+		{
+			if (!index)
+				return false;
+			len = lengths[index - 1];
+			repeat = 3 + Inf_Bits (s, 2);
+		}
+		else if (sym == 17)
+			repeat = 3 + Inf_Bits (s, 3);
+		else
+			repeat = 11 + Inf_Bits (s, 7);
+
+		if (index + repeat > nlen + ndist)
+			return false;
+		while (repeat--)
+			lengths[index++] = len;
+	}
+
+	if (!lengths[256])
+		return false; // no end of block code
+
+	if (Inf_Build (&lencode, lengths, nlen) < 0)
+		return false;
+	if (Inf_Build (&distcode, lengths + nlen, ndist) < 0)
+		return false;
+
+	return Inf_Codes (s, &lencode, &distcode);
+}
+
+/*
+==================
+Inflate
+==================
+*/
+ssize_t Inflate (byte *out, size_t outlen, byte *in, size_t inlen)
+{
+	inflate_t s;
+	int last, type;
+	bool ok;
+
+	s.in = in;
+	s.inend = in + inlen;
+	s.bitbuf = 0;
+	s.bitcnt = 0;
+	s.overrun = 0;
+	s.out = s.outpos = out;
+	s.outend = out + outlen;
+
+	do
+	{
+		last = Inf_Bits (&s, 1);
+		type = Inf_Bits (&s, 2);
+
+		if (type == 0)
+			ok = Inf_Stored (&s);
+		else if (type == 1)
+			ok = Inf_Codes (&s, &fixedlen, &fixeddist);
+		else if (type == 2)
+			ok = Inf_Dynamic (&s);
+		else
+			ok = false;
+
+		// ran off the end of the input
+		if (s.overrun * 8 > s.bitcnt)
+			ok = false;
+
+		if (!ok)
+			return -1;
+	} while (!last);
+
+	return s.outpos - s.out;
+}
+
+/*
+==================
+CRC32_Block
+==================
+*/
+unsigned CRC32_Block (unsigned crc, byte *data, size_t len)
+{
+	crc = ~crc;
+	while (len--)
+		crc = crc32_table[(crc ^ *data++) & 255] ^ (crc >> 8);
+
+	return ~crc;
+}
+
+/*
+==================
+Inflate_Init
+
+Builds the fixed huffman codes and the crc table
+==================
+*/
+void Inflate_Init (void)
+{
+	byte lengths[FIXLCODES];
+	unsigned c;
+	int i, j;
+
+	for (i = 0; i < 144; i++)
+		lengths[i] = 8;
+	for (; i < 256; i++)
+		lengths[i] = 9;
+	for (; i < 280; i++)
+		lengths[i] = 7;
+	for (; i < FIXLCODES; i++)
+		lengths[i] = 8;
+	Inf_Build (&fixedlen, lengths, FIXLCODES);
+
+	for (i = 0; i < MAXDCODES; i++)
+		lengths[i] = 5;
+	Inf_Build (&fixeddist, lengths, MAXDCODES);
+
+	for (i = 0; i < 256; i++)
+	{
+		c = i;
+		for (j = 0; j < 8; j++)
+			c = c & 1 ? 0xedb88320 ^ (c >> 1) : c >> 1;
+		crc32_table[i] = c;
+	}
+}
@@ -0,0 +1,15 @@
+#ifndef _INFLATE_H
+#define _INFLATE_H
+
+// raw deflate streams, as stored in zip files
+
+void Inflate_Init (void);
+
+// returns the number of bytes written to out, or -1 if the stream is bad
+// or doesn't fit.  safe to call from any thread after Inflate_Init
+ssize_t Inflate (byte *out, size_t outlen, byte *in, size_t inlen);
+
+// zip style crc, start with 0
+unsigned CRC32_Block (unsigned crc, byte *data, size_t len);
+
+#endif /* !_INFLATE_H */
@@ -0,0 +1,245 @@
+/*
+===========================================================================
+Copyright (C) 1996-1997 Id Software, Inc.
+Copyright (C) 2023-2024 Justin Keller
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <https://www.gnu.org/licenses/>.
+===========================================================================
+*/
+
+// log.c -- background writer for console and log file output
+
+#include "bothdef.h"
+
+/*
+writers claim a run of slots by moving the head forward with a compare and
+swap, fill them in and publish each one by setting its sequence number.
+the writer thread follows the tail, writing slots in order as they are
+published, so text longer than a slot stays in one piece.
+
+the only lock is taken by a writer that finds the thread asleep, to wake it
+*/
+
+#define LOG_SLOTS 1024 // power of two
+#define LOG_SLOT_TEXT 244
+
+typedef struct
+{
+	atomic_uint seq; // position + 1 once the slot is filled in
+	int dest;
+	int len;
+	char text[LOG_SLOT_TEXT];
+} logslot_t;
+
+static logslot_t log_ring[LOG_SLOTS];
+static atomic_uint log_head; // next position to claim
+static atomic_uint log_tail; // next position to write out
+
+static atomic_int log_dropped;
+static int log_reported; // drops already written out
+
+static FILE *log_files[LOG_NUMFILES];
+
+static void *log_thread;
+static void *log_mutex;
+static void *log_wake;
+static atomic_bool log_sleeping;
+static atomic_bool log_quit;
+
+static void Log_Output (int dest, char *text, int len)
+{
+	FILE *f;
+
+	f = dest == LOG_STDOUT ? stdout : log_files[dest];
+	if (f)
+		fwrite (text, 1, len, f);
+}
+
+static bool Log_Ready (void)
+{
+	unsigned tail;
+
+	tail = atomic_load (&log_tail);
+	return atomic_load (&log_ring[tail & (LOG_SLOTS - 1)].seq) == tail + 1;
+}
+
+/*
+==================
+Log_Drain
+
+Writes out everything published so far, returns false if there was nothing
+==================
+*/
+static bool Log_Drain (void)
+{
+	bool touched[LOG_NUMFILES] = {false};
+	logslot_t *slot;
+	unsigned start, tail;
+	int i, dropped;
+	char msg[64];
+
+	start = tail = atomic_load (&log_tail);
+	slot = &log_ring[tail & (LOG_SLOTS - 1)];
+	if (atomic_load (&slot->seq) != tail + 1)
+		return false;
+
+	do
+	{
+		Log_Output (slot->dest, slot->text, slot->len);
+		touched[slot->dest] = true;
+
+		tail++;
+		slot = &log_ring[tail & (LOG_SLOTS - 1)];
+	} while (atomic_load (&slot->seq) == tail + 1 && tail - start < LOG_SLOTS / 4);
+
+	dropped = atomic_load (&log_dropped);
+	if (dropped != log_reported)
+	{
+		i = snprintf (msg, sizeof (msg), "%i lines of output dropped\n", dropped - log_reported);
+		Log_Output (LOG_STDOUT, msg, i);
+		touched[LOG_STDOUT] = true;
+		log_reported = dropped;
+	}
+
+	for (i = 0; i < LOG_NUMFILES; i++)
+		if (touched[i])
+			fflush (i == LOG_STDOUT ? stdout : log_files[i]);
+
+	// the slots can be claimed again, and Log_Flush knows the files are done
+	atomic_store (&log_tail, tail);
+
+	return true;
+}
+
+static void Log_Thread (void *arg)
+{
+	while (!atomic_load (&log_quit))
+	{
+		if (Log_Drain ())
+			continue;
+
+		// a writer checks log_sleeping after publishing, so either it sees
+		// the flag and wakes us or we see its slot here
+		Sys_LockMutex (log_mutex);
+		atomic_store (&log_sleeping, true);
+		if (!Log_Ready () && !atomic_load (&log_quit))
+			Sys_WaitCond (log_wake, log_mutex);
+		atomic_store (&log_sleeping, false);
+		Sys_UnlockMutex (log_mutex);
+	}
+
+	while (Log_Drain ())
+		;
+}
+
+static void Log_Wake (void)
+{
+	Sys_LockMutex (log_mutex);
+	Sys_SignalCond (log_wake);
+	Sys_UnlockMutex (log_mutex);
+}
+
+/*
+==================
+Log_Init
+
+-nologthread writes everything out on the calling thread, as it is printed
+==================
+*/
+void Log_Init (void)
+{
+	if (COM_CheckParm ("-nologthread"))
+		return;
+
+	log_mutex = Sys_CreateMutex ();
+	log_wake = Sys_CreateCond ();
+	log_thread = Sys_CreateThread (Log_Thread, NULL);
+}
+
+void Log_Shutdown (void)
+{
+	if (!log_thread)
+		return;
+
+	atomic_store (&log_quit, true);
+	Log_Wake ();
+
+	Sys_WaitThread (log_thread);
+	log_thread = NULL; // anything printed from here on goes straight out
+
+	fflush (stdout);
+}
+
+void Log_Write (int dest, char *text)
+{
+	logslot_t *slot;
+	unsigned pos;
+	int len, n, i;
+
+	len = strlen (text);
+	if (!len)
+		return;
+
+	if (!log_thread)
+	{
+		Log_Output (dest, text, len);
+		if (dest != LOG_STDOUT && log_files[dest])
+			fflush (log_files[dest]);
+		return;
+	}
+
+	n = (len + LOG_SLOT_TEXT - 1) / LOG_SLOT_TEXT;
+
+	// claim n slots, if there is room for them
+	pos = atomic_load (&log_head);
+	do
+	{
+		if (n > LOG_SLOTS - (int)(pos - atomic_load (&log_tail)))
+		{
+			atomic_fetch_add (&log_dropped, 1);
+			return;
+		}
+	} while (!atomic_compare_exchange_weak (&log_head, &pos, pos + n));
+
+	for (i = 0; i < n; i++, text += LOG_SLOT_TEXT, len -= LOG_SLOT_TEXT)
+	{
+		slot = &log_ring[(pos + i) & (LOG_SLOTS - 1)];
+		slot->dest = dest;
+		slot->len = len < LOG_SLOT_TEXT ? len : LOG_SLOT_TEXT;
+		memcpy (slot->text, text, slot->len);
+		atomic_store (&slot->seq, pos + i + 1);
+	}
+
+	if (atomic_load (&log_sleeping))
+		Log_Wake ();
+}
+
+void Log_Flush (void)
+{
+	if (!log_thread)
+		return;
+
+	while (atomic_load (&log_tail) != atomic_load (&log_head))
+	{
+		if (atomic_load (&log_sleeping))
+			Log_Wake ();
+		Sys_Sleep (1);
+	}
+}
+
+void Log_SetFile (int dest, FILE *f)
+{
+	Log_Flush ();
+	log_files[dest] = f;
+}
@@ -0,0 +1,30 @@
+#ifndef _LOG_H
+#define _LOG_H
+
+// text output that is written out by a background thread, so a slow pipe or
+// disk can't stall a frame.  if the ring fills up, lines are dropped and
+// counted instead of waiting
+
+enum
+{
+	LOG_STDOUT,
+	LOG_CONSOLE, // qconsole.log with -condebug
+	LOG_FRAGS,	 // fraglogfile
+	LOG_METRICS, // metricslog
+	LOG_NUMFILES
+};
+
+void Log_Init (void);
+void Log_Shutdown (void); // writes everything still queued
+
+// copies the text and returns at once, safe from any thread.  before
+// Log_Init or with -nologthread it is written out immediately
+void Log_Write (int dest, char *text);
+
+// waits until everything queued so far has been written
+void Log_Flush (void);
+
+// the log doesn't close files, after Log_SetFile the old one can be closed
+void Log_SetFile (int dest, FILE *f);
+
+#endif /* !_LOG_H */
@@ -29,6 +29,7 @@ void NET_Init (void);
 void NET_Shutdown (void);
 bool NET_GetPacket (netsocket_e sock);
 void NET_SendPacket (netsocket_e sock, int length, void *data, netadr_t to);
+byte *NET_GetLoopbackBuffer (netsocket_e sock, netadr_t to);
 bool NET_Open (netsocket_e sock, int port);
 void NET_Close (netsocket_e sock);
 netadr_t NET_GetLocalAddress (void);
@@ -108,8 +108,10 @@ static void Netchan_OutOfBand (netsocket_e sock, netadr_t adr, int length, byte
 	sizebuf_t send;
 	byte send_buf[MAX_MSGLEN + PACKET_HEADER];
 
-	// write the packet header
-	send.data = send_buf;
+	// write the packet header, straight into the loopback if it's local
+	send.data = NET_GetLoopbackBuffer (sock, adr);
+	if (!send.data)
+		send.data = send_buf;
 	send.maxsize = sizeof (send_buf);
 	send.cursize = 0;
 
@@ -241,8 +243,10 @@ void Netchan_Transmit (netchan_t *chan, int length, byte *data)
 		send_reliable = true;
 	}
 
-	// write the packet header
-	send.data = send_buf;
+	// write the packet header, straight into the loopback if it's local
+	send.data = NET_GetLoopbackBuffer (chan->socket, chan->remote_address);
+	if (!send.data)
+		send.data = send_buf;
 	send.maxsize = sizeof (send_buf);
 	send.cursize = 0;
 
@@ -255,10 +259,8 @@ void Netchan_Transmit (netchan_t *chan, int length, byte *data)
 	MSG_WriteLong (&send, w2);
 
 	// send the qport if we are a client
-#ifndef SERVERONLY
 	if (chan->socket == CLIENT)
-		MSG_WriteShort (&send, cls.qport);
-#endif
+		MSG_WriteShort (&send, chan->qport);
 
 	// copy the reliable message to the packet first
 	if (send_reliable)
@@ -42,8 +42,28 @@ static char net_public_adr[24];
 #define MAX_UDP_PACKET 8192
 static byte net_message_buffer[SOCKETS][MAX_UDP_PACKET];
 
-static byte net_loopback_buffer[SOCKETS][MAX_UDP_PACKET];
-static size_t net_loopback_size[SOCKETS];
+/*
+the loopback is a ring of whole packets per sending socket.  buffers are
+never copied on the way in; the receiver swaps its net_message buffer with
+the one holding the packet, so ownership moves between the ring and the
+reader instead of the bytes
+*/
+#define MAX_LOOPBACK 8 // must be a power of two
+
+typedef struct
+{
+	byte *data;
+	int cursize;
+} loopmsg_t;
+
+typedef struct
+{
+	loopmsg_t msgs[MAX_LOOPBACK];
+	unsigned int get, send;
+} loopback_t;
+
+static byte net_loopback_buffers[SOCKETS][MAX_LOOPBACK][MAX_UDP_PACKET];
+static loopback_t net_loopback[SOCKETS];
 
 static void NetadrToSockadr (netadr_t *a, struct sockaddr_in *s)
 {
@@ -184,14 +204,46 @@ bool NET_IsClientLegal (netadr_t *adr)
 	return false;
 }
 
+/*
+====================
+NET_IsLoopback
+
+Returns true if a packet to this address is bound for the other half of
+this process rather than the wire
+====================
+*/
+static bool NET_IsLoopback (netsocket_e sock, netadr_t *to)
+{
+	if (!NET_IsLocalHost (to))
+		return false;
+
+	// a client in another process on this machine still goes over udp
+	if (sock == SERVER)
+		return to->port == PORT_CLIENT;
+
+	return Host_IsLocalGame ();
+}
+
 static bool NET_GetLoopbackPacket (netsocket_e sock)
 {
-	if (net_loopback_size[!sock] == 0)
+	loopback_t *loop;
+	loopmsg_t *msg;
+	byte *swap;
+
+	loop = &net_loopback[!sock];
+
+	if (loop->get == loop->send)
 		return false;
 
-	memcpy (net_message_buffer[sock], net_loopback_buffer[!sock], net_loopback_size[!sock]);
-	net_message[sock].cursize = net_loopback_size[!sock];
-	net_loopback_size[!sock] = 0;
+	msg = &loop->msgs[loop->get & (MAX_LOOPBACK - 1)];
+	loop->get++;
+
+	// hand the packet over by trading buffers with the reader
+	swap = net_message[sock].data;
+	net_message[sock].data = msg->data;
+	net_message[sock].cursize = msg->cursize;
+	msg->data = swap;
+	msg->cursize = 0;
 
 	net_from.ip[0] = 127;
 	net_from.ip[1] = 0;
@@ -215,7 +267,7 @@ bool NET_GetPacket (netsocket_e sock)
 
 	fromlen = sizeof (from);
 
-	ret = recvfrom (net_socket[sock], net_message_buffer[sock], sizeof (net_message_buffer[sock]), 0, (struct sockaddr *)&from, &fromlen);
+	ret = recvfrom (net_socket[sock], net_message[sock].data, net_message[sock].maxsize, 0, (struct sockaddr *)&from, &fromlen);
 
 	if (ret == -1)
 	{
@@ -233,16 +285,52 @@ bool NET_GetPacket (netsocket_e sock)
 	return ret;
 }
 
+/*
+====================
+NET_GetLoopbackBuffer
+
+Returns the buffer the next loopback packet from this socket will be
+delivered in, so the sender can build it in place.  NULL if the packet
+is going over the wire or the ring is full.
+====================
+*/
+byte *NET_GetLoopbackBuffer (netsocket_e sock, netadr_t to)
+{
+	loopback_t *loop;
+
+	if (!NET_IsLoopback (sock, &to))
+		return NULL;
+
+	loop = &net_loopback[sock];
+
+	if (loop->send - loop->get >= MAX_LOOPBACK)
+		return NULL;
+
+	return loop->msgs[loop->send & (MAX_LOOPBACK - 1)].data;
+}
+
 static bool NET_SendLoopbackPacket (netsocket_e sock, int length, void *data, netadr_t to)
 {
-	if (!NET_IsLocalHost (&to))
+	loopback_t *loop;
+	loopmsg_t *msg;
+
+	if (!NET_IsLoopback (sock, &to))
 		return false;
 
-	if (net_loopback_size[sock] + length <= MAX_UDP_PACKET)
-	{
-		memcpy (net_loopback_buffer[sock] + net_loopback_size[sock], data, length);
-		net_loopback_size[sock] += length;
-	}
+	loop = &net_loopback[sock];
+
+	// drop it on the floor, same as the wire would
+	if (loop->send - loop->get >= MAX_LOOPBACK || length > MAX_UDP_PACKET)
+		return true;
+
+	msg = &loop->msgs[loop->send & (MAX_LOOPBACK - 1)];
+
+	// packets built with NET_GetLoopbackBuffer are already in place
+	if (data != msg->data)
+		memcpy (msg->data, data, length);
+
+	msg->cursize = length;
+	loop->send++;
 
 	return true;
 }
@@ -454,7 +542,7 @@ void NET_Close (netsocket_e sock)
 		net_socket[sock] = 0;
 		Con_Printf ("%s socket closed\n", (sock == SERVER) ? "Server" : "Client");
 	}
-	net_loopback_size[sock] = 0;
+	net_loopback[sock].get = net_loopback[sock].send;
 }
 
 bool NET_Open (netsocket_e sock, int port)
@@ -479,6 +567,8 @@ bool NET_Open (netsocket_e sock, int port)
 
 void NET_Init (void)
 {
+	int i, j;
+
 	//
 	// init the message buffers
 	//
@@ -488,6 +578,12 @@ void NET_Init (void)
 	net_message[SERVER].maxsize = sizeof (net_message_buffer[SERVER]);
 	net_message[SERVER].data = net_message_buffer[SERVER];
 
+	for (i = 0; i < SOCKETS; i++)
+	{
+		for (j = 0; j < MAX_LOOPBACK; j++)
+			net_loopback[i].msgs[j].data = net_loopback_buffers[i][j];
+	}
+
 	//
 	// determine my name & address
 	//
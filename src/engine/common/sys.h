@@ -17,8 +17,31 @@ void Sys_FileSeek (int handle, size_t position);
 ssize_t Sys_FileRead (int handle, void *dest, size_t count);
 ssize_t Sys_FileWrite (int handle, void *data, size_t count);
 int Sys_FileTime (char *path);
+
+// maps the whole file read-only, NULL if it can't be mapped
+// the mapping stays valid after the handle is closed
+void *Sys_FileMap (int handle, size_t size);
+void Sys_FileUnmap (void *base, size_t size);
+
+// opens an unnamed file that is removed when it is closed
+int Sys_FileOpenTemp (void);
+
+//
+// memory
+//
+
+// reserves address space without backing it, NULL on failure
+void *Sys_ReserveMemory (size_t size);
+// backs part of a reservation with zero filled memory
+bool Sys_CommitMemory (void *base, size_t size);
+// gives the memory back, the range stays reserved
+void Sys_DecommitMemory (void *base, size_t size);
+
 void Sys_mkdir (char *path);
 
+// calls func for every entry in a directory
+void Sys_ListDir (char *path, void (*func) (char *name, bool isdir, void *arg), void *arg);
+
 //
 // system IO
 //
@@ -41,4 +64,23 @@ char *Sys_ConsoleInput (void);
 void Sys_SendKeyEvents (void);
 // Perform Key_Event () callbacks until the input que is empty
 
+//
+// threads
+//
+
+// returns NULL if the thread couldn't be started
+void *Sys_CreateThread (void (*func) (void *arg), void *arg);
+void Sys_WaitThread (void *thread);
+
+int Sys_NumCPUs (void);
+
+void *Sys_CreateMutex (void);
+void Sys_LockMutex (void *mutex);
+void Sys_UnlockMutex (void *mutex);
+
+// the mutex must be locked around waits and signals
+void *Sys_CreateCond (void);
+void Sys_WaitCond (void *cond, void *mutex);
+void Sys_SignalCond (void *cond); // wakes every waiting thread
+
 #endif /* !_SYS_H */
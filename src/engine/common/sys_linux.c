@@ -37,6 +37,8 @@ along with this program.  If not, see <https://www.gnu.org/licenses/>.
 #include <sys/mman.h>
 #include <errno.h>
 #include <time.h>
+#include <dirent.h>
+#include <pthread.h>
 
 #include "clientdef.h"
 #include "serverdef.h"
@@ -47,7 +49,9 @@ void Sys_Printf (char *fmt, ...)
 {
 	va_list argptr;
 	char text[1024];
+	char out[sizeof (text) * 4]; // room for every character as [xx]
 	unsigned char *p;
+	char *o;
 
 	va_start (argptr, fmt);
 	vsprintf (text, fmt, argptr);
@@ -59,14 +63,18 @@ void Sys_Printf (char *fmt, ...)
 	if (nostdout)
 		return;
 
-	for (p = (unsigned char *)text; *p; p++)
+	for (p = (unsigned char *)text, o = out; *p; p++)
 	{
 		*p &= 0x7f;
 		if ((*p > 128 || *p < 32) && *p != 10 && *p != 13 && *p != 9)
-			printf ("[%02x]", *p);
+			o += sprintf (o, "[%02x]", *p);
 		else
-			putc (*p, stdout);
+			*o++ = *p;
 	}
+	*o = 0;
+
+	// written by the log thread, so a slow terminal or pipe can't hold up a frame
+	Log_Write (LOG_STDOUT, out);
 }
 
 void Sys_Quit (void)
@@ -90,6 +98,7 @@ void Sys_Error (char *error, ...)
 	va_start (argptr, error);
 	vsprintf (string, error, argptr);
 	va_end (argptr);
+	Log_Flush (); // keep the error after whatever was printed before it
 	fprintf (stderr, "Error: %s\n", string);
 
 	Host_Shutdown ();
@@ -129,6 +138,44 @@ void Sys_mkdir (char *path)
 	mkdir (path, 0777);
 }
 
+/*
+============
+Sys_ListDir
+
+Calls func for every entry in path except . and ..
+============
+*/
+void Sys_ListDir (char *path, void (*func) (char *name, bool isdir, void *arg), void *arg)
+{
+	DIR *dir;
+	struct dirent *ent;
+	struct stat buf;
+	char full[MAX_OSPATH];
+	bool isdir;
+
+	dir = opendir (path);
+	if (!dir)
+		return;
+
+	while ((ent = readdir (dir)) != NULL)
+	{
+		if (!strcmp (ent->d_name, ".") || !strcmp (ent->d_name, ".."))
+			continue;
+
+		if (ent->d_type != DT_UNKNOWN && ent->d_type != DT_LNK)
+			isdir = ent->d_type == DT_DIR;
+		else
+		{
+			snprintf (full, sizeof (full), "%s/%s", path, ent->d_name);
+			isdir = stat (full, &buf) != -1 && S_ISDIR (buf.st_mode);
+		}
+
+		func (ent->d_name, isdir, arg);
+	}
+
+	closedir (dir);
+}
+
 off_t Sys_FileOpenRead (char *path, int *handle)
 {
 	int h;
@@ -179,6 +226,60 @@ ssize_t Sys_FileRead (int handle, void *dest, size_t count)
 	return read (handle, dest, count);
 }
 
+void *Sys_FileMap (int handle, size_t size)
+{
+	void *base;
+
+	if (!size)
+		return NULL;
+
+	base = mmap (NULL, size, PROT_READ, MAP_PRIVATE, handle, 0);
+	if (base == MAP_FAILED)
+		return NULL;
+
+	return base;
+}
+
+void Sys_FileUnmap (void *base, size_t size)
+{
+	munmap (base, size);
+}
+
+void *Sys_ReserveMemory (size_t size)
+{
+	void *base;
+
+	base = mmap (NULL, size, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+	if (base == MAP_FAILED)
+		return NULL;
+
+	return base;
+}
+
+bool Sys_CommitMemory (void *base, size_t size)
+{
+	return mprotect (base, size, PROT_READ | PROT_WRITE) == 0;
+}
+
+void Sys_DecommitMemory (void *base, size_t size)
+{
+	// mapping over it drops the pages, and they read back as zero
+	mmap (base, size, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE | MAP_FIXED, -1, 0);
+}
+
+int Sys_FileOpenTemp (void)
+{
+	char name[] = "/tmp/quakeXXXXXX";
+	int handle;
+
+	handle = mkstemp (name);
+	if (handle == -1)
+		Sys_Error ("Error creating temp file: %s", strerror (errno));
+	unlink (name);
+
+	return handle;
+}
+
 void Sys_DebugLog (char *file, char *fmt, ...)
 {
 	va_list argptr;
@@ -240,6 +341,100 @@ void Sys_Sleep (int msec)
 	nanosleep (&ts, NULL);
 }
 
+typedef struct
+{
+	pthread_t thread;
+	void (*func) (void *arg);
+	void *arg;
+} systhread_t;
+
+static void *Sys_ThreadStart (void *arg)
+{
+	systhread_t *t = arg;
+
+	t->func (t->arg);
+	return NULL;
+}
+
+void *Sys_CreateThread (void (*func) (void *arg), void *arg)
+{
+	systhread_t *t;
+
+	t = malloc (sizeof (*t));
+	if (!t)
+		return NULL;
+	t->func = func;
+	t->arg = arg;
+
+	if (pthread_create (&t->thread, NULL, Sys_ThreadStart, t))
+	{
+		free (t);
+		return NULL;
+	}
+
+	return t;
+}
+
+void Sys_WaitThread (void *thread)
+{
+	systhread_t *t = thread;
+
+	pthread_join (t->thread, NULL);
+	free (t);
+}
+
+int Sys_NumCPUs (void)
+{
+	long n;
+
+	n = sysconf (_SC_NPROCESSORS_ONLN);
+	return n < 1 ? 1 : n;
+}
+
+void *Sys_CreateMutex (void)
+{
+	pthread_mutex_t *m;
+
+	m = malloc (sizeof (*m));
+	if (!m)
+		Sys_Error ("Sys_CreateMutex: out of memory");
+	pthread_mutex_init (m, NULL);
+
+	return m;
+}
+
+void Sys_LockMutex (void *mutex)
+{
+	pthread_mutex_lock (mutex);
+}
+
+void Sys_UnlockMutex (void *mutex)
+{
+	pthread_mutex_unlock (mutex);
+}
+
+void *Sys_CreateCond (void)
+{
+	pthread_cond_t *c;
+
+	c = malloc (sizeof (*c));
+	if (!c)
+		Sys_Error ("Sys_CreateCond: out of memory");
+	pthread_cond_init (c, NULL);
+
+	return c;
+}
+
+void Sys_WaitCond (void *cond, void *mutex)
+{
+	pthread_cond_wait (cond, mutex);
+}
+
+void Sys_SignalCond (void *cond)
+{
+	pthread_cond_broadcast (cond);
+}
+
 char *Sys_ConsoleInput (void)
 {
 	static char text[256];
@@ -280,12 +475,12 @@ int main (int c, char **v)
 	parms.argc = com_argc;
 	parms.argv = com_argv;
 
-	parms.memsize = 16 * 1024 * 1024;
+	// only address space, the hunk maps what it uses
+	parms.memsize = 1024 * 1024 * 1024;
 
 	j = COM_CheckParm ("-mem");
 	if (j)
 		parms.memsize = (size_t)atoi (com_argv[j + 1]) * 1024 * 1024;
-	parms.membase = malloc (parms.memsize);
 
 	parms.basedir = ".";
 
@@ -0,0 +1,186 @@
+/*
+===========================================================================
+Copyright (C) 1996-1997 Id Software, Inc.
+Copyright (C) 2023-2024 Justin Keller
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <https://www.gnu.org/licenses/>.
+===========================================================================
+*/
+
+// task.c -- worker thread pool
+
+#include "bothdef.h"
+
+/*
+the workers are started once and sleep until something is queued.  the
+thread that waits for the queue runs tasks itself until it is empty, so
+with no workers everything simply runs in order on the main thread
+*/
+
+#define MAX_TASK_THREADS 16
+#define MAX_TASKS 4096 // queued at once, more run on the adding thread
+
+typedef struct
+{
+	taskfunc_t func;
+	void *arg;
+} task_t;
+
+static task_t task_queue[MAX_TASKS];
+static int task_head, task_tail;
+static int task_pending; // queued or running
+
+static void *task_mutex;
+static void *task_wake; // signaled when a task is queued
+static void *task_done; // signaled when nothing is pending
+
+static int task_numthreads;
+
+// the mutex must be held
+static bool Task_Pop (task_t *t)
+{
+	if (task_head == task_tail)
+		return false;
+
+	*t = task_queue[task_head];
+	task_head = (task_head + 1) % MAX_TASKS;
+
+	return true;
+}
+
+// the mutex must be held
+static void Task_Finished (void)
+{
+	if (!--task_pending)
+		Sys_SignalCond (task_done);
+}
+
+static void Task_Thread (void *arg)
+{
+	task_t t;
+
+	Sys_LockMutex (task_mutex);
+	for (;;)
+	{
+		if (!Task_Pop (&t))
+		{
+			Sys_WaitCond (task_wake, task_mutex);
+			continue;
+		}
+
+		Sys_UnlockMutex (task_mutex);
+		t.func (t.arg);
+		Sys_LockMutex (task_mutex);
+
+		Task_Finished ();
+	}
+}
+
+/*
+==================
+Task_Init
+
+-threads <n> sets the number of workers, 0 runs everything on the main
+thread.  By default there is one for each cpu but the first, which the
+main thread keeps busy while it waits
+==================
+*/
+void Task_Init (void)
+{
+	int i, n;
+
+	i = COM_CheckParm ("-threads");
+	if (i && i < com_argc - 1)
+		n = atoi (com_argv[i + 1]);
+	else
+		n = Sys_NumCPUs () - 1;
+
+	if (n > MAX_TASK_THREADS)
+		n = MAX_TASK_THREADS;
+	if (n <= 0)
+		return;
+
+	task_mutex = Sys_CreateMutex ();
+	task_wake = Sys_CreateCond ();
+	task_done = Sys_CreateCond ();
+
+	for (i = 0; i < n; i++)
+		if (Sys_CreateThread (Task_Thread, NULL))
+			task_numthreads++;
+
+	Con_Printf ("%i worker threads\n", task_numthreads);
+}
+
+void Task_Add (taskfunc_t func, void *arg)
+{
+	if (!task_numthreads)
+	{
+		func (arg);
+		return;
+	}
+
+	Sys_LockMutex (task_mutex);
+	if ((task_tail + 1) % MAX_TASKS == task_head)
+	{ // full
+		Sys_UnlockMutex (task_mutex);
+		func (arg);
+		return;
+	}
+
+	task_queue[task_tail].func = func;
+	task_queue[task_tail].arg = arg;
+	task_tail = (task_tail + 1) % MAX_TASKS;
+	task_pending++;
+
+	Sys_SignalCond (task_wake);
+	Sys_UnlockMutex (task_mutex);
+}
+
+bool Task_RunOne (void)
+{
+	task_t t;
+
+	if (!task_numthreads)
+		return false;
+
+	Sys_LockMutex (task_mutex);
+	if (!Task_Pop (&t))
+	{
+		Sys_UnlockMutex (task_mutex);
+		return false;
+	}
+	Sys_UnlockMutex (task_mutex);
+
+	t.func (t.arg);
+
+	Sys_LockMutex (task_mutex);
+	Task_Finished ();
+	Sys_UnlockMutex (task_mutex);
+
+	return true;
+}
+
+void Task_Wait (void)
+{
+	if (!task_numthreads)
+		return;
+
+	while (Task_RunOne ())
+		;
+
+	Sys_LockMutex (task_mutex);
+	while (task_pending)
+		Sys_WaitCond (task_done, task_mutex);
+	Sys_UnlockMutex (task_mutex);
+}
@@ -0,0 +1,20 @@
+#ifndef _TASK_H
+#define _TASK_H
+
+// a pool of worker threads for loading work.  tasks run on any thread,
+// so they must not touch the hunk, the console or any other shared state
+
+typedef void (*taskfunc_t) (void *arg);
+
+void Task_Init (void);
+
+// runs the task on the calling thread if there are no workers
+void Task_Add (taskfunc_t func, void *arg);
+
+// runs one queued task on the calling thread, false if none were queued
+bool Task_RunOne (void);
+
+// helps with the queue, then waits for every task to finish
+void Task_Wait (void);
+
+#endif /* !_TASK_H */
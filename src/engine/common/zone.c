@@ -27,33 +27,156 @@ along with this program.  If not, see <https://www.gnu.org/licenses/>.
 
 ZONE MEMORY ALLOCATION
 
-There is never any space between memblocks, and there will never be two
-contiguous free memblocks.
-
-The rover can be left pointing at a non-empty block
-
 The zone calls are pretty much only used for small strings and structures,
 all big things are allocated on the hunk.
+
+Zone blocks come from malloc with a small header in front, which charges
+them to the source file that allocated them so Z_Print can show where the
+memory goes.  The worker threads allocate too, so the counts are atomic.
 ==============================================================================
 */
 
+#define MAX_ZONE_TAGS 64
+
+typedef struct
+{
+	const char *_Atomic name;
+	atomic_size_t bytes;
+	atomic_int blocks;
+} zonetag_t;
+
+typedef struct
+{
+	size_t size;
+	zonetag_t *tag;
+	max_align_t data[]; // keeps malloc's alignment for the caller
+} zblock_t;
+
+static zonetag_t zone_tags[MAX_ZONE_TAGS];
+
+static zonetag_t *Z_FindTag (const char *name)
+{
+	zonetag_t *tag;
+	const char *found;
+
+	for (tag = zone_tags; tag < zone_tags + MAX_ZONE_TAGS - 1; tag++)
+	{
+		found = atomic_load (&tag->name);
+		if (!found && atomic_compare_exchange_strong (&tag->name, &found, name))
+			return tag;
+
+		// taken, maybe by another thread just now
+		if (found == name || !strcmp (found, name))
+			return tag;
+	}
+
+	// out of tags, the rest share the last one
+	found = NULL;
+	atomic_compare_exchange_strong (&tag->name, &found, "other");
+
+	return tag;
+}
+
+static zblock_t *Z_Block (void *ptr)
+{
+	return (zblock_t *)((byte *)ptr - offsetof (zblock_t, data));
+}
+
 void Z_Free (void *ptr)
 {
-	free (ptr);
+	zblock_t *block;
+
+	if (!ptr)
+		return;
+
+	block = Z_Block (ptr);
+	atomic_fetch_sub (&block->tag->bytes, block->size);
+	atomic_fetch_sub (&block->tag->blocks, 1);
+
+	free (block);
+}
+
+void *Z_TagMalloc (size_t size, const char *tag)
+{
+	zblock_t *block;
+
+	block = malloc (sizeof (zblock_t) + size);
+	if (!block)
+		Sys_Error ("Z_Malloc: failed on %lu bytes", size);
+
+	block->size = size;
+	block->tag = Z_FindTag (tag);
+	atomic_fetch_add (&block->tag->bytes, size);
+	atomic_fetch_add (&block->tag->blocks, 1);
+
+	return block->data;
 }
 
-void *Z_Malloc (size_t size)
+void *Z_TagRealloc (void *ptr, size_t size, const char *tag)
 {
-	return malloc (size);
+	zblock_t *block;
+
+	if (!ptr)
+		return Z_TagMalloc (size, tag);
+
+	// stays charged to whoever allocated it first
+	block = realloc (Z_Block (ptr), sizeof (zblock_t) + size);
+	if (!block)
+		Sys_Error ("Z_Realloc: failed on %lu bytes", size);
+
+	atomic_fetch_add (&block->tag->bytes, size - block->size);
+	block->size = size;
+
+	return block->data;
 }
 
-void *Z_Realloc (void *ptr, size_t size)
+/*
+==============
+Z_Print
+
+Zone usage by the file that allocated it, largest first
+==============
+*/
+void Z_Print (void)
 {
-	return realloc (ptr, size);
+	zonetag_t *sorted[MAX_ZONE_TAGS], *tag;
+	const char *name;
+	size_t total;
+	int i, j, count;
+
+	count = 0;
+	for (i = 0; i < MAX_ZONE_TAGS && atomic_load (&zone_tags[i].name); i++)
+	{
+		tag = &zone_tags[i];
+		for (j = count; j > 0 && atomic_load (&sorted[j - 1]->bytes) < atomic_load (&tag->bytes); j--)
+			sorted[j] = sorted[j - 1];
+		sorted[j] = tag;
+		count++;
+	}
+
+	total = 0;
+	for (i = 0; i < count; i++)
+	{
+		tag = sorted[i];
+		name = strrchr (tag->name, '/');
+		name = name ? name + 1 : tag->name;
+		Con_Printf ("%10lu %6i %s\n", atomic_load (&tag->bytes), atomic_load (&tag->blocks), name);
+		total += atomic_load (&tag->bytes);
+	}
+
+	Con_Printf ("-------------------------\n");
+	Con_Printf ("%10lu total zone bytes\n", total);
 }
 
 #define HUNK_SENTINAL 0x1df001ed
 
+/*
+the hunk is one reserved range of address space, so it stays contiguous, but
+only the chunks under the low and high ends are backed by memory.  chunks
+are mapped as the hunk grows and given back when it is freed to a mark
+*/
+#define HUNK_CHUNK (2 * 1024 * 1024)
+
 typedef struct
 {
 	size_t sentinal;
@@ -70,6 +193,55 @@ static size_t hunk_high_used;
 static bool hunk_tempactive;
 static size_t hunk_tempmark;
 
+static bool *hunk_committed; // per chunk
+static int hunk_numchunks;
+static int hunk_lowchunks = -1, hunk_highchunk = -1;
+static size_t hunk_committedbytes;
+
+/*
+===================
+Hunk_Commit
+
+Maps the chunks under the low and high hunk, and unmaps the ones that are
+no longer used.  A spare chunk is kept past each end, so temp allocations
+going up and down don't map and unmap every time
+===================
+*/
+static void Hunk_Commit (void)
+{
+	int i, low, high;
+	bool used, spare;
+
+	low = (hunk_low_used + HUNK_CHUNK - 1) / HUNK_CHUNK; // chunks the low hunk touches
+	high = (hunk_size - hunk_high_used) / HUNK_CHUNK;	 // first chunk the high hunk touches
+
+	if (low == hunk_lowchunks && high == hunk_highchunk)
+		return;
+
+	for (i = 0; i < hunk_numchunks; i++)
+	{
+		used = i < low || i >= high;
+		spare = i <= low || i >= high - 1;
+
+		if (used && !hunk_committed[i])
+		{
+			if (!Sys_CommitMemory (hunk_base + (size_t)i * HUNK_CHUNK, HUNK_CHUNK))
+				Sys_Error ("Hunk_Commit: out of memory with %lu bytes in use", hunk_committedbytes);
+			hunk_committed[i] = true;
+			hunk_committedbytes += HUNK_CHUNK;
+		}
+		else if (!used && !spare && hunk_committed[i])
+		{
+			Sys_DecommitMemory (hunk_base + (size_t)i * HUNK_CHUNK, HUNK_CHUNK);
+			hunk_committed[i] = false;
+			hunk_committedbytes -= HUNK_CHUNK;
+		}
+	}
+
+	hunk_lowchunks = low;
+	hunk_highchunk = high;
+}
+
 /*
 ==============
 Hunk_Check
@@ -91,24 +263,32 @@ void Hunk_Check (void)
 	}
 }
 
+#define MAX_HUNK_TAGS 256
+
+typedef struct
+{
+	char name[9];
+	size_t bytes;
+	int blocks;
+} hunktag_t;
+
 /*
 ==============
 Hunk_Print
 
 If "all" is specified, every single allocation is printed.
-Otherwise, allocations with the same name will be totaled up before printing.
+Allocations are totaled up by name, then the zone usage is printed.
 ==============
 */
-static void Hunk_Print (bool all)
+void Hunk_Print (bool all)
 {
-	hunk_t *h, *next, *endlow, *starthigh, *endhigh;
-	int count, sum;
-	int totalblocks;
+	hunk_t *h, *endlow, *starthigh, *endhigh;
+	hunktag_t tags[MAX_HUNK_TAGS], tag;
+	int i, j, numtags, totalblocks;
 	char name[9];
 
 	name[8] = 0;
-	count = 0;
-	sum = 0;
+	numtags = 0;
 	totalblocks = 0;
 
 	h = (hunk_t *)hunk_base;
@@ -116,7 +296,8 @@ static void Hunk_Print (bool all)
 	starthigh = (hunk_t *)(hunk_base + hunk_size - hunk_high_used);
 	endhigh = (hunk_t *)(hunk_base + hunk_size);
 
-	Con_Printf ("          :%8lu total hunk size\n", hunk_size);
+	Con_Printf ("          :%10lu reserved hunk size\n", hunk_size);
+	Con_Printf ("          :%10lu mapped\n", hunk_committedbytes);
 	Con_Printf ("-------------------------\n");
 
 	while (1)
@@ -126,9 +307,12 @@ static void Hunk_Print (bool all)
 		//
 		if (h == endlow)
 		{
-			Con_Printf ("-------------------------\n");
-			Con_Printf ("          :%8lu REMAINING\n", hunk_size - hunk_low_used - hunk_high_used);
-			Con_Printf ("-------------------------\n");
+			if (all)
+			{
+				Con_Printf ("-------------------------\n");
+				Con_Printf ("          :%10lu REMAINING\n", hunk_size - hunk_low_used - hunk_high_used);
+				Con_Printf ("-------------------------\n");
+			}
 			h = starthigh;
 		}
 
@@ -146,34 +330,57 @@ static void Hunk_Print (bool all)
 		if (h->size < 16 || h->size + (byte *)h - hunk_base > hunk_size)
 			Sys_Error ("Hunk_Check: bad size");
 
-		next = (hunk_t *)((byte *)h + h->size);
-		count++;
 		totalblocks++;
-		sum += h->size;
 
 		//
 		// print the single block
 		//
 		memcpy (name, h->name, 8);
 		if (all)
-			Con_Printf ("%8p :%8lu %8s\n", h, h->size, name);
+			Con_Printf ("%8p :%10lu %8s\n", h, h->size, name);
 
 		//
-		// print the total
+		// add it to the total for its name
 		//
-		if (next == endlow || next == endhigh || strncmp (h->name, next->name, 8))
+		for (i = 0; i < numtags; i++)
+			if (!strcmp (tags[i].name, name))
+				break;
+		if (i == numtags && numtags < MAX_HUNK_TAGS)
+		{
+			strcpy (tags[i].name, name);
+			tags[i].bytes = 0;
+			tags[i].blocks = 0;
+			numtags++;
+		}
+		if (i < numtags)
 		{
-			if (!all)
-				Con_Printf ("          :%8lu %8s (TOTAL)\n", sum, name);
-			count = 0;
-			sum = 0;
+			tags[i].bytes += h->size;
+			tags[i].blocks++;
 		}
 
-		h = next;
+		h = (hunk_t *)((byte *)h + h->size);
 	}
 
+	// largest first
+	for (i = 1; i < numtags; i++)
+	{
+		tag = tags[i];
+		for (j = i; j > 0 && tags[j - 1].bytes < tag.bytes; j--)
+			tags[j] = tags[j - 1];
+		tags[j] = tag;
+	}
+
+	if (all)
+		Con_Printf ("-------------------------\n");
+	for (i = 0; i < numtags; i++)
+		Con_Printf ("%10lu %6i %8s\n", tags[i].bytes, tags[i].blocks, tags[i].name);
+
 	Con_Printf ("-------------------------\n");
-	Con_Printf ("%8lu total blocks\n", totalblocks);
+	Con_Printf ("%10lu low, %lu high, %lu remaining\n", hunk_low_used, hunk_high_used, hunk_size - hunk_low_used - hunk_high_used);
+	Con_Printf ("%10i total blocks\n", totalblocks);
+	Con_Printf ("-------------------------\n");
+
+	Z_Print ();
 }
 
 void *Hunk_AllocName (size_t size, char *name)
@@ -191,6 +398,8 @@ void *Hunk_AllocName (size_t size, char *name)
 	h = (hunk_t *)(hunk_base + hunk_low_used);
 	hunk_low_used += size;
 
+	Hunk_Commit ();
+
 	memset (h, 0, size);
 
 	h->size = size;
@@ -214,8 +423,11 @@ void Hunk_FreeToLowMark (size_t mark)
 {
 	if (mark < 0 || mark > hunk_low_used)
 		Sys_Error ("Hunk_FreeToLowMark: bad mark %lu", mark);
-	memset (hunk_base + mark, 0, hunk_low_used - mark);
+
+	// allocations are cleared as they are made, so there's no need to
+	// touch the freed memory, most of it is unmapped
 	hunk_low_used = mark;
+	Hunk_Commit ();
 }
 
 size_t Hunk_HighMark (void)
@@ -238,8 +450,9 @@ void Hunk_FreeToHighMark (size_t mark)
 	}
 	if (mark < 0 || mark > hunk_high_used)
 		Sys_Error ("Hunk_FreeToHighMark: bad mark %lu", mark);
-	memset (hunk_base + hunk_size - hunk_high_used, 0, hunk_high_used - mark);
+
 	hunk_high_used = mark;
+	Hunk_Commit ();
 }
 
 void *Hunk_HighAllocName (size_t size, char *name)
@@ -265,6 +478,8 @@ void *Hunk_HighAllocName (size_t size, char *name)
 
 	hunk_high_used += size;
 
+	Hunk_Commit ();
+
 	h = (hunk_t *)(hunk_base + hunk_size - hunk_high_used);
 
 	memset (h, 0, size);
@@ -303,10 +518,137 @@ void *Hunk_TempAlloc (size_t size)
 	return buf;
 }
 
-void Memory_Init (void *buf, size_t size)
+/*
+===================
+Hunk_MoveToZone
+
+Moves everything allocated on the low hunk since mark into one zone block
+and frees it from the hunk.  The blocks keep their distance from each other,
+so offsets between them stay valid.  Returns the new address of the first
+block
+===================
+*/
+void *Hunk_MoveToZone (size_t mark, size_t *size)
+{
+	byte *start, *data;
+
+	if (mark >= hunk_low_used)
+		Sys_Error ("Hunk_MoveToZone: bad mark %lu", mark);
+
+	start = hunk_base + mark + sizeof (hunk_t);
+	*size = hunk_base + hunk_low_used - start;
+
+	data = Z_TagMalloc (*size, "cache");
+	memcpy (data, start, *size);
+
+	Hunk_FreeToLowMark (mark);
+
+	return data;
+}
+
+/*
+==============================================================================
+
+CACHE MEMORY
+
+The owners of cachable objects link them in here once they are loaded, and
+touch them whenever a new level uses them again.  Nothing is ever flushed
+in the middle of a level, Cache_Flush is only called when the level memory
+is cleared, and drops least recently used objects until the rest fit.
+==============================================================================
+*/
+
+static cache_t cache_head = {&cache_head, &cache_head};
+static size_t cache_total;
+static int cache_count;
+
+void Cache_Add (cache_t *c, size_t size, void (*flush) (cache_t *c))
+{
+	c->size = size;
+	c->flush = flush;
+
+	c->next = cache_head.next;
+	c->prev = &cache_head;
+	c->next->prev = c;
+	cache_head.next = c;
+
+	cache_total += size;
+	cache_count++;
+}
+
+void Cache_Remove (cache_t *c)
+{
+	if (!c->next)
+		return;
+
+	c->prev->next = c->next;
+	c->next->prev = c->prev;
+	c->prev = c->next = NULL;
+
+	cache_total -= c->size;
+	cache_count--;
+}
+
+void Cache_Touch (cache_t *c)
+{
+	size_t size = c->size;
+
+	Cache_Remove (c);
+	Cache_Add (c, size, c->flush);
+}
+
+/*
+===================
+Cache_Flush
+
+Throws out the least recently used objects until the total is within budget
+===================
+*/
+void Cache_Flush (size_t budget)
+{
+	cache_t *c;
+	size_t flushed = 0;
+	int count = 0;
+
+	while (cache_total > budget)
+	{
+		c = cache_head.prev;
+		flushed += c->size;
+		count++;
+
+		Cache_Remove (c);
+		c->flush (c);
+	}
+
+	if (count)
+		Con_DPrintf ("flushed %i cached objects, %lu bytes\n", count, flushed);
+}
+
+void Cache_Report (void)
 {
-	hunk_base = buf;
-	hunk_size = size;
+	Con_Printf ("%i cached objects, %4.1f megabytes\n", cache_count, cache_total / (float)(1024 * 1024));
+}
+
+/*
+===================
+Memory_Init
+
+Reserves size bytes of address space for the hunk, nothing is mapped until
+it is allocated
+===================
+*/
+void Memory_Init (size_t size)
+{
+	hunk_size = (size + HUNK_CHUNK - 1) & ~(size_t)(HUNK_CHUNK - 1);
+	hunk_base = Sys_ReserveMemory (hunk_size);
+	if (!hunk_base)
+		Sys_Error ("Memory_Init: couldn't reserve %lu bytes", hunk_size);
+
+	hunk_numchunks = hunk_size / HUNK_CHUNK;
+	hunk_committed = Z_Malloc (hunk_numchunks * sizeof (*hunk_committed));
+	memset (hunk_committed, 0, hunk_numchunks * sizeof (*hunk_committed));
+
 	hunk_low_used = 0;
 	hunk_high_used = 0;
+	Hunk_Commit ();
 }
@@ -7,6 +7,10 @@ contiguous.  Memory can be allocated from either the low or high end in a
 stack fashion.  The only way memory is released is by resetting one of the
 pointers.
 
+The block is only reserved address space, -mem sets how large it can get.
+Memory is mapped in large chunks as either end grows, and given back when
+it is reset, so a server only holds what the current level needs.
+
 Hunk allocations should be given a name, so the Hunk_Print () function
 can display usage.
 
@@ -17,14 +21,16 @@ server allocations when changing to a higher video mode.
 
 
 Z_??? Zone memory functions used for small, dynamic allocations like text
-strings from command input.  There is only about 48K for it, allocated at
-the very bottom of the hunk.
+strings from command input.  Blocks come from malloc, and are counted by the
+source file that allocated them for Z_Print.
 
 Cache_??? Cache memory is for objects that can be dynamically loaded and
 can usefully stay persistant between levels.  The size of the cache
 fluctuates from level to level.
 
-To allocate a cachable object
+To allocate a cachable object, build it on the low hunk, move it into the zone
+with Hunk_MoveToZone and link it with Cache_Add.  Each new level that uses it
+again calls Cache_Touch, the flush function is called when it is thrown out.
 
 
 Temp_??? Temp memory is used for file loading and surface caching.  The size
@@ -67,11 +73,16 @@ Zone block
 #ifndef _ZONE_H
 #define _ZONE_H
 
-void Memory_Init (void *buf, size_t size);
+void Memory_Init (size_t size);
 
+// zone blocks are charged to the file that allocates them
 void Z_Free (void *ptr);
-void *Z_Malloc (size_t size); // returns 0 filled memory
-void *Z_Realloc (void *ptr, size_t size);
+void *Z_TagMalloc (size_t size, const char *tag);
+void *Z_TagRealloc (void *ptr, size_t size, const char *tag);
+void Z_Print (void);
+
+#define Z_Malloc(size) Z_TagMalloc (size, __FILE__)
+#define Z_Realloc(ptr, size) Z_TagRealloc (ptr, size, __FILE__)
 
 void *Hunk_Alloc (size_t size); // returns 0 filled memory
 void *Hunk_AllocName (size_t size, char *name);
@@ -87,5 +98,21 @@ void Hunk_FreeToHighMark (size_t mark);
 void *Hunk_TempAlloc (size_t size);
 
 void Hunk_Check (void);
+void Hunk_Print (bool all);
+
+void *Hunk_MoveToZone (size_t mark, size_t *size);
+
+typedef struct cache_s
+{
+	struct cache_s *prev, *next; // most recently used first, NULL if not linked
+	size_t size;
+	void (*flush) (struct cache_s *c);
+} cache_t;
+
+void Cache_Add (cache_t *c, size_t size, void (*flush) (cache_t *c));
+void Cache_Remove (cache_t *c);
+void Cache_Touch (cache_t *c);
+void Cache_Flush (size_t budget);
+void Cache_Report (void);
 
 #endif /* !_ZONE_H */
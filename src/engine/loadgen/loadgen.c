@@ -0,0 +1,907 @@
+/*
+===========================================================================
+Copyright (C) 1996-1997 Id Software, Inc.
+Copyright (C) 2023-2024 Justin Keller
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <https://www.gnu.org/licenses/>.
+===========================================================================
+*/
+// loadgen.c -- synthetic headless clients for server load testing
+
+/*
+quake-loadgen connects a number of fake players to a server running on the
+same machine and keeps them moving, so server frame costs can be measured
+under a realistic packet load without a room full of real clients.
+
+every simulated client owns its own UDP socket and qport, and talks to the
+server through the engine's own netchan and MSG code.  the connection and
+signon sequence is the one CL_SendConnectPacket and cl_parse.c go through,
+but nothing the server sends is interpreted beyond what is needed to get
+spawned: serverdata, the sound and model lists, and the "cmd" stufftexts.
+
+the world model checksum can't be computed without the map, so either run
+the server with sv_mapcheck 0 or pass the expected value with -mapcheck.
+
+usage: quake-loadgen [-server <address>] [-clients <n>] [-cmdrate <hz>]
+                     [-time <seconds>] [-report <seconds>] [-mapcheck <n>]
+                     [-idle]
+*/
+
+#include <signal.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "clientdef.h"
+#include "serverdef.h"
+
+#define MAX_BOTS 64
+#define BOT_BACKUP 64 // must be a power of two
+#define BOT_MASK (BOT_BACKUP - 1)
+#define BOT_RESEND 1.0	// seconds between challenge / connect retries
+#define BOT_TIMEOUT 10.0 // seconds without a packet before giving up
+
+typedef enum
+{
+	bs_challenging, // waiting for S2C_CHALLENGE
+	bs_connecting,	// waiting for S2C_CONNECTION
+	bs_signon,		// netchan is up, walking the signon commands
+	bs_active,		// spawned and sending moves
+	bs_dropped,		// refused or disconnected by the server
+} botstate_t;
+
+typedef struct
+{
+	int number;
+	int socket;
+	botstate_t state;
+	int qport;
+	int challenge;
+	int spawncount;
+	double resend_time;
+	double next_cmd;
+
+	netchan_t netchan;
+	usercmd_t cmds[BOT_BACKUP];
+	double senttime[BOT_BACKUP];
+	int last_ack;
+
+	// movement
+	float yaw;
+	float turn;
+	double next_turn;
+
+	// statistics
+	double connect_start;
+	double connect_time;
+	double active_start;
+	double rtt_total, rtt_min, rtt_max;
+	uint64_t rtt_count;
+	uint64_t packets_in, packets_out; // 64 bits so long runs don't wrap
+	uint64_t dropped_in;
+	uint64_t bytes_in, bytes_out;
+} bot_t;
+
+quakeparms_t host_parms;
+double host_time;
+client_static_t cls;
+server_t sv;
+
+static bot_t bots[MAX_BOTS];
+static int num_bots;
+static netadr_t server_adr;
+static int cmdrate;
+static int mapcheck;
+static bool idle;
+static volatile sig_atomic_t stop;
+
+/*
+===============================================================================
+
+SYSTEM LAYER
+
+the shared engine objects expect the host, console and file system to be
+present.  the load generator has none of them, so they are reduced to
+printing or failing
+
+===============================================================================
+*/
+
+void Sys_Error (char *error, ...)
+{
+	va_list argptr;
+
+	fprintf (stderr, "Error: ");
+	va_start (argptr, error);
+	vfprintf (stderr, error, argptr);
+	va_end (argptr);
+	fprintf (stderr, "\n");
+
+	exit (1);
+}
+
+void Sys_Printf (char *fmt, ...)
+{
+	va_list argptr;
+
+	va_start (argptr, fmt);
+	vprintf (fmt, argptr);
+	va_end (argptr);
+}
+
+double Sys_FloatTime (void)
+{
+	struct timespec ts;
+	static time_t secbase;
+
+	clock_gettime (CLOCK_MONOTONIC, &ts);
+
+	if (!secbase)
+		secbase = ts.tv_sec;
+
+	return (ts.tv_sec - secbase) + ts.tv_nsec * 1.0e-9;
+}
+
+off_t Sys_FileOpenRead (char *path, int *hndl)
+{
+	*hndl = -1;
+	return -1;
+}
+
+int Sys_FileOpenWrite (char *path)
+{
+	Sys_Error ("Sys_FileOpenWrite: no filesystem in the load generator");
+	return -1;
+}
+
+void Sys_FileClose (int handle)
+{
+}
+
+void Sys_FileSeek (int handle, size_t position)
+{
+}
+
+ssize_t Sys_FileRead (int handle, void *dest, size_t count)
+{
+	return -1;
+}
+
+ssize_t Sys_FileWrite (int handle, void *data, size_t count)
+{
+	return -1;
+}
+
+int Sys_FileTime (char *path)
+{
+	return -1;
+}
+
+void *Sys_FileMap (int handle, size_t size)
+{
+	return NULL;
+}
+
+void Sys_FileUnmap (void *base, size_t size)
+{
+}
+
+void *Sys_ReserveMemory (size_t size)
+{
+	return NULL;
+}
+
+bool Sys_CommitMemory (void *base, size_t size)
+{
+	return false;
+}
+
+void Sys_DecommitMemory (void *base, size_t size)
+{
+}
+
+int Sys_FileOpenTemp (void)
+{
+	return -1;
+}
+
+void *Sys_CreateThread (void (*func) (void *arg), void *arg)
+{
+	return NULL;
+}
+
+void Sys_WaitThread (void *thread)
+{
+}
+
+int Sys_NumCPUs (void)
+{
+	return 1;
+}
+
+void *Sys_CreateMutex (void)
+{
+	return NULL;
+}
+
+void Sys_LockMutex (void *mutex)
+{
+}
+
+void Sys_UnlockMutex (void *mutex)
+{
+}
+
+void *Sys_CreateCond (void)
+{
+	return NULL;
+}
+
+void Sys_WaitCond (void *cond, void *mutex)
+{
+}
+
+void Sys_SignalCond (void *cond)
+{
+}
+
+void Sys_mkdir (char *path)
+{
+}
+
+void Sys_ListDir (char *path, void (*func) (char *name, bool isdir, void *arg), void *arg)
+{
+}
+
+void Con_Printf (char *fmt, ...)
+{
+	va_list argptr;
+
+	va_start (argptr, fmt);
+	vprintf (fmt, argptr);
+	va_end (argptr);
+}
+
+void Con_DPrintf (char *fmt, ...)
+{
+}
+
+void Cmd_AddCommand (cmd_source_e src, char *cmd_name, xcommand_t function)
+{
+}
+
+void Cvar_RegisterVariable (cmd_source_e src, cvar_t *variable)
+{
+	variable->value = atof (variable->string);
+}
+
+void Cvar_SetValue (cmd_source_e src, char *var_name, float value)
+{
+}
+
+void Draw_BeginDisc (void)
+{
+}
+
+bool Host_InitServer (void)
+{
+	return false;
+}
+
+bool Host_IsLocalGame (void)
+{
+	return false;
+}
+
+/*
+===============================================================================
+
+SIMULATED CLIENTS
+
+===============================================================================
+*/
+
+/*
+=================
+Bot_Select
+
+Points the shared client socket at this bot, so NET_GetPacket and
+Netchan_Transmit on CLIENT go through its own port
+=================
+*/
+static void Bot_Select (bot_t *bot)
+{
+	net_socket[CLIENT] = bot->socket;
+}
+
+static void Bot_StringCmd (bot_t *bot, char *fmt, ...)
+{
+	va_list argptr;
+	char string[1024];
+
+	va_start (argptr, fmt);
+	vsnprintf (string, sizeof (string), fmt, argptr);
+	va_end (argptr);
+
+	MSG_WriteByte (&bot->netchan.message, clc_stringcmd);
+	MSG_WriteString (&bot->netchan.message, string);
+}
+
+static void Bot_SendConnectionless (bot_t *bot)
+{
+	char data[2048];
+	char userinfo[MAX_INFO_STRING];
+
+	Bot_Select (bot);
+
+	if (bot->state == bs_challenging)
+	{
+		sprintf (data, "%c%c%c%cgetchallenge\n", 255, 255, 255, 255);
+	}
+	else
+	{
+		snprintf (userinfo, sizeof (userinfo), "\\name\\loadgen%i\\rate\\25000\\topcolor\\%i\\bottomcolor\\%i", bot->number, bot->number & 13,
+				  bot->number & 13);
+		sprintf (data, "%c%c%c%cconnect %i %i %i \"%s\"\n", 255, 255, 255, 255, PROTOCOL_VERSION, bot->qport, bot->challenge, userinfo);
+	}
+
+	NET_SendPacket (CLIENT, strlen (data), data, server_adr);
+	bot->resend_time = host_time + BOT_RESEND;
+}
+
+/*
+=================
+Bot_ConnectionlessPacket
+=================
+*/
+static void Bot_ConnectionlessPacket (bot_t *bot)
+{
+	int c;
+	char *s;
+
+	MSG_BeginReading (CLIENT);
+	MSG_ReadLong (); // skip the -1
+
+	c = MSG_ReadByte ();
+
+	switch (c)
+	{
+	case S2C_CHALLENGE:
+		if (bot->state != bs_challenging)
+			break;
+		bot->challenge = atoi (MSG_ReadString ());
+		bot->state = bs_connecting;
+		Bot_SendConnectionless (bot);
+		break;
+
+	case S2C_CONNECTION:
+		if (bot->state != bs_connecting)
+			break;
+		Netchan_Setup (&bot->netchan, net_from, CLIENT, bot->qport);
+		bot->netchan.ignore_rate = true;
+		Bot_StringCmd (bot, "new");
+		bot->state = bs_signon;
+		bot->last_ack = 0;
+		break;
+
+	case A2C_PRINT:
+		s = MSG_ReadString ();
+		printf ("loadgen%i: %s", bot->number, s);
+		if (bot->state == bs_connecting)
+			bot->state = bs_dropped;
+		break;
+	}
+}
+
+/*
+=================
+Bot_ParseSignon
+
+Answers the signon replies the same way cl_parse.c does.  Only the start of
+a reply is parsed; the rest is searched for the "cmd" stufftexts that move
+the signon along, which the real client would forward to the server
+=================
+*/
+static void Bot_ParseSignon (bot_t *bot)
+{
+	byte *data;
+	int i, start, end, n;
+
+	start = MSG_GetReadCount ();
+
+	switch (MSG_ReadByte ())
+	{
+	case svc_serverdata:
+		MSG_ReadLong (); // PROTOCOL_VERSION
+		MSG_ReadLong (); // game protocol
+		bot->spawncount = MSG_ReadLong ();
+		Bot_StringCmd (bot, "soundlist %i 0", bot->spawncount);
+		break;
+
+	case svc_soundlist:
+	case svc_modellist:
+		n = net_message[CLIENT].data[start];
+		MSG_ReadShort ();
+		while (*MSG_ReadString () && !msg_badread)
+			;
+		i = MSG_ReadShort ();
+		if (msg_badread)
+			break;
+
+		if (n == svc_soundlist)
+		{
+			if (i)
+				Bot_StringCmd (bot, "soundlist %i %i", bot->spawncount, i);
+			else
+				Bot_StringCmd (bot, "modellist %i 0", bot->spawncount);
+		}
+		else
+		{
+			if (i)
+				Bot_StringCmd (bot, "modellist %i %i", bot->spawncount, i);
+			else
+				Bot_StringCmd (bot, "prespawn %i 0 %i", bot->spawncount, mapcheck);
+		}
+		break;
+	}
+
+	data = net_message[CLIENT].data;
+	end = net_message[CLIENT].cursize;
+
+	for (i = start; i < end - 5; i++)
+	{
+		if (data[i] != svc_stufftext)
+			continue;
+
+		if (!memcmp (data + i + 1, "cmd ", 4))
+		{
+			char *s = (char *)data + i + 5;
+			int len = strnlen (s, end - (i + 5));
+
+			if (i + 5 + len >= end)
+				break; // not terminated
+			while (len && s[len - 1] == '\n')
+				len--;
+			Bot_StringCmd (bot, "%.*s", len, s);
+
+			if (!strncmp (s, "begin ", 6) && bot->state == bs_signon)
+			{
+				bot->state = bs_active;
+				bot->active_start = host_time;
+				bot->connect_time = host_time - bot->connect_start;
+			}
+			i += 5 + len;
+		}
+		else if (!memcmp (data + i + 1, "reconnect\n", 11))
+		{
+			// the server changed levels
+			Bot_StringCmd (bot, "new");
+			bot->state = bs_signon;
+			i += 11;
+		}
+	}
+}
+
+/*
+=================
+Bot_ReadPackets
+=================
+*/
+static void Bot_ReadPackets (bot_t *bot)
+{
+	int ack;
+	double rtt;
+
+	Bot_Select (bot);
+
+	while (NET_GetPacket (CLIENT))
+	{
+		if (!NET_CompareAdr (net_from, server_adr))
+			continue;
+
+		if (*(int *)net_message[CLIENT].data == -1)
+		{
+			Bot_ConnectionlessPacket (bot);
+			continue;
+		}
+
+		if (bot->state < bs_signon || bot->state == bs_dropped)
+			continue;
+
+		if (!Netchan_Process (&bot->netchan))
+			continue; // wasn't accepted for some reason
+
+		bot->packets_in++;
+		bot->bytes_in += net_message[CLIENT].cursize;
+		if (net_drop > 0)
+			bot->dropped_in += net_drop;
+
+		// round trip time of every newly acknowledged command
+		ack = bot->netchan.incoming_acknowledged;
+		if (ack > bot->last_ack && bot->netchan.outgoing_sequence - ack < BOT_BACKUP)
+		{
+			rtt = host_time - bot->senttime[ack & BOT_MASK];
+			bot->rtt_total += rtt;
+			if (!bot->rtt_count || rtt < bot->rtt_min)
+				bot->rtt_min = rtt;
+			if (rtt > bot->rtt_max)
+				bot->rtt_max = rtt;
+			bot->rtt_count++;
+		}
+		bot->last_ack = ack;
+
+		Bot_ParseSignon (bot);
+	}
+}
+
+/*
+=================
+Bot_BuildCmd
+
+Random wandering: keep running while slowly turning, with the odd
+jump and attack.  -idle sends empty commands instead
+=================
+*/
+static void Bot_BuildCmd (bot_t *bot, usercmd_t *cmd)
+{
+	memset (cmd, 0, sizeof (*cmd));
+
+	cmd->msec = 1000 / cmdrate;
+	if (cmd->msec < 1)
+		cmd->msec = 1;
+	else if (cmd->msec > 250)
+		cmd->msec = 250;
+
+	if (idle || bot->state != bs_active)
+		return;
+
+	if (host_time > bot->next_turn)
+	{
+		bot->turn = (rand () % 361) - 180;
+		bot->next_turn = host_time + 0.5 + (rand () % 2000) * 0.001;
+	}
+
+	bot->yaw = anglemod (bot->yaw + bot->turn * cmd->msec * 0.001);
+	cmd->angles[YAW] = bot->yaw;
+	cmd->forwardmove = 320;
+	cmd->sidemove = (rand () % 3 - 1) * 100;
+
+	if (!(rand () % 50))
+		cmd->buttons |= 2; // jump
+	if (!(rand () % 20))
+		cmd->buttons |= 1; // attack
+}
+
+/*
+=================
+Bot_SendCmd
+
+Same framing as CL_SendCmd: the loss byte and the last three commands,
+so a dropped packet can be recovered from the next one
+=================
+*/
+static void Bot_SendCmd (bot_t *bot)
+{
+	sizebuf_t buf;
+	byte data[128];
+	int i, lost;
+	usercmd_t *cmd, *oldcmd;
+
+	Bot_Select (bot);
+
+	i = bot->netchan.outgoing_sequence & BOT_MASK;
+	cmd = &bot->cmds[i];
+	bot->senttime[i] = host_time;
+	Bot_BuildCmd (bot, cmd);
+
+	buf.maxsize = sizeof (data);
+	buf.cursize = 0;
+	buf.data = data;
+
+	MSG_WriteByte (&buf, clc_move);
+
+	lost = bot->packets_in ? bot->dropped_in * 100 / (bot->packets_in + bot->dropped_in) : 0;
+	MSG_WriteByte (&buf, lost);
+
+	i = (bot->netchan.outgoing_sequence - 2) & BOT_MASK;
+	cmd = &bot->cmds[i];
+	MSG_WriteDeltaUsercmd (&buf, &nullcmd, cmd);
+	oldcmd = cmd;
+
+	i = (bot->netchan.outgoing_sequence - 1) & BOT_MASK;
+	cmd = &bot->cmds[i];
+	MSG_WriteDeltaUsercmd (&buf, oldcmd, cmd);
+	oldcmd = cmd;
+
+	i = bot->netchan.outgoing_sequence & BOT_MASK;
+	cmd = &bot->cmds[i];
+	MSG_WriteDeltaUsercmd (&buf, oldcmd, cmd);
+
+	Netchan_Transmit (&bot->netchan, buf.cursize, buf.data);
+
+	bot->packets_out++;
+	bot->bytes_out += bot->netchan.outgoing_size[bot->netchan.outgoing_sequence & (MAX_LATENT - 1)];
+
+	if (bot->netchan.fatal_error)
+	{
+		printf ("loadgen%i: netchan overflow\n", bot->number);
+		bot->state = bs_dropped;
+	}
+}
+
+static void Bot_Frame (bot_t *bot)
+{
+	Bot_ReadPackets (bot);
+
+	switch (bot->state)
+	{
+	case bs_challenging:
+	case bs_connecting:
+		if (host_time > bot->resend_time)
+			Bot_SendConnectionless (bot);
+		break;
+
+	case bs_signon:
+	case bs_active:
+		// svc_disconnect isn't parsed out, so a dropped client just goes quiet
+		if (host_time - bot->netchan.last_received > BOT_TIMEOUT)
+		{
+			printf ("loadgen%i: server timed out\n", bot->number);
+			bot->state = bs_dropped;
+			break;
+		}
+		if (host_time >= bot->next_cmd)
+		{
+			Bot_SendCmd (bot);
+			bot->next_cmd += 1.0 / cmdrate;
+			if (bot->next_cmd < host_time)
+				bot->next_cmd = host_time;
+		}
+		break;
+
+	case bs_dropped:
+		break;
+	}
+}
+
+static void Bot_Disconnect (bot_t *bot)
+{
+	int i;
+
+	if (bot->state != bs_signon && bot->state != bs_active)
+		return;
+
+	Bot_Select (bot);
+
+	// send the drop three times like CL_Disconnect, since it isn't reliable
+	SZ_Clear (&bot->netchan.message);
+	for (i = 0; i < 3; i++)
+	{
+		byte final[10];
+
+		final[0] = clc_stringcmd;
+		strcpy ((char *)final + 1, "drop");
+		Netchan_Transmit (&bot->netchan, 6, final);
+	}
+}
+
+/*
+===============================================================================
+
+REPORTING
+
+===============================================================================
+*/
+
+static char *Bot_StateName (botstate_t state)
+{
+	switch (state)
+	{
+	case bs_challenging:
+		return "challenge";
+	case bs_connecting:
+		return "connect";
+	case bs_signon:
+		return "signon";
+	case bs_active:
+		return "active";
+	default:
+		return "dropped";
+	}
+}
+
+static double Bot_Loss (bot_t *bot)
+{
+	uint64_t total = bot->packets_in + bot->dropped_in;
+
+	return total ? bot->dropped_in * 100.0 / total : 0;
+}
+
+static void LG_Report (double elapsed, double interval)
+{
+	static uint64_t last_in, last_out;
+	uint64_t bytes_in, bytes_out, dropped, received, rtt_count;
+	int i, active;
+	double rtt_total;
+	bot_t *bot;
+
+	active = bytes_in = bytes_out = dropped = received = rtt_count = 0;
+	rtt_total = 0;
+
+	for (i = 0, bot = bots; i < num_bots; i++, bot++)
+	{
+		if (bot->state == bs_active)
+			active++;
+		bytes_in += bot->bytes_in;
+		bytes_out += bot->bytes_out;
+		dropped += bot->dropped_in;
+		received += bot->packets_in;
+		rtt_total += bot->rtt_total;
+		rtt_count += bot->rtt_count;
+	}
+
+	printf ("%6.1fs  %2i/%2i active  in %7.1f kB/s  out %6.1f kB/s  rtt %6.1f ms  loss %5.2f%%\n", elapsed, active, num_bots,
+			(double)(bytes_in - last_in) / interval / 1024.0, (double)(bytes_out - last_out) / interval / 1024.0, rtt_count ? rtt_total / rtt_count * 1000.0 : 0.0,
+			received + dropped ? dropped * 100.0 / (received + dropped) : 0.0);
+
+	last_in = bytes_in;
+	last_out = bytes_out;
+}
+
+static void LG_Summary (void)
+{
+	int i;
+	double t;
+	bot_t *bot;
+	unsigned long long packets_in, packets_out, bytes_in, bytes_out;
+
+	printf ("\nclient     state      signon  rtt min/avg/max (ms)     loss   in B/s  out B/s\n");
+	printf ("---------- --------- -------  ---------------------  ------  -------  -------\n");
+
+	for (i = 0, bot = bots; i < num_bots; i++, bot++)
+	{
+		t = bot->active_start ? host_time - bot->active_start : 0;
+
+		printf ("loadgen%-3i %-9s %6.2fs  %6.1f %6.1f %6.1f  %5.2f%%  %7.0f  %7.0f\n", bot->number, Bot_StateName (bot->state), bot->connect_time,
+				bot->rtt_min * 1000.0, bot->rtt_count ? bot->rtt_total / bot->rtt_count * 1000.0 : 0.0, bot->rtt_max * 1000.0, Bot_Loss (bot),
+				t > 0 ? bot->bytes_in / t : 0.0, t > 0 ? bot->bytes_out / t : 0.0);
+	}
+
+	packets_in = packets_out = bytes_in = bytes_out = 0;
+	for (i = 0, bot = bots; i < num_bots; i++, bot++)
+	{
+		packets_in += bot->packets_in;
+		packets_out += bot->packets_out;
+		bytes_in += bot->bytes_in;
+		bytes_out += bot->bytes_out;
+	}
+
+	printf ("\ntotal: %llu packets / %llu bytes in, %llu packets / %llu bytes out\n", packets_in, bytes_in, packets_out, bytes_out);
+}
+
+/*
+===============================================================================
+
+MAIN
+
+===============================================================================
+*/
+
+static void LG_Signal (int sig)
+{
+	stop = 1;
+}
+
+static int LG_IntParm (char *parm, int def)
+{
+	int i = COM_CheckParm (parm);
+
+	if (i && i < com_argc - 1)
+		return atoi (com_argv[i + 1]);
+	return def;
+}
+
+int main (int argc, char **argv)
+{
+	int i, duration, report;
+	char *server;
+	double start, next_report, last_report;
+	bot_t *bot;
+
+	COM_InitArgv (argc, argv);
+	host_parms.argc = com_argc;
+	host_parms.argv = com_argv;
+
+	i = COM_CheckParm ("-server");
+	server = (i && i < com_argc - 1) ? com_argv[i + 1] : "localhost";
+
+	num_bots = LG_IntParm ("-clients", 8);
+	if (num_bots < 1 || num_bots > MAX_BOTS)
+		Sys_Error ("-clients must be between 1 and %i", MAX_BOTS);
+	cmdrate = LG_IntParm ("-cmdrate", 72);
+	if (cmdrate < 1 || cmdrate > 1000)
+		Sys_Error ("-cmdrate must be between 1 and 1000");
+	duration = LG_IntParm ("-time", 0);
+	report = LG_IntParm ("-report", 5);
+	if (report < 1)
+		report = 1;
+	mapcheck = LG_IntParm ("-mapcheck", 0);
+	idle = COM_CheckParm ("-idle") != 0;
+
+	if (!NET_StringToAdr (server, &server_adr))
+		Sys_Error ("Bad server address %s", server);
+	if (!server_adr.port)
+		server_adr.port = PORT_SERVER;
+
+	// this floods the server on purpose, so never point it at someone else's
+	if (!NET_IsLocalHost (&server_adr))
+		Sys_Error ("quake-loadgen only targets servers on localhost");
+
+	signal (SIGINT, LG_Signal);
+	signal (SIGTERM, LG_Signal);
+
+	NET_Init ();
+	Netchan_Init ();
+
+	host_time = Sys_FloatTime ();
+	srand (time (NULL));
+
+	for (i = 0, bot = bots; i < num_bots; i++, bot++)
+	{
+		net_socket[CLIENT] = 0;
+		if (!NET_Open (CLIENT, PORT_ANY))
+			Sys_Error ("Couldn't open a socket for client %i", i);
+
+		bot->number = i;
+		bot->socket = net_socket[CLIENT];
+		bot->qport = (rand () & 0x7f00) | i;
+		bot->state = bs_challenging;
+		bot->connect_start = host_time;
+		bot->next_cmd = host_time + i * (1.0 / cmdrate) / num_bots; // spread the sends out
+		bot->yaw = rand () % 360;
+
+		Bot_SendConnectionless (bot);
+	}
+
+	printf ("%i clients -> %s at %i cmds/s\n", num_bots, server, cmdrate);
+
+	start = last_report = host_time;
+	next_report = start + report;
+
+	while (!stop)
+	{
+		host_time = Sys_FloatTime ();
+
+		for (i = 0; i < num_bots; i++)
+			Bot_Frame (&bots[i]);
+
+		if (host_time >= next_report)
+		{
+			LG_Report (host_time - start, host_time - last_report);
+			last_report = host_time;
+			next_report += report;
+		}
+
+		if (duration && host_time - start >= duration)
+			break;
+
+		usleep (1000);
+	}
+
+	for (i = 0; i < num_bots; i++)
+		Bot_Disconnect (&bots[i]);
+
+	LG_Summary ();
+
+	return 0;
+}
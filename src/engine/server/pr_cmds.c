@@ -1232,7 +1232,7 @@ static void PF_aim (progs_state_t *pr)
 	i = ED_ForNum (ent);
 	if (i > 0 && i < MAX_CLIENTS)
 	{
-		noaim = Info_ValueForKey (svs.clients[i - 1].userinfo, "noaim");
+		noaim = Info_Get (&svs.clients[i - 1].userinfo, "noaim");
 		if (atoi (noaim) > 0)
 		{
 			VectorCopy (pr_vector (pr, v_forward), pr_global_ptr (pr, float, OFS_RETURN));
@@ -1607,10 +1607,7 @@ static void PF_logfrag (progs_state_t *pr)
 
 	SZ_Print (&svs.log[svs.logsequence & 1], s);
 	if (sv_fraglogfile)
-	{
-		fprintf (sv_fraglogfile, "%s", s);
-		fflush (sv_fraglogfile);
-	}
+		Log_Write (LOG_FRAGS, s);
 }
 
 /*
@@ -1632,9 +1629,9 @@ static void PF_infokey (progs_state_t *pr)
 
 	if (e1 == 0)
 	{
-		strcpy (pr_string_temp, Info_ValueForKey (svs.info, key));
+		strcpy (pr_string_temp, Info_Get (&svs.info, key));
 		if (pr_string_temp[0] == '\0')
-			strcpy (pr_string_temp, Info_ValueForKey (localinfo, key));
+			strcpy (pr_string_temp, Info_Get (&localinfo, key));
 	}
 	else if (e1 <= MAX_CLIENTS)
 	{
@@ -1649,7 +1646,7 @@ static void PF_infokey (progs_state_t *pr)
 		}
 		else
 		{
-			strcpy (pr_string_temp, Info_ValueForKey (svs.clients[e1 - 1].userinfo, key));
+			strcpy (pr_string_temp, Info_Get (&svs.clients[e1 - 1].userinfo, key));
 		}
 	}
 	else
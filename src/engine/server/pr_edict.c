@@ -592,6 +592,529 @@ char *ED_ParseEdict (char *data, edict_t *ent)
 	return data;
 }
 
+/*
+==============================================================================
+
+BINARY SNAPSHOTS
+
+the edict fields are written as raw blocks, with a map of the field names so
+a snapshot from different progs can still be matched up by name.  strings,
+functions and fields are replaced with references into a string table and
+entities with their numbers, everything else is copied as is
+==============================================================================
+*/
+
+#define SNAPSHOT_VERSION 1
+
+#define SNAP_ENGINESTRING -1 // string table tags, progs strings keep their offset
+#define SNAP_FUNCTION -2
+#define SNAP_FIELD -3
+
+typedef struct
+{
+	int version;
+	int entityfields;
+	int numfields;
+	int numglobals;
+	int numedicts;
+	int stringsize;
+} snapheader_t;
+
+typedef struct
+{
+	int type;
+	int ofs;
+	int name; // string table reference
+} snapdef_t;
+
+typedef struct
+{
+	byte *data;
+	size_t len, size;
+} snapbuf_t;
+
+typedef struct
+{
+	snapbuf_t strings;
+	int *hash; // string table offsets + 1
+	int hashsize, count;
+} snapwriter_t;
+
+static void Snap_Write (snapbuf_t *buf, void *data, size_t len)
+{
+	if (buf->len + len > buf->size)
+	{
+		buf->size = (buf->len + len) * 2 + 4096;
+		buf->data = Z_Realloc (buf->data, buf->size);
+	}
+	memcpy (buf->data + buf->len, data, len);
+	buf->len += len;
+}
+
+static void Snap_WriteInt (snapbuf_t *buf, int i)
+{
+	Snap_Write (buf, &i, sizeof (i));
+}
+
+static unsigned Snap_Hash (int tag, char *s)
+{
+	return COM_HashName (s) ^ (unsigned)tag * 0x9e3779b1;
+}
+
+static char *Snap_EntryText (byte *entry)
+{
+	return (char *)entry + sizeof (int);
+}
+
+static int Snap_EntryTag (byte *entry)
+{
+	int tag;
+
+	memcpy (&tag, entry, sizeof (tag));
+	return tag;
+}
+
+/*
+============
+Snap_AddString
+
+Returns the string table reference for the text, each text and tag is only
+stored once
+============
+*/
+static int Snap_AddString (snapwriter_t *w, int tag, char *s)
+{
+	int i, ofs, *oldhash, oldsize;
+	byte *entry;
+
+	if (w->count * 2 >= w->hashsize)
+	{
+		oldhash = w->hash;
+		oldsize = w->hashsize;
+		w->hashsize = w->hashsize ? w->hashsize * 2 : 1024;
+		w->hash = Z_Malloc (w->hashsize * sizeof (*w->hash));
+		memset (w->hash, 0, w->hashsize * sizeof (*w->hash));
+
+		for (i = 0; i < oldsize; i++)
+		{
+			if (!oldhash[i])
+				continue;
+			entry = w->strings.data + oldhash[i] - 1;
+			ofs = Snap_Hash (Snap_EntryTag (entry), Snap_EntryText (entry)) & (w->hashsize - 1);
+			while (w->hash[ofs])
+				ofs = (ofs + 1) & (w->hashsize - 1);
+			w->hash[ofs] = oldhash[i];
+		}
+		Z_Free (oldhash);
+	}
+
+	for (i = Snap_Hash (tag, s) & (w->hashsize - 1); w->hash[i]; i = (i + 1) & (w->hashsize - 1))
+	{
+		entry = w->strings.data + w->hash[i] - 1;
+		if (Snap_EntryTag (entry) == tag && !strcmp (Snap_EntryText (entry), s))
+			return w->hash[i];
+	}
+
+	w->hash[i] = w->strings.len + 1;
+	w->count++;
+
+	Snap_WriteInt (&w->strings, tag);
+	Snap_Write (&w->strings, s, strlen (s) + 1);
+
+	return w->hash[i];
+}
+
+// turns a field or global value into its snapshot form
+static void Snap_PackValue (snapwriter_t *w, int type, int32_t *v, int32_t *out)
+{
+	ddef_t *def;
+	int size;
+
+	size = pr_type_size[type];
+	memcpy (out, v, size * sizeof (*v));
+
+	switch (type)
+	{
+	case ev_string:
+		if (*v)
+			*out = Snap_AddString (w, *v > 0 ? *v : SNAP_ENGINESTRING, PR_GetString (&sv.pr, *v));
+		break;
+	case ev_function:
+		if (*v > 0 && *v < sv.pr.progs->numfunctions)
+			*out = Snap_AddString (w, SNAP_FUNCTION, PR_GetString (&sv.pr, sv.pr.functions[*v].s_name));
+		else
+			*out = 0;
+		break;
+	case ev_field:
+		def = PR_FieldAtOfs (&sv.pr, *v);
+		*out = def ? Snap_AddString (w, SNAP_FIELD, PR_GetString (&sv.pr, def->s_name)) : 0;
+		break;
+	case ev_entity:
+		*out = *v / sv.pr.edict_size;
+		break;
+	}
+}
+
+// fields worth saving, vectors are saved whole so their _x, _y and _z are not
+static bool Snap_SavedField (ddef_t *d)
+{
+	char *name;
+
+	name = PR_GetString (&sv.pr, d->s_name);
+	return strlen (name) < 2 || name[strlen (name) - 2] != '_';
+}
+
+static bool Snap_SavedGlobal (ddef_t *d)
+{
+	int type;
+
+	if (!(d->type & DEF_SAVEGLOBAL))
+		return false;
+	type = d->type & ~DEF_SAVEGLOBAL;
+	return type == ev_string || type == ev_float || type == ev_entity;
+}
+
+/*
+============
+ED_WriteSnapshot
+
+Copies the globals and edicts into a Z_Malloc'd buffer, which the caller
+frees.  Nothing in it points back into the server, so it can be written out
+from another thread
+============
+*/
+byte *ED_WriteSnapshot (size_t *len)
+{
+	snapwriter_t w;
+	snapbuf_t buf, fields;
+	snapheader_t header;
+	snapdef_t sd;
+	ddef_t *d;
+	edict_t *ent;
+	int32_t *v, *out, value[3];
+	int i, j, type, entityfields;
+	int *refs, numrefs;
+	byte *data;
+
+	memset (&w, 0, sizeof (w));
+	memset (&buf, 0, sizeof (buf));
+	memset (&fields, 0, sizeof (fields));
+
+	entityfields = sv.pr.progs->entityfields;
+
+	header.version = SNAPSHOT_VERSION;
+	header.entityfields = entityfields;
+	header.numfields = 0;
+	header.numglobals = 0;
+	header.numedicts = sv.num_edicts;
+
+	// field map, the fields that need packing are kept in refs
+	refs = Z_Malloc (sv.pr.progs->numfielddefs * sizeof (*refs));
+	numrefs = 0;
+	for (i = 1; i < sv.pr.progs->numfielddefs; i++)
+	{
+		d = &sv.pr.fielddefs[i];
+		if (!Snap_SavedField (d))
+			continue;
+
+		sd.type = d->type & ~DEF_SAVEGLOBAL;
+		sd.ofs = d->ofs;
+		sd.name = Snap_AddString (&w, SNAP_FIELD, PR_GetString (&sv.pr, d->s_name));
+		Snap_Write (&fields, &sd, sizeof (sd));
+		header.numfields++;
+
+		if (sd.type == ev_string || sd.type == ev_function || sd.type == ev_field || sd.type == ev_entity)
+			refs[numrefs++] = i;
+	}
+
+	// globals
+	for (i = 0; i < sv.pr.progs->numglobaldefs; i++)
+	{
+		d = &sv.pr.globaldefs[i];
+		if (!Snap_SavedGlobal (d))
+			continue;
+
+		sd.type = d->type & ~DEF_SAVEGLOBAL;
+		sd.ofs = d->ofs;
+		sd.name = Snap_AddString (&w, SNAP_FIELD, PR_GetString (&sv.pr, d->s_name));
+		Snap_PackValue (&w, sd.type, (int32_t *)&sv.pr.globals[d->ofs], value);
+		Snap_Write (&buf, &sd, sizeof (sd));
+		Snap_Write (&buf, value, pr_type_size[sd.type] * sizeof (int32_t));
+		header.numglobals++;
+	}
+
+	// edicts, copied whole and then patched
+	for (i = 0; i < sv.num_edicts; i++)
+	{
+		ent = ED_GetNum (i);
+		Snap_WriteInt (&buf, ent->free);
+		if (ent->free)
+			continue;
+
+		Snap_Write (&buf, ent + 1, entityfields * sizeof (int32_t));
+		out = (int32_t *)(buf.data + buf.len) - entityfields;
+		for (j = 0; j < numrefs; j++)
+		{
+			d = &sv.pr.fielddefs[refs[j]];
+			type = d->type & ~DEF_SAVEGLOBAL;
+			v = (int32_t *)(ent + 1) + d->ofs;
+			Snap_PackValue (&w, type, v, out + d->ofs);
+		}
+	}
+
+	header.stringsize = w.strings.len;
+
+	*len = sizeof (header) + fields.len + buf.len + w.strings.len;
+	data = Z_Malloc (*len);
+	memcpy (data, &header, sizeof (header));
+	memcpy (data + sizeof (header), fields.data, fields.len);
+	memcpy (data + sizeof (header) + fields.len, buf.data, buf.len);
+	memcpy (data + sizeof (header) + fields.len + buf.len, w.strings.data, w.strings.len);
+
+	Z_Free (refs);
+	Z_Free (w.hash);
+	Z_Free (w.strings.data);
+	Z_Free (fields.data);
+	Z_Free (buf.data);
+
+	return data;
+}
+
+typedef struct
+{
+	byte *data, *end;
+	byte *strings;
+	int stringsize;
+	int *resolved;	// string table offset -> value
+	byte *looked;	// set once resolved holds the value, even a failed 0
+} snapreader_t;
+
+static void *Snap_Read (snapreader_t *r, size_t len)
+{
+	byte *p;
+
+	if (len > (size_t)(r->end - r->data))
+		Host_Error ("ED_ReadSnapshot: snapshot is truncated");
+	p = r->data;
+	r->data += len;
+	return p;
+}
+
+static int Snap_ReadInt (snapreader_t *r)
+{
+	int i;
+
+	memcpy (&i, Snap_Read (r, sizeof (i)), sizeof (i));
+	return i;
+}
+
+static char *Snap_String (snapreader_t *r, int ref)
+{
+	if (ref < 1 || ref > r->stringsize - (int)sizeof (int))
+		Host_Error ("ED_ReadSnapshot: bad string reference %i", ref);
+	return Snap_EntryText (r->strings + ref - 1);
+}
+
+/*
+============
+Snap_Resolve
+
+Turns a string table reference back into a progs value.  each entry is looked
+up once, so a string shared by many edicts is only allocated once
+============
+*/
+static int Snap_Resolve (snapreader_t *r, int ref)
+{
+	int tag, value;
+	char *s, *p;
+	dfunction_t *f;
+	ddef_t *d;
+
+	s = Snap_String (r, ref);
+	if (r->looked[ref - 1])
+		return r->resolved[ref - 1];
+
+	tag = Snap_EntryTag (r->strings + ref - 1);
+	value = 0;
+	if (tag == SNAP_FUNCTION)
+	{
+		f = PR_FindFunction (&sv.pr, s);
+		if (f)
+			value = f - sv.pr.functions;
+		else
+			Con_Printf ("Can't find function %s\n", s);
+	}
+	else if (tag == SNAP_FIELD)
+	{
+		d = PR_FindField (&sv.pr, s);
+		if (d)
+			value = d->ofs;
+		else
+			Con_Printf ("Can't find field %s\n", s);
+	}
+	else if (tag >= 0 && tag < sv.pr.progs->numstrings && !strcmp (sv.pr.strings + tag, s))
+		value = tag; // still in the progs string table
+	else
+	{
+		value = PR_AllocString (&sv.pr, strlen (s) + 1, &p);
+		strcpy (p, s);
+	}
+
+	r->resolved[ref - 1] = value;
+	r->looked[ref - 1] = true;
+	return value;
+}
+
+static void Snap_UnpackValue (snapreader_t *r, int type, int32_t *v)
+{
+	switch (type)
+	{
+	case ev_string:
+	case ev_function:
+	case ev_field:
+		if (*v)
+			*v = Snap_Resolve (r, *v);
+		break;
+	case ev_entity:
+		if (*v < 0 || *v >= sv.max_edicts)
+			Host_Error ("ED_ReadSnapshot: bad entity %i", *v);
+		*v = EDICT_TO_PROG (ED_GetNum (*v));
+		break;
+	}
+}
+
+/*
+============
+ED_ReadSnapshot
+
+Loads the globals and edicts from ED_WriteSnapshot output into the current
+server.  if the progs have the same fields in the same place the edicts are
+copied whole, otherwise field by field where the names and types match
+============
+*/
+void ED_ReadSnapshot (byte *data, size_t len)
+{
+	snapreader_t r;
+	snapheader_t header;
+	snapdef_t *saved, sd;
+	ddef_t *d, **map;
+	edict_t *ent;
+	int32_t *v, value[3];
+	byte *block;
+	int i, j, type, numfields;
+	bool same;
+
+	r.data = data;
+	r.end = data + len;
+	memcpy (&header, Snap_Read (&r, sizeof (header)), sizeof (header));
+	if (header.version != SNAPSHOT_VERSION)
+		Host_Error ("ED_ReadSnapshot: snapshot is version %i, not %i", header.version, SNAPSHOT_VERSION);
+	if (header.numedicts < 1 || header.numedicts > sv.max_edicts)
+		Host_Error ("ED_ReadSnapshot: %i edicts", header.numedicts);
+	if (header.numfields < 0 || header.numglobals < 0 || header.entityfields < 0 || header.stringsize < 0 || (size_t)header.stringsize > len)
+		Host_Error ("ED_ReadSnapshot: bad header");
+
+	r.strings = r.end - header.stringsize;
+	r.stringsize = header.stringsize;
+	r.end = r.strings;
+	if (r.stringsize && r.strings[r.stringsize - 1])
+		Host_Error ("ED_ReadSnapshot: bad string table");
+	r.resolved = Z_Malloc (r.stringsize * (sizeof (int) + 1) + 1);
+	memset (r.resolved, 0, r.stringsize * (sizeof (int) + 1) + 1);
+	r.looked = (byte *)(r.resolved + r.stringsize);
+
+	// match the saved fields up with the current progs
+	block = Snap_Read (&r, header.numfields * sizeof (*saved));
+	saved = Z_Malloc (header.numfields * sizeof (*saved) + 1);
+	memcpy (saved, block, header.numfields * sizeof (*saved));
+	map = Z_Malloc (header.numfields * sizeof (*map) + 1);
+
+	numfields = 0;
+	for (i = 1; i < sv.pr.progs->numfielddefs; i++)
+		if (Snap_SavedField (&sv.pr.fielddefs[i]))
+			numfields++;
+	same = numfields == header.numfields && header.entityfields == sv.pr.progs->entityfields;
+
+	for (i = 0; i < header.numfields; i++)
+	{
+		if (saved[i].type < 0 || saved[i].type >= ev_types || saved[i].ofs < 0 || saved[i].ofs + pr_type_size[saved[i].type] > header.entityfields)
+			Host_Error ("ED_ReadSnapshot: bad field");
+
+		d = PR_FindField (&sv.pr, Snap_String (&r, saved[i].name));
+		if (d && (d->type & ~DEF_SAVEGLOBAL) != saved[i].type)
+		{
+			Con_Printf ("field %s changed type\n", Snap_String (&r, saved[i].name));
+			d = NULL;
+		}
+		if (!d || d->ofs != saved[i].ofs)
+			same = false;
+		map[i] = d;
+	}
+
+	// globals
+	for (i = 0; i < header.numglobals; i++)
+	{
+		memcpy (&sd, Snap_Read (&r, sizeof (sd)), sizeof (sd));
+		if (sd.type != ev_string && sd.type != ev_float && sd.type != ev_entity)
+			Host_Error ("ED_ReadSnapshot: bad global");
+		memcpy (value, Snap_Read (&r, sizeof (int32_t)), sizeof (int32_t));
+
+		d = PR_FindGlobal (&sv.pr, Snap_String (&r, sd.name));
+		if (!d)
+		{
+			Con_Printf ("'%s' is not a global\n", Snap_String (&r, sd.name));
+			continue;
+		}
+		if ((d->type & ~DEF_SAVEGLOBAL) != sd.type)
+		{
+			Con_Printf ("global %s changed type\n", Snap_String (&r, sd.name));
+			continue;
+		}
+
+		Snap_UnpackValue (&r, sd.type, value);
+		memcpy (&sv.pr.globals[d->ofs], value, sizeof (int32_t));
+	}
+
+	if (!same)
+		Con_DPrintf ("progs fields differ from the savegame, matching by name\n");
+
+	// edicts
+	for (i = 0; i < header.numedicts; i++)
+	{
+		ent = ED_GetNum (i);
+		ED_ClearEdict (ent);
+		if (Snap_ReadInt (&r))
+		{
+			ent->free = true;
+			continue;
+		}
+
+		block = Snap_Read (&r, header.entityfields * sizeof (int32_t));
+		if (same)
+			memcpy (ent + 1, block, header.entityfields * sizeof (int32_t));
+
+		for (j = 0; j < header.numfields; j++)
+		{
+			if (!map[j])
+				continue;
+
+			type = saved[j].type;
+			v = (int32_t *)(ent + 1) + map[j]->ofs;
+			if (!same)
+				memcpy (v, block + saved[j].ofs * sizeof (int32_t), pr_type_size[type] * sizeof (int32_t));
+			Snap_UnpackValue (&r, type, v);
+		}
+
+		SV_LinkEdict (ent, false);
+	}
+
+	sv.num_edicts = header.numedicts;
+
+	Z_Free (map);
+	Z_Free (saved);
+	Z_Free (r.resolved);
+}
+
 /*
 ================
 ED_LoadFromFile
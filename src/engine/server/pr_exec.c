@@ -277,6 +277,7 @@ void PR_ExecuteProgram (progs_state_t *pr, func_t fnum)
 	edict_t *ed;
 	int exitdepth;
 	eval_t *ptr;
+	double start;
 
 	if (!fnum || fnum >= pr->progs->numfunctions)
 	{
@@ -293,6 +294,9 @@ void PR_ExecuteProgram (progs_state_t *pr, func_t fnum)
 	// make a stack frame
 	exitdepth = pr_depth;
 
+	// builtins can call back into progs, only time the outermost call
+	start = exitdepth ? 0 : Sys_FloatTime ();
+
 	s = PR_EnterFunction (pr, f);
 
 	while (1)
@@ -531,7 +535,11 @@ void PR_ExecuteProgram (progs_state_t *pr, func_t fnum)
 
 			s = PR_LeaveFunction (pr);
 			if (pr_depth == exitdepth)
+			{
+				if (!exitdepth)
+					SV_MetricsAdd (ph_progs, Sys_FloatTime () - start);
 				return; // all done
+			}
 			break;
 
 		case OP_STATE:
@@ -268,7 +268,8 @@ int PR_LoadProgs (progs_state_t *pr, char *filename, int version, int crc)
 
 	// add prog crc to the serverinfo
 	sprintf (num, "%i", pr->crc);
-	Info_SetValueForStarKey (svs.info, "*progs", num, MAX_SERVERINFO_STRING, sv_highchars.value);
+	Info_SetStar (&svs.info, "*progs", num, MAX_SERVERINFO_STRING, sv_highchars.value);
+	SV_InvalidateStatus ();
 
 	if (version != PROG_VERSION_ANY && version != pr->progs->version)
 	{
@@ -136,6 +136,9 @@ void ED_ParseGlobals (char *data);
 
 void ED_LoadFromFile (char *data);
 
+byte *ED_WriteSnapshot (size_t *len);
+void ED_ReadSnapshot (byte *data, size_t len);
+
 void ED_Init (void);
 
 edict_t *ED_GetNum (int n);
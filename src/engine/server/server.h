@@ -38,7 +38,7 @@ typedef struct client_s
 	int lossage;		// loss percentage
 
 	int userid;						// identifying number
-	char userinfo[MAX_INFO_STRING]; // infostring
+	info_t userinfo; // infostring
 
 	usercmd_t lastcmd; // for filling in big drops and partial predictions
 	double localtime;  // of last message
@@ -118,7 +118,7 @@ typedef struct
 	double last_heartbeat;
 	int heartbeat_sequence;
 
-	char info[MAX_SERVERINFO_STRING];
+	info_t info;
 
 	// log messages are used so that fraglog processes can get stats
 	int logsequence; // the message currently being filled
@@ -126,7 +126,13 @@ typedef struct
 	sizebuf_t log[2];
 	byte log_buf[2][MAX_DATAGRAM];
 
-	challenge_t challenges[MAX_CHALLENGES]; // to prevent invalid IPs from connecting
+	challenge_t challenges[MAX_CHALLENGES]; // to prevent invalid IPs from connecting,
+											// hashed by address
+
+	// connectionless packet accounting, shown by status
+	int oob_received;
+	int oob_ratelimited;
+	int oob_filtered;
 } server_static_t;
 
 typedef enum
@@ -292,7 +298,7 @@ extern edict_t *sv_player;
 
 extern char localmodels[MAX_MODELS][8]; // inline model names for precache
 
-extern char localinfo[MAX_LOCALINFO_STRING + 1];
+extern info_t localinfo;
 
 extern FILE *sv_fraglogfile;
 
@@ -307,6 +313,7 @@ void SV_CheckTimeouts (void);
 void SV_CheckVars (void);
 void SV_Init (void);
 
+void SV_InvalidateStatus (void);
 int SV_CalcPing (client_t *cl);
 void SV_FullClientUpdate (client_t *client, sizebuf_t *buf);
 void SV_FullClientUpdateToClient (client_t *client, client_t *cl);
@@ -329,6 +336,26 @@ void Master_Heartbeat (void);
 void Master_Packet (void);
 void Master_Shutdown (void);
 
+//
+// sv_metrics.c
+//
+typedef enum
+{
+	ph_frame, // the whole server frame
+	ph_readpackets,
+	ph_runcmd,
+	ph_physics,
+	ph_progs,
+	ph_sendmessages,
+	NUM_PHASES,
+} svphase_e;
+
+void SV_MetricsInit (void);
+void SV_MetricsBeginFrame (void);
+void SV_MetricsEndFrame (void);
+void SV_MetricsAdd (svphase_e phase, double seconds);
+int SV_MetricsReport (char *buf, int size);
+
 //
 // sv_init.c
 //
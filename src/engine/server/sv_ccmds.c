@@ -82,6 +82,7 @@ static void SV_Fraglogfile_f (void)
 	if (sv_fraglogfile)
 	{
 		Con_Printf ("Frag file logging off.\n");
+		Log_SetFile (LOG_FRAGS, NULL);
 		fclose (sv_fraglogfile);
 		sv_fraglogfile = NULL;
 		return;
@@ -108,6 +109,7 @@ static void SV_Fraglogfile_f (void)
 		return;
 	}
 
+	Log_SetFile (LOG_FRAGS, sv_fraglogfile);
 	Con_Printf ("Logging frags to %s.\n", name);
 }
 
@@ -380,6 +382,8 @@ static void SV_Status_f (void)
 	char *s;
 
 	Con_Printf ("net address      : %s\n", NET_AdrToString (NET_GetLocalAddress ()));
+	Con_Printf ("connectionless   : %i received, %i rate limited, %i filtered\n", svs.oob_received, svs.oob_ratelimited,
+				svs.oob_filtered);
 
 	// min fps lat drp
 	if (sv_redirected != RD_NONE)
@@ -486,6 +490,8 @@ static void SV_Heartbeat_f (void)
 
 void SV_SendServerInfoChange (char *key, char *value)
 {
+	SV_InvalidateStatus ();
+
 	if (!sv.state)
 		return;
 
@@ -510,7 +516,7 @@ static void SV_Serverinfo_f (void)
 	if (Cmd_Argc () == 1)
 	{
 		Con_Printf ("Server info settings:\n");
-		Info_Print (svs.info);
+		Info_List (&svs.info);
 		return;
 	}
 
@@ -525,7 +531,7 @@ static void SV_Serverinfo_f (void)
 		Con_Printf ("Star variables cannot be changed.\n");
 		return;
 	}
-	Info_SetValueForKey (svs.info, Cmd_Argv (1), Cmd_Argv (2), MAX_SERVERINFO_STRING, sv_highchars.value);
+	Info_Set (&svs.info, Cmd_Argv (1), Cmd_Argv (2), MAX_SERVERINFO_STRING, sv_highchars.value);
 
 	// if this is a cvar, change it too
 	var = Cvar_FindVar (src_server, Cmd_Argv (1));
@@ -551,7 +557,7 @@ static void SV_Localinfo_f (void)
 	if (Cmd_Argc () == 1)
 	{
 		Con_Printf ("Local info settings:\n");
-		Info_Print (localinfo);
+		Info_List (&localinfo);
 		return;
 	}
 
@@ -566,7 +572,7 @@ static void SV_Localinfo_f (void)
 		Con_Printf ("Star variables cannot be changed.\n");
 		return;
 	}
-	Info_SetValueForKey (localinfo, Cmd_Argv (1), Cmd_Argv (2), MAX_LOCALINFO_STRING, sv_highchars.value);
+	Info_Set (&localinfo, Cmd_Argv (1), Cmd_Argv (2), MAX_LOCALINFO_STRING, sv_highchars.value);
 }
 
 /*
@@ -587,7 +593,7 @@ static void SV_User_f (void)
 	if (!SV_SetPlayer ())
 		return;
 
-	Info_Print (host_client->userinfo);
+	Info_List (&host_client->userinfo);
 }
 
 /*
@@ -603,7 +609,7 @@ static void SV_Gamedir (void)
 
 	if (Cmd_Argc () == 1)
 	{
-		Con_Printf ("Current *gamedir: %s\n", Info_ValueForKey (svs.info, "*gamedir"));
+		Con_Printf ("Current *gamedir: %s\n", Info_Get (&svs.info, "*gamedir"));
 		return;
 	}
 
@@ -621,7 +627,8 @@ static void SV_Gamedir (void)
 		return;
 	}
 
-	Info_SetValueForStarKey (svs.info, "*gamedir", dir, MAX_SERVERINFO_STRING, sv_highchars.value);
+	Info_SetStar (&svs.info, "*gamedir", dir, MAX_SERVERINFO_STRING, sv_highchars.value);
+	SV_InvalidateStatus ();
 }
 
 /*
@@ -723,7 +730,8 @@ static void SV_Gamedir_f (void)
 	}
 
 	COM_Gamedir (dir);
-	Info_SetValueForStarKey (svs.info, "*gamedir", dir, MAX_SERVERINFO_STRING, sv_highchars.value);
+	Info_SetStar (&svs.info, "*gamedir", dir, MAX_SERVERINFO_STRING, sv_highchars.value);
+	SV_InvalidateStatus ();
 }
 
 void SV_InitOperatorCommands (void)
@@ -731,7 +739,7 @@ void SV_InitOperatorCommands (void)
 	if (COM_CheckParm ("-cheats"))
 	{
 		sv_allow_cheats = true;
-		Info_SetValueForStarKey (svs.info, "*cheats", "ON", MAX_SERVERINFO_STRING, sv_highchars.value);
+		Info_SetStar (&svs.info, "*cheats", "ON", MAX_SERVERINFO_STRING, sv_highchars.value);
 	}
 
 	Cmd_AddCommand (src_server, "logfile", SV_Logfile_f);
@@ -27,7 +27,7 @@ server_static_t svs;
 
 char localmodels[MAX_MODELS][8]; // inline model names for precache
 
-char localinfo[MAX_LOCALINFO_STRING + 1]; // local game info
+info_t localinfo; // local game info
 
 int SV_ModelIndex (char *name)
 {
@@ -168,6 +168,69 @@ void SV_SaveSpawnparms (void)
 	}
 }
 
+#define PHS_ROWS 64 // rows in each task
+
+typedef struct
+{
+	int start, end;
+	int count;
+} phsrows_t;
+
+static int phs_numleafs, phs_rowwords;
+
+/*
+================
+SV_CalcPHSRows
+
+Ors together the pvs rows of everything visible from each leaf in a range.
+Rows are independent, so ranges run on the worker threads
+================
+*/
+static void SV_CalcPHSRows (void *arg)
+{
+	phsrows_t *rows = arg;
+	int rowbytes;
+	int i, j, k, l, index;
+	int bitbyte;
+	unsigned int *dest, *src;
+	byte *scan;
+
+	rowbytes = phs_rowwords * 4;
+	rows->count = 0;
+
+	scan = sv.pvs + rows->start * rowbytes;
+	dest = (unsigned int *)sv.phs + rows->start * phs_rowwords;
+	for (i = rows->start; i < rows->end; i++, dest += phs_rowwords, scan += rowbytes)
+	{
+		memcpy (dest, scan, rowbytes);
+		for (j = 0; j < rowbytes; j++)
+		{
+			bitbyte = scan[j];
+			if (!bitbyte)
+				continue;
+			for (k = 0; k < 8; k++)
+			{
+				if (!(bitbyte & (1 << k)))
+					continue;
+				// or this pvs row into the phs
+				// +1 because pvs is 1 based
+				index = ((j << 3) + k + 1);
+				if (index >= phs_numleafs)
+					continue;
+				src = (unsigned int *)sv.pvs + index * phs_rowwords;
+				for (l = 0; l < phs_rowwords; l++)
+					dest[l] |= src[l];
+			}
+		}
+
+		if (i == 0)
+			continue;
+		for (j = 0; j < phs_numleafs; j++)
+			if (((byte *)dest)[j >> 3] & (1 << (j & 7)))
+				rows->count++;
+	}
+}
+
 /*
 ================
 SV_CalcPHS
@@ -179,11 +242,11 @@ Expands the PVS and calculates the PHS
 static void SV_CalcPHS (void)
 {
 	int rowbytes, rowwords;
-	int i, j, k, l, index, num;
-	int bitbyte;
-	unsigned int *dest, *src;
+	int i, j, num;
 	byte *scan;
 	int count, vcount;
+	int numtasks;
+	phsrows_t *tasks;
 
 	Con_Printf ("Building PHS...\n");
 
@@ -205,38 +268,24 @@ static void SV_CalcPHS (void)
 	}
 
 	sv.phs = Hunk_Alloc (rowbytes * num);
-	count = 0;
-	scan = sv.pvs;
-	dest = (unsigned int *)sv.phs;
-	for (i = 0; i < num; i++, dest += rowwords, scan += rowbytes)
-	{
-		memcpy (dest, scan, rowbytes);
-		for (j = 0; j < rowbytes; j++)
-		{
-			bitbyte = scan[j];
-			if (!bitbyte)
-				continue;
-			for (k = 0; k < 8; k++)
-			{
-				if (!(bitbyte & (1 << k)))
-					continue;
-				// or this pvs row into the phs
-				// +1 because pvs is 1 based
-				index = ((j << 3) + k + 1);
-				if (index >= num)
-					continue;
-				src = (unsigned int *)sv.pvs + index * rowwords;
-				for (l = 0; l < rowwords; l++)
-					dest[l] |= src[l];
-			}
-		}
 
-		if (i == 0)
-			continue;
-		for (j = 0; j < num; j++)
-			if (((byte *)dest)[j >> 3] & (1 << (j & 7)))
-				count++;
+	phs_numleafs = num;
+	phs_rowwords = rowwords;
+
+	numtasks = (num + PHS_ROWS - 1) / PHS_ROWS;
+	tasks = Z_Malloc (numtasks * sizeof (*tasks));
+	for (i = 0; i < numtasks; i++)
+	{
+		tasks[i].start = i * PHS_ROWS;
+		tasks[i].end = i == numtasks - 1 ? num : (i + 1) * PHS_ROWS;
+		Task_Add (SV_CalcPHSRows, &tasks[i]);
 	}
+	Task_Wait ();
+
+	count = 0;
+	for (i = 0; i < numtasks; i++)
+		count += tasks[i].count;
+	Z_Free (tasks);
 
 	Con_Printf ("Average leafs visible / hearable / total: %i / %i / %i\n", vcount / num, count / num, num);
 }
@@ -305,6 +354,7 @@ void SV_SpawnServer (char *server, char *startspot)
 {
 	edict_t *ent;
 	int i;
+	char *mapname;
 
 	Con_DPrintf ("SpawnServer: %s\n", server);
 
@@ -371,6 +421,11 @@ void SV_SpawnServer (char *server, char *startspot)
 	if (startspot)
 		strcpy (sv.startspot, startspot);
 
+	// start inflating the map while progs load
+	sprintf (sv.modelname, "maps/%s.bsp", server);
+	mapname = sv.modelname;
+	COM_PrefetchFiles ("", &mapname, 1);
+
 	// load progs to get entity field count
 	// which determines how big each edict is
 	if (!SV_LoadProgs ())
@@ -384,6 +439,7 @@ void SV_SpawnServer (char *server, char *startspot)
 	strcpy (sv.name, server);
 	sprintf (sv.modelname, "maps/%s.bsp", server);
 	sv.worldmodel = CMod_ForName (sv.modelname, false, true);
+	COM_ReleasePrefetch ();
 	if (!sv.worldmodel)
 	{
 		Con_Printf ("Couldn't spawn server %s\n", sv.modelname);
@@ -491,7 +547,8 @@ void SV_SpawnServer (char *server, char *startspot)
 	SV_CreateBaseline ();
 	sv.signon_buffer_size[sv.num_signon_buffers - 1] = sv.signon.cursize;
 
-	Info_SetValueForKey (svs.info, "map", sv.name, MAX_SERVERINFO_STRING, sv_highchars.value);
+	Info_Set (&svs.info, "map", sv.name, MAX_SERVERINFO_STRING, sv_highchars.value);
+	SV_InvalidateStatus ();
 
 	Con_DPrintf ("Server spawned.\n");
 }
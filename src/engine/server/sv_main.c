@@ -43,6 +43,9 @@ FILE *sv_fraglogfile;
 static cvar_t timeout = {"timeout", "65"}; // seconds without any message
 static cvar_t zombietime = {"zombietime", "2"}; // seconds to sink messages after disconnect
 
+static cvar_t sv_oobrate = {"sv_oobrate", "10"};   // connectionless packets per second per address
+static cvar_t sv_oobburst = {"sv_oobburst", "20"}; // connectionless packets allowed back to back
+
 /*
 ==================
 SV_FinalMessage
@@ -111,7 +114,7 @@ void SV_DropClient (client_t *drop)
 	drop->old_frags = 0;
 	ed_float (drop->edict, frags) = 0;
 	drop->name[0] = 0;
-	memset (drop->userinfo, 0, sizeof (drop->userinfo));
+	Info_Clear (&drop->userinfo);
 
 	// send notification to all remaining clients
 	SV_FullClientUpdate (drop, &sv.reliable_datagram);
@@ -151,10 +154,12 @@ Writes all update values to a sizebuf
 void SV_FullClientUpdate (client_t *client, sizebuf_t *buf)
 {
 	int i;
-	char info[MAX_INFO_STRING];
+	char info[MAX_INFO_STRING + 1];
 
 	i = client - svs.clients;
 
+	SV_InvalidateStatus ();
+
 	//Sys_Printf("SV_FullClientUpdate:  Updated frags for client %d\n", i);
 
 	MSG_WriteByte (buf, svc_updatefrags);
@@ -173,7 +178,7 @@ void SV_FullClientUpdate (client_t *client, sizebuf_t *buf)
 	MSG_WriteByte (buf, i);
 	MSG_WriteFloat (buf, host_time - client->connection_started);
 
-	strcpy (info, client->userinfo);
+	strcpy (info, Info_String (&client->userinfo));
 	Info_RemovePrefixedKeys (info, '_'); // server passwords, etc
 
 	MSG_WriteByte (buf, svc_updateuserinfo);
@@ -191,7 +196,7 @@ Writes all update values to a client's reliable stream
 */
 void SV_FullClientUpdateToClient (client_t *client, client_t *cl)
 {
-	ClientReliableCheckBlock (cl, 24 + strlen (client->userinfo));
+	ClientReliableCheckBlock (cl, 24 + client->userinfo.length);
 	if (cl->num_backbuf)
 	{
 		SV_FullClientUpdate (client, &cl->backbuf);
@@ -209,33 +214,96 @@ CONNECTIONLESS COMMANDS
 ==============================================================================
 */
 
+/*
+================
+SV_InvalidateStatus
+
+Called whenever something that appears in the status reply changes
+================
+*/
+static bool status_valid;
+
+void SV_InvalidateStatus (void)
+{
+	status_valid = false;
+}
+
 /*
 ================
 SVC_Status
 
 Responds with all the info that qplug or qspy can see
 This message can be up to around 5k with worst case string lengths.
+
+The reply is built once and then sent from the cache until serverinfo or
+the client list changes.  Pings and connect times drift on their own, so
+the cache is also rebuilt after STATUS_CACHE_TIME.
 ================
 */
+#define STATUS_CACHE_TIME 1.0
+
 static void SVC_Status (void)
 {
+	static char status[8000 + 6];
+	static int statuslen;
+	static double statustime;
 	int i;
 	client_t *cl;
 	int ping;
+	int len;
 
-	Cmd_TokenizeString (src_server, "status");
-	SV_BeginRedirect (RD_PACKET);
-	Con_Printf ("%s\n", svs.info);
-	for (i = 0; i < MAX_CLIENTS; i++)
+	if (!status_valid || host_time - statustime > STATUS_CACHE_TIME)
 	{
-		cl = &svs.clients[i];
-		if (cl->state == cs_connected || cl->state == cs_spawned)
+		status[0] = 0xff;
+		status[1] = 0xff;
+		status[2] = 0xff;
+		status[3] = 0xff;
+		status[4] = A2C_PRINT;
+		len = 5;
+
+		len += snprintf (status + len, sizeof (status) - len, "%s\n", Info_String (&svs.info));
+		for (i = 0; i < MAX_CLIENTS && len < sizeof (status); i++)
 		{
-			ping = SV_CalcPing (cl);
-			Con_Printf ("%i %i %i %i \"%s\"\n", cl->userid, cl->old_frags, (int)(host_time - cl->connection_started) / 60, ping, cl->name);
+			cl = &svs.clients[i];
+			if (cl->state == cs_connected || cl->state == cs_spawned)
+			{
+				ping = SV_CalcPing (cl);
+				len += snprintf (status + len, sizeof (status) - len, "%i %i %i %i \"%s\"\n", cl->userid, cl->old_frags,
+								 (int)(host_time - cl->connection_started) / 60, ping, cl->name);
+			}
 		}
+
+		if (len > sizeof (status) - 1)
+			len = sizeof (status) - 1;
+		statuslen = len + 1;
+
+		status_valid = true;
+		statustime = host_time;
 	}
-	SV_EndRedirect ();
+
+	NET_SendPacket (SERVER, statuslen, status, net_from);
+}
+
+/*
+================
+SVC_Metrics
+
+Responds with the server frame timing table
+================
+*/
+static void SVC_Metrics (void)
+{
+	char data[1024 + 6];
+	int len;
+
+	data[0] = 0xff;
+	data[1] = 0xff;
+	data[2] = 0xff;
+	data[3] = 0xff;
+	data[4] = A2C_PRINT;
+	len = 5 + SV_MetricsReport (data + 5, sizeof (data) - 5);
+
+	NET_SendPacket (SERVER, len + 1, data, net_from);
 }
 
 #define LOG_HIGHWATER 4096
@@ -311,6 +379,59 @@ static void SVC_Ping (void)
 	NET_SendPacket (SERVER, 1, &data, net_from);
 }
 
+/*
+=================
+SV_HashAddress
+
+Spreads an ip address over a power of two sized table
+=================
+*/
+static inline unsigned int SV_HashAddress (uint32_t ip, int bits)
+{
+	return (ip * 2654435761u) >> (32 - bits);
+}
+
+#define CHALLENGE_BITS 10 // log2 (MAX_CHALLENGES)
+#define CHALLENGE_PROBE 8
+
+/*
+=================
+SV_FindChallenge
+
+Looks up the challenge slot for an address.  Only a short run of slots
+after the address's hash is searched, so a flood of new addresses can
+only evict challenges that happen to share the run.  If create is set,
+the stalest slot in the run is taken over when the address isn't there.
+=================
+*/
+static challenge_t *SV_FindChallenge (netadr_t adr, bool create)
+{
+	unsigned int h;
+	challenge_t *c, *oldest;
+	int i;
+
+	h = SV_HashAddress (*(uint32_t *)adr.ip, CHALLENGE_BITS);
+	oldest = NULL;
+
+	for (i = 0; i < CHALLENGE_PROBE; i++)
+	{
+		c = &svs.challenges[(h + i) & (MAX_CHALLENGES - 1)];
+		if (c->time && NET_CompareBaseAdr (adr, c->adr))
+			return c;
+		if (!oldest || c->time < oldest->time)
+			oldest = c;
+	}
+
+	if (!create)
+		return NULL;
+
+	// overwrite the oldest
+	oldest->challenge = (rand () << 16) ^ rand ();
+	oldest->adr = adr;
+	oldest->time = host_time;
+	return oldest;
+}
+
 /*
 =================
 SVC_GetChallenge
@@ -324,36 +445,13 @@ challenge, they must give a valid IP address.
 */
 static void SVC_GetChallenge (void)
 {
-	int i;
-	int oldest;
-	int oldestTime;
-
-	oldest = 0;
-	oldestTime = 0x7fffffff;
+	challenge_t *c;
 
 	// see if we already have a challenge for this ip
-	for (i = 0; i < MAX_CHALLENGES; i++)
-	{
-		if (NET_CompareBaseAdr (net_from, svs.challenges[i].adr))
-			break;
-		if (svs.challenges[i].time < oldestTime)
-		{
-			oldestTime = svs.challenges[i].time;
-			oldest = i;
-		}
-	}
-
-	if (i == MAX_CHALLENGES)
-	{
-		// overwrite the oldest
-		svs.challenges[oldest].challenge = (rand () << 16) ^ rand ();
-		svs.challenges[oldest].adr = net_from;
-		svs.challenges[oldest].time = host_time;
-		i = oldest;
-	}
+	c = SV_FindChallenge (net_from, true);
 
 	// send it back
-	Netchan_OutOfBandPrint (SERVER, net_from, "%c%i", S2C_CHALLENGE, svs.challenges[i].challenge);
+	Netchan_OutOfBandPrint (SERVER, net_from, "%c%i", S2C_CHALLENGE, c->challenge);
 }
 
 /*
@@ -366,11 +464,13 @@ A connection request that did not come from the master
 static void SVC_DirectConnect (void)
 {
 	char userinfo[1024];
+	char info[MAX_INFO_STRING];
 	static int userid;
 	netadr_t adr;
 	int i;
 	client_t *cl, *newcl;
 	client_t temp;
+	challenge_t *c;
 	edict_t *ent;
 	int edictnum;
 	char *s;
@@ -397,19 +497,15 @@ static void SVC_DirectConnect (void)
 	userinfo[sizeof (userinfo) - 2] = 0;
 
 	// see if the challenge is valid
-	for (i = 0; i < MAX_CHALLENGES; i++)
+	c = SV_FindChallenge (net_from, false);
+	if (!c)
 	{
-		if (NET_CompareBaseAdr (net_from, svs.challenges[i].adr))
-		{
-			if (challenge == svs.challenges[i].challenge)
-				break; // good
-			Netchan_OutOfBandPrint (SERVER, net_from, "%c\nBad challenge.\n", A2C_PRINT);
-			return;
-		}
+		Netchan_OutOfBandPrint (SERVER, net_from, "%c\nNo challenge for address.\n", A2C_PRINT);
+		return;
 	}
-	if (i == MAX_CHALLENGES)
+	if (challenge != c->challenge)
 	{
-		Netchan_OutOfBandPrint (SERVER, net_from, "%c\nNo challenge for address.\n", A2C_PRINT);
+		Netchan_OutOfBandPrint (SERVER, net_from, "%c\nBad challenge.\n", A2C_PRINT);
 		return;
 	}
 
@@ -436,12 +532,16 @@ static void SVC_DirectConnect (void)
 	{
 		byte *p, *q;
 
-		for (p = (byte *)newcl->userinfo, q = (byte *)userinfo; *q && p < (byte *)newcl->userinfo + sizeof (newcl->userinfo) - 1; q++)
+		for (p = (byte *)info, q = (byte *)userinfo; *q && p < (byte *)info + sizeof (info) - 1; q++)
 			if (*q > 31 && *q <= 127)
 				*p++ = *q;
+		*p = 0;
 	}
 	else
-		strncpy (newcl->userinfo, userinfo, sizeof (newcl->userinfo) - 1);
+	{
+		strncpy (info, userinfo, sizeof (info) - 1);
+		info[sizeof (info) - 1] = 0;
+	}
 
 	// if there is allready a slot for this ip, drop it
 	for (i = 0, cl = svs.clients; i < MAX_CLIENTS; i++, cl++)
@@ -503,6 +603,7 @@ static void SVC_DirectConnect (void)
 	// accept the new client
 	// this is the only place a client_t is ever initialized
 	*newcl = temp;
+	Info_Parse (&newcl->userinfo, info, MAX_INFO_STRING);
 
 	Netchan_OutOfBandPrint (SERVER, adr, "%c", S2C_CONNECTION);
 
@@ -543,6 +644,7 @@ static void SVC_DirectConnect (void)
 
 	Con_DPrintf ("Client %s connected\n", newcl->name);
 	newcl->sendinfo = true;
+	SV_InvalidateStatus ();
 }
 
 static bool Rcon_Validate (void)
@@ -598,6 +700,81 @@ static void SVC_RemoteCommand (void)
 	SV_EndRedirect ();
 }
 
+/*
+==============================================================================
+
+CONNECTIONLESS RATE LIMITING
+
+Every source address gets a token bucket that refills at sv_oobrate tokens
+a second up to sv_oobburst.  Each connectionless packet costs a token, and
+packets that find the bucket empty are dropped without a reply, so spoofed
+status floods can neither pin the server nor use it as an amplifier.
+
+Buckets live in a fixed hash table.  A bucket that has been idle long
+enough to refill is no different from a fresh one, so stale entries are
+simply the first to be reused.
+
+==============================================================================
+*/
+
+#define OOB_BITS 12
+#define OOB_BUCKETS (1 << OOB_BITS)
+#define OOB_PROBE 8
+
+typedef struct
+{
+	uint32_t ip;
+	float tokens;
+	double last; // host_time of the last refill
+} oobbucket_t;
+
+static oobbucket_t oob_buckets[OOB_BUCKETS];
+
+static bool SV_CheckConnectionlessRate (void)
+{
+	uint32_t ip;
+	unsigned int h;
+	oobbucket_t *b, *oldest;
+	int i;
+
+	// the local client can't be spoofed and may be many bots
+	if (sv_oobrate.value <= 0 || NET_IsLocalHost (&net_from))
+		return true;
+
+	ip = *(uint32_t *)net_from.ip;
+	h = SV_HashAddress (ip, OOB_BITS);
+	oldest = NULL;
+
+	for (i = 0; i < OOB_PROBE; i++)
+	{
+		b = &oob_buckets[(h + i) & (OOB_BUCKETS - 1)];
+		if (b->last && b->ip == ip)
+			break;
+		if (!oldest || b->last < oldest->last)
+			oldest = b;
+	}
+
+	if (i == OOB_PROBE)
+	{
+		b = oldest;
+		b->ip = ip;
+		b->tokens = sv_oobburst.value;
+	}
+	else
+	{
+		b->tokens += (host_time - b->last) * sv_oobrate.value;
+		if (b->tokens > sv_oobburst.value)
+			b->tokens = sv_oobburst.value;
+	}
+	b->last = host_time;
+
+	if (b->tokens < 1)
+		return false;
+
+	b->tokens -= 1;
+	return true;
+}
+
 /*
 =================
 SV_ConnectionlessPacket
@@ -642,6 +819,11 @@ static void SV_ConnectionlessPacket (void)
 		SVC_Log ();
 		return;
 	}
+	else if (!strcmp (c, "metrics"))
+	{
+		SVC_Metrics ();
+		return;
+	}
 	else if (!strcmp (c, "connect"))
 	{
 		SVC_DirectConnect ();
@@ -740,10 +922,10 @@ void SV_ExtractFromUserinfo (client_t *cl)
 	int i;
 	client_t *client;
 	int dupc = 1;
-	char newname[80];
+	char newname[80], dupname[80];
 
 	// name for C code
-	val = Info_ValueForKey (cl->userinfo, "name");
+	val = Info_Get (&cl->userinfo, "name");
 
 	// trim user name
 	strncpy (newname, val, sizeof (newname) - 1);
@@ -768,14 +950,14 @@ void SV_ExtractFromUserinfo (client_t *cl)
 
 	if (strcmp (val, newname))
 	{
-		Info_SetValueForKey (cl->userinfo, "name", newname, MAX_INFO_STRING, sv_highchars.value);
-		val = Info_ValueForKey (cl->userinfo, "name");
+		Info_Set (&cl->userinfo, "name", newname, MAX_INFO_STRING, sv_highchars.value);
+		val = Info_Get (&cl->userinfo, "name");
 	}
 
 	if (!val[0] || !strcasecmp (val, "console"))
 	{
-		Info_SetValueForKey (cl->userinfo, "name", "unnamed", MAX_INFO_STRING, sv_highchars.value);
-		val = Info_ValueForKey (cl->userinfo, "name");
+		Info_Set (&cl->userinfo, "name", "unnamed", MAX_INFO_STRING, sv_highchars.value);
+		val = Info_Get (&cl->userinfo, "name");
 	}
 
 	// check to see if another user by the same name exists
@@ -790,19 +972,20 @@ void SV_ExtractFromUserinfo (client_t *cl)
 		}
 		if (i != MAX_CLIENTS)
 		{ // dup name
-			if (strlen (val) > sizeof (cl->name) - 1)
-				val[sizeof (cl->name) - 4] = 0;
-			p = val;
+			strcpy (dupname, val);
+			if (strlen (dupname) > sizeof (cl->name) - 1)
+				dupname[sizeof (cl->name) - 4] = 0;
+			p = dupname;
 
-			if (val[0] == '(')
-				if (val[2] == ')')
-					p = val + 3;
-				else if (val[3] == ')')
-					p = val + 4;
+			if (dupname[0] == '(')
+				if (dupname[2] == ')')
+					p = dupname + 3;
+				else if (dupname[3] == ')')
+					p = dupname + 4;
 
 			sprintf (newname, "(%d)%-.40s", dupc++, p);
-			Info_SetValueForKey (cl->userinfo, "name", newname, MAX_INFO_STRING, sv_highchars.value);
-			val = Info_ValueForKey (cl->userinfo, "name");
+			Info_Set (&cl->userinfo, "name", newname, MAX_INFO_STRING, sv_highchars.value);
+			val = Info_Get (&cl->userinfo, "name");
 		}
 		else
 			break;
@@ -833,7 +1016,7 @@ void SV_ExtractFromUserinfo (client_t *cl)
 	strncpy (cl->name, val, sizeof (cl->name) - 1);
 
 	// rate command
-	val = Info_ValueForKey (cl->userinfo, "rate");
+	val = Info_Get (&cl->userinfo, "rate");
 	if (strlen (val))
 	{
 		i = atoi (val);
@@ -845,7 +1028,7 @@ void SV_ExtractFromUserinfo (client_t *cl)
 	}
 
 	// msg command
-	val = Info_ValueForKey (cl->userinfo, "msg");
+	val = Info_Get (&cl->userinfo, "msg");
 	if (strlen (val))
 		cl->messagelevel = atoi (val);
 }
@@ -894,6 +1077,45 @@ static int numipfilters;
 
 static cvar_t filterban = {"filterban", "1"};
 
+/*
+filters can only wildcard whole octets, so there are at most 16 distinct
+masks.  the index keeps every filter in a hash keyed by its masked address,
+and a packet is checked by probing once for each mask that is in use.
+*/
+#define IPFILTER_BITS 11
+#define IPFILTER_HASH (1 << IPFILTER_BITS) // twice MAX_IPFILTERS
+
+static ipfilter_t *ipfilter_hash[IPFILTER_HASH];
+static uint32_t ipfilter_masks[16];
+static int numipfilter_masks;
+
+static void SV_RebuildIPFilters (void)
+{
+	ipfilter_t *f;
+	unsigned int h;
+	int i, j;
+
+	memset (ipfilter_hash, 0, sizeof (ipfilter_hash));
+	numipfilter_masks = 0;
+
+	for (i = 0, f = ipfilters; i < numipfilters; i++, f++)
+	{
+		if (f->compare == 0xffffffff)
+			continue; // free spot
+
+		for (j = 0; j < numipfilter_masks; j++)
+			if (ipfilter_masks[j] == f->mask)
+				break;
+		if (j == numipfilter_masks)
+			ipfilter_masks[numipfilter_masks++] = f->mask;
+
+		h = SV_HashAddress (f->compare ^ f->mask, IPFILTER_BITS);
+		while (ipfilter_hash[h])
+			h = (h + 1) & (IPFILTER_HASH - 1);
+		ipfilter_hash[h] = f;
+	}
+}
+
 static bool StringToFilter (char *s, ipfilter_t *f)
 {
 	char num[128];
@@ -954,6 +1176,8 @@ static void SV_AddIP_f (void)
 
 	if (!StringToFilter (Cmd_Argv (1), &ipfilters[i]))
 		ipfilters[i].compare = 0xffffffff;
+
+	SV_RebuildIPFilters ();
 }
 
 static void SV_RemoveIP_f (void)
@@ -971,6 +1195,7 @@ static void SV_RemoveIP_f (void)
 			for (j = i + 1; j < numipfilters; j++)
 				ipfilters[j - 1] = ipfilters[j];
 			numipfilters--;
+			SV_RebuildIPFilters ();
 			Con_Printf ("Removed.\n");
 			return;
 		}
@@ -1017,6 +1242,7 @@ static void SV_WriteIP_f (void)
 	}
 
 	fclose (f);
+	COM_FileWritten (name);
 }
 
 static void SV_SendBan (void)
@@ -1033,14 +1259,22 @@ static void SV_SendBan (void)
 
 static bool SV_FilterPacket (void)
 {
+	ipfilter_t *f;
+	unsigned int h;
+	uint32_t in, mask;
 	int i;
-	uint32_t in;
 
 	in = *(uint32_t *)net_from.ip;
 
-	for (i = 0; i < numipfilters; i++)
-		if ((in & ipfilters[i].mask) == ipfilters[i].compare)
-			return filterban.value;
+	for (i = 0; i < numipfilter_masks; i++)
+	{
+		mask = ipfilter_masks[i];
+		h = SV_HashAddress ((in & mask) ^ mask, IPFILTER_BITS);
+
+		for (; (f = ipfilter_hash[h]); h = (h + 1) & (IPFILTER_HASH - 1))
+			if (f->mask == mask && f->compare == (in & mask))
+				return filterban.value;
+	}
 
 	return !filterban.value;
 }
@@ -1057,13 +1291,21 @@ void SV_ReadPackets (void)
 	{
 		if (SV_FilterPacket ())
 		{
-			SV_SendBan (); // tell them we aren't listening...
+			svs.oob_filtered++;
+			if (SV_CheckConnectionlessRate ())
+				SV_SendBan (); // tell them we aren't listening...
 			continue;
 		}
 
 		// check for connectionless packet (0xffffffff) first
 		if (*(int32_t *)net_message[SERVER].data == -1)
 		{
+			svs.oob_received++;
+			if (!SV_CheckConnectionlessRate ())
+			{
+				svs.oob_ratelimited++;
+				continue;
+			}
 			SV_ConnectionlessPacket ();
 			continue;
 		}
@@ -1166,10 +1408,11 @@ void SV_CheckVars (void)
 		v |= 1;
 
 	Con_Printf ("Updated needpass.\n");
+	SV_InvalidateStatus ();
 	if (!v)
-		Info_SetValueForKey (svs.info, "needpass", "", MAX_SERVERINFO_STRING, sv_highchars.value);
+		Info_Set (&svs.info, "needpass", "", MAX_SERVERINFO_STRING, sv_highchars.value);
 	else
-		Info_SetValueForKey (svs.info, "needpass", va ("%i", v), MAX_SERVERINFO_STRING, sv_highchars.value);
+		Info_Set (&svs.info, "needpass", va ("%i", v), MAX_SERVERINFO_STRING, sv_highchars.value);
 }
 
 void SV_Init (void)
@@ -1187,6 +1430,7 @@ void SV_Init (void)
 
 	SV_InitOperatorCommands ();
 	SV_UserInit ();
+	SV_MetricsInit ();
 
 	Cvar_RegisterVariable (src_server, &maxclients);
 	Cvar_RegisterVariable (src_server, &hostname);
@@ -1207,6 +1451,8 @@ void SV_Init (void)
 	Cvar_RegisterVariable (src_server, &sv_aim);
 
 	Cvar_RegisterVariable (src_server, &filterban);
+	Cvar_RegisterVariable (src_server, &sv_oobrate);
+	Cvar_RegisterVariable (src_server, &sv_oobburst);
 
 	Cvar_RegisterVariable (src_server, &allow_download);
 	Cvar_RegisterVariable (src_server, &allow_download_models);
@@ -1225,7 +1471,7 @@ void SV_Init (void)
 	for (i = 0; i < MAX_MODELS; i++)
 		sprintf (localmodels[i], "*%i", i);
 
-	Info_SetValueForStarKey (svs.info, "*version", ENGINE_VERSION, MAX_SERVERINFO_STRING, sv_highchars.value);
+	Info_SetStar (&svs.info, "*version", ENGINE_VERSION, MAX_SERVERINFO_STRING, sv_highchars.value);
 
 	// init fraglog stuff
 	svs.logsequence = 1;
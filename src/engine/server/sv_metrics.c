@@ -0,0 +1,284 @@
+/*
+===========================================================================
+Copyright (C) 1996-1997 Id Software, Inc.
+Copyright (C) 2023-2024 Justin Keller
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <https://www.gnu.org/licenses/>.
+===========================================================================
+*/
+
+// sv_metrics.c -- server frame timing
+
+#include "serverdef.h"
+
+/*
+every server frame the time spent in each phase is added up, then stored
+in a window of the last METRICS_FRAMES frames.  percentiles are only worked
+out when somebody asks for them, by sorting a copy of the window.
+
+the phases nest: client commands are run while reading packets, and progs
+run inside both physics and client commands, so they don't add up to the
+whole frame
+*/
+
+#define METRICS_FRAMES 1024 // must be a power of two
+
+static char *phase_names[NUM_PHASES] = {
+	"frame",
+	"readpackets",
+	"runcmd",
+	"physics",
+	"progs",
+	"sendmessages",
+};
+
+static float metrics[NUM_PHASES][METRICS_FRAMES]; // milliseconds
+static int metrics_frames;
+static int metrics_overruns;
+
+static double frame_start;
+static double frame_time[NUM_PHASES];
+
+static FILE *metrics_logfile;
+static bool metrics_logjson;
+
+/*
+==================
+SV_MetricsBeginFrame
+==================
+*/
+void SV_MetricsBeginFrame (void)
+{
+	memset (frame_time, 0, sizeof (frame_time));
+	frame_start = Sys_FloatTime ();
+}
+
+/*
+==================
+SV_MetricsAdd
+
+Charges time to a phase of the current frame
+==================
+*/
+void SV_MetricsAdd (svphase_e phase, double seconds)
+{
+	frame_time[phase] += seconds;
+}
+
+/*
+==================
+SV_MetricsEscape
+
+Copies a string for use inside a json string
+==================
+*/
+static void SV_MetricsEscape (char *out, int size, char *in)
+{
+	int len;
+
+	for (len = 0; *in && len < size - 7; in++)
+	{
+		if (*in == '"' || *in == '\\')
+		{
+			out[len++] = '\\';
+			out[len++] = *in;
+		}
+		else if ((byte)*in < ' ')
+			len += sprintf (out + len, "\\u%04x", (byte)*in);
+		else
+			out[len++] = *in;
+	}
+	out[len] = 0;
+}
+
+// the line goes out through the log thread, so a slow disk can't stall the frame
+static void SV_MetricsLogFrame (void)
+{
+	char line[1024], map[2 * sizeof (sv.name) + 8];
+	int i, len, clients;
+
+	for (i = 0, clients = 0; i < MAX_CLIENTS; i++)
+		if (svs.clients[i].state == cs_spawned)
+			clients++;
+
+	if (metrics_logjson)
+	{
+		SV_MetricsEscape (map, sizeof (map), sv.name);
+		len = snprintf (line, sizeof (line), "{\"frame\":%i,\"time\":%.3f,\"map\":\"%s\",\"clients\":%i", metrics_frames, sv.time, map, clients);
+		for (i = 0; i < NUM_PHASES; i++)
+			len += snprintf (line + len, sizeof (line) - len, ",\"%s\":%.4f", phase_names[i], frame_time[i] * 1000.0);
+		snprintf (line + len, sizeof (line) - len, "}\n");
+	}
+	else
+	{
+		len = snprintf (line, sizeof (line), "%i,%.3f,%s,%i", metrics_frames, sv.time, sv.name, clients);
+		for (i = 0; i < NUM_PHASES; i++)
+			len += snprintf (line + len, sizeof (line) - len, ",%.4f", frame_time[i] * 1000.0);
+		snprintf (line + len, sizeof (line) - len, "\n");
+	}
+
+	Log_Write (LOG_METRICS, line);
+}
+
+/*
+==================
+SV_MetricsEndFrame
+
+Stores the frame in the window, and the log if one is open.  A frame that
+takes longer than a server tic is counted as an overrun
+==================
+*/
+void SV_MetricsEndFrame (void)
+{
+	int i, slot;
+
+	frame_time[ph_frame] = Sys_FloatTime () - frame_start;
+
+	slot = metrics_frames & (METRICS_FRAMES - 1);
+	for (i = 0; i < NUM_PHASES; i++)
+		metrics[i][slot] = frame_time[i] * 1000.0;
+
+	if (frame_time[ph_frame] > sys_ticrate.value)
+		metrics_overruns++;
+
+	if (metrics_logfile)
+		SV_MetricsLogFrame ();
+
+	metrics_frames++;
+}
+
+static int SV_MetricsCompare (const void *a, const void *b)
+{
+	float fa = *(const float *)a;
+	float fb = *(const float *)b;
+
+	return (fa > fb) - (fa < fb);
+}
+
+/*
+==================
+SV_MetricsReport
+
+Writes the percentile table for the current window into buf
+==================
+*/
+int SV_MetricsReport (char *buf, int size)
+{
+	static float sorted[METRICS_FRAMES];
+	int i, n, len;
+
+	n = metrics_frames < METRICS_FRAMES ? metrics_frames : METRICS_FRAMES;
+
+	len = snprintf (buf, size, "%s: %i frames, %i overruns of %.0f ms\n", sv.name, metrics_frames, metrics_overruns, sys_ticrate.value * 1000.0);
+	len += snprintf (buf + len, size - len, "last %-5i      p50      p95      p99      max (ms)\n", n);
+
+	for (i = 0; i < NUM_PHASES && len < size; i++)
+	{
+		if (!n)
+		{
+			len += snprintf (buf + len, size - len, "%-12s %8.3f %8.3f %8.3f %8.3f\n", phase_names[i], 0.0, 0.0, 0.0, 0.0);
+			continue;
+		}
+
+		memcpy (sorted, metrics[i], n * sizeof (float));
+		qsort (sorted, n, sizeof (float), SV_MetricsCompare);
+
+		len += snprintf (buf + len, size - len, "%-12s %8.3f %8.3f %8.3f %8.3f\n", phase_names[i], sorted[(n - 1) * 50 / 100], sorted[(n - 1) * 95 / 100],
+						 sorted[(n - 1) * 99 / 100], sorted[n - 1]);
+	}
+
+	if (len > size - 1)
+		len = size - 1;
+
+	return len;
+}
+
+/*
+==================
+SV_Metrics_f
+==================
+*/
+static void SV_Metrics_f (void)
+{
+	char report[1024];
+
+	SV_MetricsReport (report, sizeof (report));
+	Con_Printf ("%s", report);
+}
+
+/*
+==================
+SV_MetricsLog_f
+
+metricslog [json]
+Toggles logging every frame to metrics_<n>.csv, or .json as JSON lines
+==================
+*/
+static void SV_MetricsLog_f (void)
+{
+	char name[MAX_OSPATH];
+	char *ext;
+	int i;
+
+	if (metrics_logfile)
+	{
+		Con_Printf ("Metrics logging off.\n");
+		Log_SetFile (LOG_METRICS, NULL);
+		fclose (metrics_logfile);
+		metrics_logfile = NULL;
+		return;
+	}
+
+	metrics_logjson = !strcmp (Cmd_Argv (1), "json");
+	ext = metrics_logjson ? "json" : "csv";
+
+	// find an unused name
+	for (i = 0; i < 1000; i++)
+	{
+		sprintf (name, "%s/metrics_%i.%s", com_gamedir, i, ext);
+		metrics_logfile = fopen (name, "r");
+		if (!metrics_logfile)
+		{ // can't read it, so create this one
+			metrics_logfile = fopen (name, "w");
+			if (!metrics_logfile)
+				i = 1000; // give error
+			break;
+		}
+		fclose (metrics_logfile);
+	}
+	if (i == 1000)
+	{
+		Con_Printf ("Can't open any logfiles.\n");
+		metrics_logfile = NULL;
+		return;
+	}
+
+	if (!metrics_logjson)
+	{ // written before any frames are queued
+		fprintf (metrics_logfile, "frame,time,map,clients");
+		for (i = 0; i < NUM_PHASES; i++)
+			fprintf (metrics_logfile, ",%s", phase_names[i]);
+		fprintf (metrics_logfile, "\n");
+	}
+
+	Log_SetFile (LOG_METRICS, metrics_logfile);
+
+	Con_Printf ("Logging metrics to %s.\n", name);
+}
+
+void SV_MetricsInit (void)
+{
+	Cmd_AddCommand (src_server, "metrics", SV_Metrics_f);
+	Cmd_AddCommand (src_server, "metricslog", SV_MetricsLog_f);
+}
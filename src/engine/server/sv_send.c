@@ -602,6 +602,7 @@ static void SV_UpdateToReliableMessages (void)
 			}
 
 			host_client->old_frags = ed_float (host_client->edict, frags);
+			SV_InvalidateStatus ();
 		}
 
 		// maxspeed/entgravity changes
@@ -110,7 +110,7 @@ static void SV_New_f (void)
 
 	// send server info string
 	MSG_WriteByte (&host_client->netchan.message, svc_stufftext);
-	MSG_WriteString (&host_client->netchan.message, va ("fullserverinfo \"%s\"\n", svs.info));
+	MSG_WriteString (&host_client->netchan.message, va ("fullserverinfo \"%s\"\n", Info_String (&svs.info)));
 }
 
 static void SV_Soundlist_f (void)
@@ -531,6 +531,7 @@ static void SV_NextUpload (void)
 	{
 		fclose (host_client->upload);
 		host_client->upload = NULL;
+		COM_FlushFileIndex ();
 
 		Sys_Printf ("%s upload completed.\n", host_client->uploadfn);
 
@@ -631,7 +632,7 @@ static void SV_Say (bool team)
 
 	if (team)
 	{
-		strncpy (t1, Info_ValueForKey (host_client->userinfo, "team"), 31);
+		strncpy (t1, Info_Get (&host_client->userinfo, "team"), 31);
 		t1[31] = 0;
 	}
 
@@ -685,7 +686,7 @@ static void SV_Say (bool team)
 
 		if (team)
 		{
-			t2 = Info_ValueForKey (client->userinfo, "team");
+			t2 = Info_Get (&client->userinfo, "team");
 			if (strcmp (t1, t2))
 				continue; // on different teams
 		}
@@ -865,7 +866,7 @@ static void SV_SetInfo_f (void)
 	if (Cmd_Argc () == 1)
 	{
 		Con_Printf ("User info settings:\n");
-		Info_Print (host_client->userinfo);
+		Info_List (&host_client->userinfo);
 		return;
 	}
 
@@ -878,16 +879,16 @@ static void SV_SetInfo_f (void)
 	if (Cmd_Argv (1)[0] == '*')
 		return; // don't set priveledged values
 
-	strcpy (oldval, Info_ValueForKey (host_client->userinfo, Cmd_Argv (1)));
+	strcpy (oldval, Info_Get (&host_client->userinfo, Cmd_Argv (1)));
 
-	Info_SetValueForKey (host_client->userinfo, Cmd_Argv (1), Cmd_Argv (2), MAX_INFO_STRING, sv_highchars.value);
+	Info_Set (&host_client->userinfo, Cmd_Argv (1), Cmd_Argv (2), MAX_INFO_STRING, sv_highchars.value);
 	// name is extracted below in ExtractFromUserInfo
-	//	strncpy (host_client->name, Info_ValueForKey (host_client->userinfo, "name")
+	//	strncpy (host_client->name, Info_Get (&host_client->userinfo, "name")
 	//		, sizeof(host_client->name)-1);
 	//	SV_FullClientUpdate (host_client, &sv.reliable_datagram);
 	//	host_client->sendinfo = true;
 
-	if (!strcmp (Info_ValueForKey (host_client->userinfo, Cmd_Argv (1)), oldval))
+	if (!strcmp (Info_Get (&host_client->userinfo, Cmd_Argv (1)), oldval))
 		return; // key hasn't changed
 
 	// process any changed values
@@ -897,7 +898,7 @@ static void SV_SetInfo_f (void)
 	MSG_WriteByte (&sv.reliable_datagram, svc_setinfo);
 	MSG_WriteByte (&sv.reliable_datagram, i);
 	MSG_WriteString (&sv.reliable_datagram, Cmd_Argv (1));
-	MSG_WriteString (&sv.reliable_datagram, Info_ValueForKey (host_client->userinfo, Cmd_Argv (1)));
+	MSG_WriteString (&sv.reliable_datagram, Info_Get (&host_client->userinfo, Cmd_Argv (1)));
 }
 
 /*
@@ -909,7 +910,7 @@ Dumps the serverinfo info string
 */
 static void SV_ShowServerinfo_f (void)
 {
-	Info_Print (svs.info);
+	Info_List (&svs.info);
 }
 
 typedef struct
@@ -1407,6 +1408,8 @@ void SV_ExecuteClientMessage (client_t *cl)
 
 			if (!sv.paused)
 			{
+				double start = Sys_FloatTime ();
+
 				SV_PreRunCmd ();
 
 				if (net_drop < 20)
@@ -1424,6 +1427,8 @@ void SV_ExecuteClientMessage (client_t *cl)
 				SV_RunCmd (&newcmd);
 
 				SV_PostRunCmd ();
+
+				SV_MetricsAdd (ph_runcmd, Sys_FloatTime () - start);
 			}
 
 			cl->lastcmd = newcmd;